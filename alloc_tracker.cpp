@@ -0,0 +1,215 @@
+#include "alloc_tracker.h"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include "game_module.h"
+#include <cstring>
+
+namespace {
+
+// Plain values with constant initialisers, so reading them never runs a
+// constructor or allocates on a new thread
+thread_local Uint64 allocations = 0;
+thread_local Uint64 allocatedBytes = 0;
+
+void note(size_t bytes) {
+    allocations++;
+    allocatedBytes += bytes;
+}
+
+void* allocate(size_t bytes) {
+    note(bytes);
+    for (;;) {
+        void* memory = std::malloc(bytes ? bytes : 1);
+        if (memory) return memory;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* allocateOrNull(size_t bytes) {
+    try {
+        return allocate(bytes);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+SDL_malloc_func sdlMalloc = nullptr;
+SDL_calloc_func sdlCalloc = nullptr;
+SDL_realloc_func sdlRealloc = nullptr;
+SDL_free_func sdlFree = nullptr;
+
+void* SDLCALL countedMalloc(size_t bytes) {
+    note(bytes);
+    return sdlMalloc(bytes);
+}
+
+void* SDLCALL countedCalloc(size_t count, size_t bytes) {
+    note(count * bytes);
+    return sdlCalloc(count, bytes);
+}
+
+void* SDLCALL countedRealloc(void* memory, size_t bytes) {
+    note(bytes);
+    return sdlRealloc(memory, bytes);
+}
+
+void SDLCALL countedFree(void* memory) {
+    sdlFree(memory);
+}
+
+} // namespace
+
+// Every module links arcade_core ahead of the C++ runtime, so these replace
+// the runtime's operators for the emulator and all games alike
+void* operator new(size_t bytes) {
+    return allocate(bytes);
+}
+
+void* operator new[](size_t bytes) {
+    return allocate(bytes);
+}
+
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept {
+    return allocateOrNull(bytes);
+}
+
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept {
+    return allocateOrNull(bytes);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
+
+AllocationCount allocationsSoFar() {
+    AllocationCount counts = {allocations, allocatedBytes};
+    return counts;
+}
+
+void trackSdlAllocations() {
+    if (sdlMalloc) return;
+    SDL_GetMemoryFunctions(&sdlMalloc, &sdlCalloc, &sdlRealloc, &sdlFree);
+    // Memory SDL allocated earlier is still freed by its own free
+    if (SDL_SetMemoryFunctions(countedMalloc, countedCalloc, countedRealloc, countedFree) != 0) {
+        std::cerr << "Cannot count SDL allocations: " << SDL_GetError() << std::endl;
+    }
+}
+
+namespace {
+
+const int WARM_UP_TICKS = 3600;   // Long enough for every list to reach its working size
+
+void printAllocations(const char* gameName, const char* path, const AllocationCount& total, int ticks,
+                      Uint64 allocatingTicks) {
+    std::cout << gameName << " allocations " << path << ": " << total.count << " (" << total.bytes << " bytes) in "
+              << ticks << " ticks after " << WARM_UP_TICKS << " ticks of warm-up, " << allocatingTicks
+              << " ticks allocated" << std::endl;
+}
+
+Uint64 checkEnvAllocations(const char* gameName, const GameEnvSpec& spec, int ticks) {
+    GameEnv* game = spec.create();
+    RenderSnapshot frame;
+    Uint32 episode = 1;
+    game->reset(episode);
+
+    AllocationCount total = {0, 0};
+    Uint64 allocatingTicks = 0;
+    for (int t = 0; t < WARM_UP_TICKS + ticks; ++t) {
+        // Each action held for a few ticks, so games get to move about
+        int action = (t / 7 + t / 61) % spec.actionCount;
+        AllocationCount before = allocationsSoFar();
+        game->step(action);
+        game->snapshot(frame);
+        AllocationCount after = allocationsSoFar();
+        if (t >= WARM_UP_TICKS && after.count != before.count) {
+            total.count += after.count - before.count;
+            total.bytes += after.bytes - before.bytes;
+            allocatingTicks++;
+        }
+        if (game->done()) game->reset(++episode);
+    }
+    delete game;
+
+    printAllocations(gameName, "as an environment", total, ticks, allocatingTicks);
+    return total.count;
+}
+
+// Keys every game reads, plus rewind and the quick save slot keys. F5 and
+// F9 are left out: a slot's first save sizes its buffers and starts the
+// file writer, and loading a slot not yet in memory reads its file.
+const struct PlayedKey { SDL_Scancode scancode; SDL_Keycode sym; } PLAYED_KEYS[] = {
+    {SDL_SCANCODE_LEFT, SDLK_LEFT}, {SDL_SCANCODE_RIGHT, SDLK_RIGHT}, {SDL_SCANCODE_UP, SDLK_UP},
+    {SDL_SCANCODE_DOWN, SDLK_DOWN}, {SDL_SCANCODE_W, SDLK_w}, {SDL_SCANCODE_S, SDLK_s},
+    {SDL_SCANCODE_SPACE, SDLK_SPACE}, {SDL_SCANCODE_BACKSPACE, SDLK_BACKSPACE}, {SDL_SCANCODE_F1, SDLK_F1},
+    {SDL_SCANCODE_F2, SDLK_F2}, {SDL_SCANCODE_F3, SDLK_F3}, {SDL_SCANCODE_F4, SDLK_F4}};
+const int PLAYED_KEY_COUNT = sizeof(PLAYED_KEYS) / sizeof(PLAYED_KEYS[0]);
+
+Uint64 checkSimulationAllocations(const char* gameName, Simulation* (*createHeadless)(bool rewind), int ticks) {
+    Simulation* game = createHeadless(true);
+    RenderSnapshot frame;
+    static Uint8 keys[SDL_NUM_SCANCODES];
+    memset(keys, 0, sizeof(keys));
+    SDL_KeyboardEvent press;
+    memset(&press, 0, sizeof(press));
+    press.type = SDL_KEYDOWN;
+    int held = -1;
+    bool restarted = false;
+
+    AllocationCount total = {0, 0};
+    Uint64 allocatingTicks = 0;
+    for (int t = 0; t < WARM_UP_TICKS + ticks; ++t) {
+        AllocationCount before = allocationsSoFar();
+        int key = (t / 7 + t / 61) % PLAYED_KEY_COUNT;
+        if (key != held) {
+            if (held >= 0) keys[PLAYED_KEYS[held].scancode] = 0;
+            held = key;
+            press.keysym.scancode = PLAYED_KEYS[key].scancode;
+            press.keysym.sym = PLAYED_KEYS[key].sym;
+            keys[press.keysym.scancode] = 1;
+            game->keyPressed(press);
+        }
+        game->tick(keys);
+        game->snapshot(frame);
+        AllocationCount after = allocationsSoFar();
+        // A new game's first tick starts its rewind history, so it is left out too
+        if (t >= WARM_UP_TICKS && !restarted && after.count != before.count) {
+            total.count += after.count - before.count;
+            total.bytes += after.bytes - before.bytes;
+            allocatingTicks++;
+        }
+        restarted = false;
+        if (game->finished()) {
+            delete game;
+            game = createHeadless(true);
+            restarted = true;
+        }
+    }
+    delete game;
+
+    printAllocations(gameName, "in play", total, ticks, allocatingTicks);
+    return total.count;
+}
+
+} // namespace
+
+Uint64 checkGameAllocations(const GameModule& game, int ticks) {
+    Uint64 count = 0;
+    if (game.env) count += checkEnvAllocations(game.scoreName, *game.env, ticks);
+    if (game.createHeadless) count += checkSimulationAllocations(game.scoreName, game.createHeadless, ticks);
+    return count;
+}
@@ -0,0 +1,33 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <SDL.h>
+
+struct GameModule;
+
+// Heap allocations made by the calling thread so far. Every C++ new in the
+// emulator and the game modules is counted, since arcade_core replaces the
+// global operator new, and so is SDL's own memory once
+// trackSdlAllocations() has run. Read the counts before and after a piece
+// of work and take the difference.
+struct AllocationCount {
+    Uint64 count;
+    Uint64 bytes;
+};
+
+AllocationCount allocationsSoFar();
+
+// Routes SDL_malloc, SDL_calloc and SDL_realloc, which SDL_ttf and
+// SDL_image use too, through the counters. Call first thing in main,
+// before SDL has allocated anything.
+void trackSdlAllocations();
+
+// Plays a headless copy of the game for a minute of game time, then counts
+// what further ticks and their snapshots allocate; starting a new game is
+// left out. Both ways a game is played are checked: stepped as a training
+// environment, and ticked through its Simulation interface as in real play,
+// with keys pressed and held, rewind recording and stepping back. Prints
+// the results and returns the number of allocations, which should be 0.
+Uint64 checkGameAllocations(const GameModule& game, int ticks);
+
+#endif
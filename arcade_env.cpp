@@ -0,0 +1,74 @@
+#include "arcade_env.h"
+#include <iostream>
+#include "batched_env.h"
+#include "game_registry.h"
+
+static_assert(ARCADE_ENV_STATE == ENV_OBSERVE_STATE && ARCADE_ENV_PIXELS == ENV_OBSERVE_PIXELS,
+              "arcade_env.h and batched_env.h disagree");
+
+struct ArcadeEnv {
+    BatchedEnv batch;
+
+    ArcadeEnv(const GameEnvSpec& spec, int count, EnvObservation observation, int pixelScale, int maxEpisodeSteps,
+              Uint32 seed, int threads)
+        : batch(spec, count, observation, pixelScale, maxEpisodeSteps, seed, threads) {}
+};
+
+// Loaded on the first create; game libraries then stay loaded
+static GameRegistry& registry() {
+    static GameRegistry* games = nullptr;
+    if (!games) {
+        games = new GameRegistry();
+        games->loadManifest("games.txt");
+    }
+    return *games;
+}
+
+ArcadeEnv* arcade_env_create(const char* game, int count, int observation, int pixel_scale, int max_episode_steps,
+                             uint32_t seed, int threads) {
+    if (!game || count <= 0 || (observation != ARCADE_ENV_STATE && observation != ARCADE_ENV_PIXELS)) return nullptr;
+    const GameModule* module = registry().find(game);
+    if (!module) return nullptr;
+    if (!module->env) {
+        std::cerr << module->title << " has no training interface" << std::endl;
+        return nullptr;
+    }
+    return new ArcadeEnv(*module->env, count, static_cast<EnvObservation>(observation), pixel_scale, max_episode_steps,
+                         seed, threads);
+}
+
+void arcade_env_destroy(ArcadeEnv* env) {
+    delete env;
+}
+
+int arcade_env_size(const ArcadeEnv* env) {
+    return env->batch.size();
+}
+
+int arcade_env_action_count(const ArcadeEnv* env) {
+    return env->batch.actionCount();
+}
+
+int arcade_env_observation_size(const ArcadeEnv* env) {
+    return env->batch.observationSize();
+}
+
+int arcade_env_observation_width(const ArcadeEnv* env) {
+    return env->batch.observationWidth();
+}
+
+int arcade_env_observation_height(const ArcadeEnv* env) {
+    return env->batch.observationHeight();
+}
+
+void arcade_env_set_buffers(ArcadeEnv* env, void* observations, float* rewards, uint8_t* dones) {
+    env->batch.setBuffers(observations, rewards, dones);
+}
+
+void arcade_env_reset(ArcadeEnv* env) {
+    env->batch.reset();
+}
+
+void arcade_env_step(ArcadeEnv* env, const int* actions) {
+    env->batch.step(actions);
+}
@@ -0,0 +1,68 @@
+#ifndef ARCADE_ENV_H
+#define ARCADE_ENV_H
+
+#include <stdint.h>
+
+/* C interface to BatchedEnv (batched_env.h) for training code in other
+   languages, built as its own library (see emulator.cpp). Games are found
+   through games.txt in the working directory by their score name: tetris,
+   pong, brick or snake.
+
+     ArcadeEnv* env = arcade_env_create("brick", 1024, ARCADE_ENV_STATE, 8, 0, 1, 0);
+     arcade_env_set_buffers(env, observations, rewards, dones);
+     arcade_env_reset(env);
+     for (;;) arcade_env_step(env, actions);
+     arcade_env_destroy(env);
+
+   Observations, rewards and done flags are written straight into the
+   caller's arrays on every reset and step. A copy whose episode ended is
+   reset at once: its done flag is 1 and its observation is already the
+   first of the next episode. Create, use and destroy an env from one
+   thread at a time. */
+
+#if defined(_WIN32) && defined(ARCADE_ENV_BUILD)
+#define ARCADE_ENV_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define ARCADE_ENV_API __declspec(dllimport)
+#else
+#define ARCADE_ENV_API __attribute__((visibility("default")))
+#endif
+
+#define ARCADE_ENV_STATE 0   /* float state vector per copy */
+#define ARCADE_ENV_PIXELS 1  /* uint8_t grey picture per copy, 1/pixel_scale size */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ArcadeEnv ArcadeEnv;
+
+/* count copies of the game. max_episode_steps 0 lets episodes run until the
+   game ends; threads 0 uses every CPU. Null if the game cannot be found or
+   cannot be trained on. */
+ARCADE_ENV_API ArcadeEnv* arcade_env_create(const char* game, int count, int observation, int pixel_scale,
+                                            int max_episode_steps, uint32_t seed, int threads);
+ARCADE_ENV_API void arcade_env_destroy(ArcadeEnv* env);
+
+ARCADE_ENV_API int arcade_env_size(const ArcadeEnv* env);
+ARCADE_ENV_API int arcade_env_action_count(const ArcadeEnv* env);
+
+/* Values per copy: floats for states, bytes for pixels, which are
+   width x height in rows */
+ARCADE_ENV_API int arcade_env_observation_size(const ArcadeEnv* env);
+ARCADE_ENV_API int arcade_env_observation_width(const ArcadeEnv* env);
+ARCADE_ENV_API int arcade_env_observation_height(const ArcadeEnv* env);
+
+/* size x observation_size observations, size rewards and size done flags */
+ARCADE_ENV_API void arcade_env_set_buffers(ArcadeEnv* env, void* observations, float* rewards, uint8_t* dones);
+
+ARCADE_ENV_API void arcade_env_reset(ArcadeEnv* env);
+
+/* One tick of every copy; actions holds one action per copy */
+ARCADE_ENV_API void arcade_env_step(ArcadeEnv* env, const int* actions);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,142 @@
+#include "attract_mode.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+// Owed ticks are capped, so previews slow down rather than pile up work
+// when the budget keeps running out
+const double MAX_TICKS_DUE = 4.0;
+const double MAX_PAUSE_SECONDS = 0.25;
+
+} // namespace
+
+AttractMode::AttractMode(SDL_Renderer* renderer)
+    : renderer(renderer), next(0), lastUpdate(0), rng(static_cast<Uint32>(SDL_GetPerformanceCounter())), updates(0),
+      ticks(0), paints(0), totalMicros(0), peakMicros(0) {}
+
+AttractMode::~AttractMode() {
+    for (Preview& preview : previews) {
+        delete preview.game;
+        if (preview.texture) SDL_DestroyTexture(preview.texture);
+    }
+    if (!updates) return;
+    std::cout << "Attract mode: " << previews.size() << " previews, " << ticks << " ticks and " << paints
+              << " thumbnails in " << updates << " menu frames, " << totalMicros / updates << " us average, "
+              << peakMicros << " us peak of a " << BUDGET_MICROS << " us budget" << std::endl;
+}
+
+void AttractMode::add(const GameEnvSpec& spec, const SDL_Rect& area) {
+    Preview preview;
+    preview.spec = spec;
+    preview.game = spec.create();
+    preview.area = area;
+    preview.texture = nullptr;
+    preview.painted = false;
+    preview.state.resize(spec.stateSize);
+    preview.ticksDue = 0;
+    preview.paintsDue = 1; // Something to show on the first frame
+    preview.action = 0;
+    preview.actionTicks = 0;
+    preview.game->reset(rng.next());
+    previews.push_back(preview);
+}
+
+void AttractMode::step(Preview& preview) {
+    int action = 0;
+    if (preview.spec.autoplay) {
+        preview.game->observe(preview.state.data());
+        action = preview.spec.autoplay(preview.state.data());
+    } else {
+        if (preview.actionTicks <= 0) {
+            preview.action = rng.below(preview.spec.actionCount);
+            preview.actionTicks = 8 + rng.below(32);
+        }
+        preview.actionTicks--;
+        action = preview.action;
+    }
+    preview.game->step(action);
+    if (preview.game->done()) preview.game->reset(rng.next());
+    ticks++;
+}
+
+// The snapshot scaled down into the preview's texture. Drawn straight
+// from the rect lists: the painter's layer cache would cost more than it
+// saves at this size and rate.
+void AttractMode::paint(Preview& preview) {
+    if (!preview.texture) {
+        preview.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, preview.area.w,
+                                            preview.area.h);
+        if (!preview.texture) return;
+    }
+    preview.game->snapshot(preview.frame);
+
+    SDL_Texture* target = SDL_GetRenderTarget(renderer);
+    SDL_SetRenderTarget(renderer, preview.texture);
+    SDL_RenderSetScale(renderer, static_cast<float>(preview.area.w) / preview.spec.screenWidth,
+                       static_cast<float>(preview.area.h) / preview.spec.screenHeight);
+    const SDL_Color& background = preview.frame.background;
+    SDL_SetRenderDrawColor(renderer, background.r, background.g, background.b, 255);
+    SDL_RenderClear(renderer);
+    preview.frame.layer.draw(renderer);
+    preview.frame.shapes.draw(renderer);
+    if (preview.frame.indexCount > 0) {
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+        SDL_RenderGeometry(renderer, nullptr, preview.frame.vertices.data(),
+                           static_cast<int>(preview.frame.vertices.size()), preview.frame.indices,
+                           preview.frame.indexCount);
+    }
+    SDL_RenderSetScale(renderer, 1.0f, 1.0f);
+    SDL_SetRenderTarget(renderer, target);
+    preview.painted = true;
+    paints++;
+}
+
+void AttractMode::update() {
+    if (previews.empty()) return;
+    Uint64 start = SDL_GetPerformanceCounter();
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    double seconds = lastUpdate ? std::min(static_cast<double>(start - lastUpdate) / frequency, MAX_PAUSE_SECONDS) : 0.0;
+    lastUpdate = start;
+    for (Preview& preview : previews) {
+        preview.ticksDue = std::min(preview.ticksDue + seconds * TICKS_PER_SECOND, MAX_TICKS_DUE);
+        preview.paintsDue = std::min(preview.paintsDue + seconds * FRAMES_PER_SECOND, 1.0);
+    }
+
+    // Round the previews from where the last frame ran out of time
+    Uint64 budget = frequency * BUDGET_MICROS / 1000000;
+    for (size_t k = 0; k < previews.size(); ++k) {
+        size_t index = (next + k) % previews.size();
+        Preview& preview = previews[index];
+        for (; preview.ticksDue >= 1.0; preview.ticksDue -= 1.0) step(preview);
+        if (preview.paintsDue >= 1.0) {
+            paint(preview);
+            preview.paintsDue = 0;
+        }
+        if (SDL_GetPerformanceCounter() - start > budget) {
+            next = (index + 1) % previews.size();
+            break;
+        }
+    }
+
+    double micros = static_cast<double>(SDL_GetPerformanceCounter() - start) * 1e6 / frequency;
+    updates++;
+    totalMicros += micros;
+    if (micros > peakMicros) peakMicros = micros;
+}
+
+void AttractMode::draw() {
+    for (const Preview& preview : previews) {
+        if (preview.painted) SDL_RenderCopy(renderer, preview.texture, nullptr, &preview.area);
+    }
+}
+
+void AttractMode::invalidate() {
+    // Textures may be gone with the device; made again on the next paint
+    for (Preview& preview : previews) {
+        if (preview.texture) SDL_DestroyTexture(preview.texture);
+        preview.texture = nullptr;
+        preview.painted = false;
+        preview.paintsDue = 1;
+    }
+}
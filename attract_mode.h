@@ -0,0 +1,66 @@
+#ifndef ATTRACT_MODE_H
+#define ATTRACT_MODE_H
+
+#include <SDL.h>
+#include <vector>
+#include "game_env.h"
+#include "rng.h"
+
+// Live thumbnails of the games playing themselves, for the menu. Each
+// preview is a headless GameEnv (game_env.h) steered by its game's
+// autoplay policy, or at random without one. Previews tick at half the
+// games' rate and are drawn into their own small target texture a few
+// times a second; the menu copies the textures every frame. update() stops
+// for the frame once it has used BUDGET_MICROS, and the previews that
+// missed out go first next time.
+class AttractMode {
+public:
+    static const int TICKS_PER_SECOND = 30;
+    static const int FRAMES_PER_SECOND = 15;   // Thumbnail redraws
+    static const int BUDGET_MICROS = 2000;     // Per menu frame, an eighth of one at 60 Hz
+
+    explicit AttractMode(SDL_Renderer* renderer);
+    ~AttractMode();
+
+    // A preview of the game, drawn into area of the menu
+    void add(const GameEnvSpec& spec, const SDL_Rect& area);
+
+    // Plays the ticks and redraws the thumbnails that are due
+    void update();
+
+    // Copies the thumbnails to the menu
+    void draw();
+
+    // Carries on from here after a pause, such as a hidden window or a game
+    // being played, without catching up
+    void resume() { lastUpdate = 0; }
+
+    // Call on SDL_RENDER_TARGETS_RESET or SDL_RENDER_DEVICE_RESET
+    void invalidate();
+
+private:
+    struct Preview {
+        GameEnvSpec spec;
+        GameEnv* game;
+        SDL_Rect area;
+        SDL_Texture* texture;
+        bool painted;            // texture holds a picture
+        std::vector<float> state;
+        RenderSnapshot frame;
+        double ticksDue, paintsDue;
+        int action, actionTicks; // Random play holds an action for a while
+    };
+
+    void step(Preview& preview);
+    void paint(Preview& preview);
+
+    SDL_Renderer* renderer;
+    std::vector<Preview> previews;
+    size_t next;                 // Served first on the next update
+    Uint64 lastUpdate;
+    Rng rng;
+    long long updates, ticks, paints;
+    double totalMicros, peakMicros;
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include "batched_env.h"
+#include <algorithm>
+#include <iostream>
+#include "rng.h"
+
+namespace {
+
+Uint8 grey(const SDL_Color& c) {
+    return static_cast<Uint8>((c.r * 77 + c.g * 150 + c.b * 29) >> 8);
+}
+
+// The rects of a snapshot in grey at 1/scale size. A rect covers every
+// pixel it touches, so thin shapes such as Pong's centre line stay
+// visible. Outlines and the blended geometry are decoration and left out.
+void drawList(const RectList& list, int scale, int width, int height, Uint8* out) {
+    const std::vector<SDL_Rect>& rects = list.getRects();
+    for (const RectBatch& batch : list.getBatches()) {
+        if (!batch.filled) continue;
+        Uint8 value = grey(batch.color);
+        for (int k = batch.first; k < batch.first + batch.count; ++k) {
+            const SDL_Rect& r = rects[k];
+            if (r.w <= 0 || r.h <= 0) continue;
+            int x0 = std::max(r.x / scale, 0), x1 = std::min((r.x + r.w + scale - 1) / scale, width);
+            int y0 = std::max(r.y / scale, 0), y1 = std::min((r.y + r.h + scale - 1) / scale, height);
+            for (int y = y0; y < y1; ++y) std::fill(out + y * width + x0, out + y * width + std::max(x0, x1), value);
+        }
+    }
+}
+
+// Spreads the copy number and episode over the whole seed
+Uint32 mixSeed(Uint32 seed, int index, Uint32 episode) {
+    Uint32 h = seed ^ (static_cast<Uint32>(index) * 0x9e3779b9u) ^ (episode * 0x85ebca6bu);
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+} // namespace
+
+BatchedEnv::BatchedEnv(const GameEnvSpec& spec, int count, EnvObservation observation, int pixelScale,
+                       int maxEpisodeSteps, Uint32 seed, int threads)
+    : spec(spec), observation(observation), scale(pixelScale > 0 ? pixelScale : 1),
+      pixelWidth((spec.screenWidth + scale - 1) / scale), pixelHeight((spec.screenHeight + scale - 1) / scale),
+      maxSteps(maxEpisodeSteps), games(count > 0 ? count : 0), seed(seed), pool(threads), stateOut(nullptr),
+      pixelOut(nullptr), rewardOut(nullptr), doneOut(nullptr) {
+    for (Copy& copy : games) {
+        copy.game = spec.create();
+        copy.steps = 0;
+        copy.episodes = 0;
+    }
+    // Enough pieces to even out copies whose ticks cost more, few enough
+    // that handing them out stays cheap
+    chunk = std::max(1, size() / (pool.threads() * 8));
+}
+
+BatchedEnv::~BatchedEnv() {
+    for (Copy& copy : games) delete copy.game;
+}
+
+int BatchedEnv::observationSize() const {
+    return observation == ENV_OBSERVE_STATE ? spec.stateSize : pixelWidth * pixelHeight;
+}
+
+void BatchedEnv::setBuffers(void* observations, float* rewards, Uint8* dones) {
+    stateOut = observation == ENV_OBSERVE_STATE ? static_cast<float*>(observations) : nullptr;
+    pixelOut = observation == ENV_OBSERVE_PIXELS ? static_cast<Uint8*>(observations) : nullptr;
+    rewardOut = rewards;
+    doneOut = dones;
+}
+
+void BatchedEnv::observe(int index) {
+    Copy& copy = games[index];
+    if (stateOut) {
+        copy.game->observe(stateOut + static_cast<size_t>(index) * spec.stateSize);
+    } else if (pixelOut) {
+        Uint8* out = pixelOut + static_cast<size_t>(index) * pixelWidth * pixelHeight;
+        copy.game->snapshot(copy.frame);
+        std::fill(out, out + pixelWidth * pixelHeight, grey(copy.frame.background));
+        drawList(copy.frame.layer, scale, pixelWidth, pixelHeight, out);
+        drawList(copy.frame.shapes, scale, pixelWidth, pixelHeight, out);
+    }
+}
+
+void BatchedEnv::resetCopy(int index) {
+    Copy& copy = games[index];
+    copy.game->reset(mixSeed(seed, index, copy.episodes++));
+    copy.steps = 0;
+}
+
+void BatchedEnv::reset() {
+    int pieces = (size() + chunk - 1) / chunk;
+    pool.run(pieces, [this](int piece) {
+        int end = std::min(size(), (piece + 1) * chunk);
+        for (int i = piece * chunk; i < end; ++i) {
+            resetCopy(i);
+            if (rewardOut) rewardOut[i] = 0.0f;
+            if (doneOut) doneOut[i] = 0;
+            observe(i);
+        }
+    });
+}
+
+void BatchedEnv::step(const int* actions) {
+    int pieces = (size() + chunk - 1) / chunk;
+    pool.run(pieces, [this, actions](int piece) {
+        int end = std::min(size(), (piece + 1) * chunk);
+        for (int i = piece * chunk; i < end; ++i) {
+            Copy& copy = games[i];
+            float reward = copy.game->step(actions[i]);
+            copy.steps++;
+            bool done = copy.game->done() || (maxSteps > 0 && copy.steps >= maxSteps);
+            if (done) resetCopy(i);
+            if (rewardOut) rewardOut[i] = reward;
+            if (doneOut) doneOut[i] = done ? 1 : 0;
+            observe(i);
+        }
+    });
+}
+
+void benchmarkBatchedEnv(const char* gameName, const GameEnvSpec& spec, int count, int steps, EnvObservation observation) {
+    if (count <= 0 || steps <= 0) return;
+    BatchedEnv env(spec, count, observation);
+    std::vector<float> states(observation == ENV_OBSERVE_STATE ? static_cast<size_t>(count) * env.observationSize() : 0);
+    std::vector<Uint8> pixels(observation == ENV_OBSERVE_PIXELS ? static_cast<size_t>(count) * env.observationSize() : 0);
+    std::vector<float> rewards(count);
+    std::vector<Uint8> dones(count);
+    env.setBuffers(states.empty() ? static_cast<void*>(pixels.data()) : states.data(), rewards.data(), dones.data());
+    env.reset();
+
+    // Random actions, drawn ahead so only stepping is timed
+    Rng rng(7);
+    std::vector<int> actions(static_cast<size_t>(count) * 64);
+    for (int& action : actions) action = rng.below(spec.actionCount);
+
+    long long episodes = 0;
+    double points = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int s = 0; s < steps; ++s) {
+        env.step(&actions[static_cast<size_t>(s % 64) * count]);
+        for (int i = 0; i < count; ++i) {
+            episodes += dones[i];
+            points += rewards[i];
+        }
+    }
+    double seconds = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    double total = static_cast<double>(count) * steps;
+    std::cout << gameName << " env: " << count << " copies x " << steps << " steps on " << env.threads() << " threads with "
+              << (observation == ENV_OBSERVE_STATE ? "state" : "pixel") << " observations of " << env.observationSize()
+              << " values, " << static_cast<long long>(total / seconds) << " steps/s, " << episodes << " episodes ended, "
+              << points / total << " points per step" << std::endl;
+}
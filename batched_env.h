@@ -0,0 +1,78 @@
+#ifndef BATCHED_ENV_H
+#define BATCHED_ENV_H
+
+#include <SDL.h>
+#include <vector>
+#include "game_env.h"
+#include "thread_pool.h"
+
+enum EnvObservation {
+    ENV_OBSERVE_STATE,   // The game's state vector, GameEnvSpec::stateSize floats
+    ENV_OBSERVE_PIXELS   // Its picture in grey, one byte per pixel, scaled down
+};
+
+// Many headless copies of one game stepped together for training agents.
+// step() plays one tick of every copy, spread over a ThreadPool, and each
+// copy writes its observation, reward and done flag straight into the
+// caller's arrays, so nothing is copied afterwards. A copy whose episode
+// ends is reset at once: its done flag is set and its observation is
+// already the first of the next episode.
+class BatchedEnv {
+public:
+    // pixelScale is screen pixels per observation pixel along each side.
+    // Copies stop after maxEpisodeSteps steps when that is above 0. threads
+    // as for ThreadPool.
+    BatchedEnv(const GameEnvSpec& spec, int count, EnvObservation observation, int pixelScale = 8,
+               int maxEpisodeSteps = 0, Uint32 seed = 1, int threads = 0);
+    ~BatchedEnv();
+
+    int size() const { return static_cast<int>(games.size()); }
+    int actionCount() const { return spec.actionCount; }
+    int threads() const { return pool.threads(); }
+
+    // Values per copy: floats for states, bytes for pixels
+    int observationSize() const;
+    int observationWidth() const { return pixelWidth; }
+    int observationHeight() const { return pixelHeight; }
+
+    // size() * observationSize() observations and size() rewards and done
+    // flags. The arrays must stay valid while the env uses them.
+    void setBuffers(void* observations, float* rewards, Uint8* dones);
+
+    // Starts a new episode in every copy and writes the observations
+    void reset();
+
+    // One tick of every copy with actions[i] for copy i
+    void step(const int* actions);
+
+private:
+    struct Copy {
+        GameEnv* game;
+        RenderSnapshot frame;   // Pixel observations only
+        int steps;              // In this episode
+        Uint32 episodes;
+    };
+
+    void observe(int index);
+    void resetCopy(int index);
+
+    GameEnvSpec spec;
+    EnvObservation observation;
+    int scale;
+    int pixelWidth, pixelHeight;
+    int maxSteps;
+    std::vector<Copy> games;
+    Uint32 seed;
+    ThreadPool pool;
+    int chunk;                  // Copies per piece of work
+    float* stateOut;
+    Uint8* pixelOut;
+    float* rewardOut;
+    Uint8* doneOut;
+};
+
+// Steps copies of the game with random actions on every CPU and prints
+// steps per second
+void benchmarkBatchedEnv(const char* gameName, const GameEnvSpec& spec, int count, int steps, EnvObservation observation);
+
+#endif
@@ -1,55 +1,244 @@
-//#include "brick_breaker.h"
+#include "brick_breaker.h"
 #include <SDL.h>
 #include <SDL_ttf.h>
 #include <iostream>
 #include <vector>
 #include <ctime>
 #include <cstdlib>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include "level_format.h"
+#include "mapped_file.h"
+#include "event_log.h"
+#include "leaderboard.h"
+#include "save_state.h"
+#include "rewind_buffer.h"
+#include "video_capture.h"
+#include "frame_pipeline.h"
+#include "simulation.h"
+#include "soft_raster.h"
+#include "rng.h"
+#include "game_module.h"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// Arena Class
+// Bump allocator for everything that lives as long as a level. Allocation is
+// a pointer increment and a new level frees it all at once with reset(). If a
+// level needed more than the block holds, the block grows on the next reset.
+class Arena {
+private:
+    std::vector<unsigned char> block;
+    size_t used;
+    size_t highWater;
 
-// GameObject Base Class
-class GameObject {
-protected:
-    int x, y;
-    SDL_Renderer* renderer;
+public:
+    Arena(size_t capacity) : block(capacity), used(0), highWater(0) {}
+
+    template <typename T>
+    T* allocate(size_t count) {
+        size_t alignment = alignof(T);
+        size_t start = (used + alignment - 1) & ~(alignment - 1);
+        size_t end = start + sizeof(T) * count;
+        highWater = std::max(highWater, end);
+        if (end > block.size()) {
+            // Only the first load of a bigger level gets here; reset() then
+            // grows the block so later loads stay inside it.
+            std::cerr << "Arena exhausted, level needs " << end << " bytes" << std::endl;
+            return nullptr;
+        }
+        used = end;
+        return reinterpret_cast<T*>(&block[start]);
+    }
+
+    void reset() {
+        if (highWater > block.size()) {
+            block.assign(highWater + highWater / 2, 0);
+        }
+        used = 0;
+        highWater = 0;
+    }
+
+    // Makes sure a level of known size fits without a failed first attempt
+    void reserve(size_t bytes) {
+        highWater = std::max(highWater, bytes);
+        reset();
+    }
+};
 
+// BrickPool Class
+// Bricks stored as parallel arrays so that collision and drawing loops walk
+// contiguous memory instead of chasing pointers to individual objects. For a
+// level loaded from a file the geometry arrays point straight into the
+// mapped file; hit points and alive flags always live in the arena.
+class BrickPool {
 public:
-    GameObject(int x, int y, SDL_Renderer* renderer) : x(x), y(y), renderer(renderer) {}
+    int* x;
+    int* y;
+    int* width;
+    int* height;
+    Uint8* colorIndex;
+    Uint8* flags;      // LEVEL_BRICK_MULTIBALL: breaking it splits the ball
+    const SDL_Color* palette;
+    int paletteCount;
+    Uint8* hitPoints;
+    Uint8* alive;
+    int count;
+    int liveCount;
+    int capacity;
+
+    BrickPool() : x(nullptr), y(nullptr), width(nullptr), height(nullptr), colorIndex(nullptr), flags(nullptr),
+                  palette(nullptr), paletteCount(0), hitPoints(nullptr), alive(nullptr), count(0), liveCount(0), capacity(0) {}
+
+    static size_t bytesFor(int bricks) {
+        return bricks * (4 * sizeof(int) + 4 * sizeof(Uint8)) + 64;
+    }
+
+    bool allocate(Arena& arena, int newCapacity, const SDL_Color* newPalette, int newPaletteCount) {
+        x = arena.allocate<int>(newCapacity);
+        y = arena.allocate<int>(newCapacity);
+        width = arena.allocate<int>(newCapacity);
+        height = arena.allocate<int>(newCapacity);
+        colorIndex = arena.allocate<Uint8>(newCapacity);
+        flags = arena.allocate<Uint8>(newCapacity);
+        hitPoints = arena.allocate<Uint8>(newCapacity);
+        alive = arena.allocate<Uint8>(newCapacity);
+        palette = newPalette;
+        paletteCount = newPaletteCount;
+        count = liveCount = 0;
+        capacity = (x && y && width && height && colorIndex && flags && hitPoints && alive) ? newCapacity : 0;
+        return capacity == newCapacity;
+    }
 
-    virtual void draw() = 0;
-    virtual void update() {}
+    // Uses a validated level file in place
+    bool attach(Arena& arena, const LevelHeader& header, unsigned char* data) {
+        count = capacity = static_cast<int>(header.brickCount);
+        x = reinterpret_cast<int*>(data + header.xOffset);
+        y = reinterpret_cast<int*>(data + header.yOffset);
+        width = reinterpret_cast<int*>(data + header.widthOffset);
+        height = reinterpret_cast<int*>(data + header.heightOffset);
+        colorIndex = data + header.colorOffset;
+        flags = data + header.flagsOffset;
+        palette = reinterpret_cast<const SDL_Color*>(data + header.paletteOffset); // RGBA, same layout
+        paletteCount = static_cast<int>(header.paletteCount);
+        hitPoints = arena.allocate<Uint8>(count);
+        alive = arena.allocate<Uint8>(count);
+        if (!hitPoints || !alive) return false;
+        memcpy(hitPoints, data + header.hitPointsOffset, count);
+        memset(alive, 1, count);
+        liveCount = count;
+        return true;
+    }
+
+    int add(int bx, int by, int bw, int bh, Uint8 color, Uint8 brickFlags) {
+        if (count >= capacity) return -1;
+        x[count] = bx;
+        y[count] = by;
+        width[count] = bw;
+        height[count] = bh;
+        colorIndex[count] = color;
+        flags[count] = brickFlags;
+        hitPoints[count] = 1;
+        alive[count] = 1;
+        liveCount++;
+        return count++;
+    }
+
+    void kill(int index) {
+        alive[index] = 0;
+        liveCount--;
+    }
+
+    SDL_Rect rect(int index) const {
+        return SDL_Rect{ x[index], y[index], width[index], height[index] };
+    }
+
+    void snapshot(RectList& out) const {
+        for (int i = 0; i < count; ++i) {
+            if (!alive[i]) continue;
+            out.add(rect(i), palette[colorIndex[i]]);
+        }
+    }
 };
 
-// Brick Class
-class Brick : public GameObject {
-private:
-    int width, height;
-    SDL_Color color;
-    bool visible;
+// BallPool Class
+// Balls in parallel arrays, same layout idea as the bricks. Positions and
+// speeds are in 1/256ths of a pixel so balls can move at fractional speeds;
+// every ball has the same radius, which keeps the batched tests simple.
+const int SUBPIXEL = 256;
 
+class BallPool {
 public:
-    Brick(int x, int y, int width, int height, SDL_Color color, SDL_Renderer* renderer)
-        : GameObject(x, y, renderer), width(width), height(height), color(color), visible(true) {}
+    int* x;
+    int* y;
+    int* speedX;
+    int* speedY;
+    int radius;  // pixels
+    int count;
+    int capacity;
+
+    BallPool() : x(nullptr), y(nullptr), speedX(nullptr), speedY(nullptr), radius(10), count(0), capacity(0) {}
+
+    static size_t bytesFor(int balls) {
+        return (balls + 3) * 4 * sizeof(int) + 64;
+    }
 
-    void draw() override {
-        if (visible) {
-            SDL_Rect rect = { x, y, width, height };
-            SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-            SDL_RenderFillRect(renderer, &rect);
-        }
+    bool allocate(Arena& arena, int newCapacity) {
+        int padded = (newCapacity + 3) & ~3; // Whole batches of four for the SIMD loop
+        x = arena.allocate<int>(padded);
+        y = arena.allocate<int>(padded);
+        speedX = arena.allocate<int>(padded);
+        speedY = arena.allocate<int>(padded);
+        count = 0;
+        capacity = (x && y && speedX && speedY) ? newCapacity : 0;
+        return capacity == newCapacity;
     }
 
-    bool isVisible() const { return visible; }
-    void setVisible(bool v) { visible = v; }
+    int add(int fx, int fy, int sx, int sy) {
+        if (count >= capacity) return -1;
+        x[count] = fx;
+        y[count] = fy;
+        speedX[count] = sx;
+        speedY[count] = sy;
+        return count++;
+    }
 
-    int getX() const { return x; }
-    int getY() const { return y; }
-    int getWidth() const { return width; }
-    int getHeight() const { return height; }
+    int pixelX(int index) const { return x[index] / SUBPIXEL; }
+    int pixelY(int index) const { return y[index] / SUBPIXEL; }
+
+    SDL_Rect bounds(int index) const {
+        return SDL_Rect{ pixelX(index) - radius, pixelY(index) - radius, 2 * radius, 2 * radius };
+    }
+
+    // Drops balls that fell past the bottom, keeping the rest in order
+    int removeOutOfBounds(int screenHeight) {
+        int kept = 0;
+        for (int i = 0; i < count; ++i) {
+            if (pixelY(i) - radius > screenHeight) continue;
+            x[kept] = x[i];
+            y[kept] = y[i];
+            speedX[kept] = speedX[i];
+            speedY[kept] = speedY[i];
+            kept++;
+        }
+        int removed = count - kept;
+        count = kept;
+        return removed;
+    }
+
+    void snapshot(RectList& out) const {
+        const SDL_Color white = {255, 255, 255, 255};
+        for (int i = 0; i < count; ++i) out.add(bounds(i), white);
+    }
 };
 
 // Paddle Class
-class Paddle : public GameObject {
+class Paddle {
 private:
+    int x, y;
     int width, height;
     int maxSpeed;  // Maximum speed
     int screenWidth;
@@ -57,17 +246,28 @@ private:
     int velocity;
 
 public:
-    Paddle(int x, int y, int width, int height, int maxSpeed, int screenWidth, SDL_Renderer* renderer, SDL_Scancode leftKey, SDL_Scancode rightKey)
-        : GameObject(x, y, renderer), width(width), height(height), maxSpeed(maxSpeed), screenWidth(screenWidth), leftKey(leftKey), rightKey(rightKey), velocity(0) {}
+    Paddle(int x, int y, int width, int height, int maxSpeed, int screenWidth, SDL_Scancode leftKey, SDL_Scancode rightKey)
+        : x(x), y(y), width(width), height(height), maxSpeed(maxSpeed), screenWidth(screenWidth), leftKey(leftKey), rightKey(rightKey), velocity(0) {}
 
     int getX() const { return x; }
     int getWidth() const { return width; }
     int getHeight() const { return height; }
+    int getVelocity() const { return velocity; }
+    int getMaxSpeed() const { return maxSpeed; }
+
+    void setMotion(int newX, int newVelocity) {
+        x = newX;
+        velocity = newVelocity;
+    }
 
     void handleInput(const Uint8* keystate) {
-        if (keystate[leftKey]) {
+        steer(keystate[leftKey] != 0, keystate[rightKey] != 0);
+    }
+
+    void steer(bool left, bool right) {
+        if (left) {
             velocity = std::max(velocity - 1, -maxSpeed); // Smaller decrement for finer control
-        } else if (keystate[rightKey]) {
+        } else if (right) {
             velocity = std::min(velocity + 1, maxSpeed); // Smaller increment for finer control
         } else {
             // Gradually reduce velocity to zero when no key is pressed
@@ -94,95 +294,476 @@ public:
         return y;
     }
 
-    void draw() override {
-        SDL_Rect rect = getRect();
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-        SDL_RenderFillRect(renderer, &rect);
+    void snapshot(RectList& out) const {
+        const SDL_Color white = {255, 255, 255, 255};
+        out.add(getRect(), white);
     }
 };
 
-// Ball Class
-class Ball : public GameObject {
-private:
-    int radius;
-    static const int BALL_SPEED_X = 1; // Consistent and slower speed
-    static const int BALL_SPEED_Y = 1;  // Cons
-    int speedX, speedY;
-    int screenWidth, screenHeight;
+// Ball physics over the whole BallPool
+namespace BallPhysics {
+    const int BALL_SPEED_X = SUBPIXEL; // Consistent and slower speed
+    const int BALL_SPEED_Y = SUBPIXEL;
+
+    // Play field and paddle in subpixel units, shared by both integrators
+    struct Bounds {
+        int radius;
+        int right;          // x + radius at or past this bounces
+        int bottom;         // only used when the floor is solid
+        int paddleLeft, paddleRight, paddleTop, paddleBottom;
+        bool solidFloor;
+    };
+
+    Bounds makeBounds(const BallPool& balls, const Paddle& paddle, int screenWidth, int screenHeight, bool solidFloor) {
+        SDL_Rect p = paddle.getRect();
+        Bounds b;
+        b.radius = balls.radius * SUBPIXEL;
+        b.right = screenWidth * SUBPIXEL;
+        b.bottom = screenHeight * SUBPIXEL;
+        b.paddleLeft = p.x * SUBPIXEL;
+        b.paddleRight = (p.x + p.w) * SUBPIXEL;
+        b.paddleTop = p.y * SUBPIXEL;
+        b.paddleBottom = (p.y + p.h) * SUBPIXEL;
+        b.solidFloor = solidFloor;
+        return b;
+    }
+
+    inline void integrateOne(BallPool& balls, int i, const Bounds& b) {
+        int x = balls.x[i] + balls.speedX[i];
+        int y = balls.y[i] + balls.speedY[i];
+        balls.x[i] = x;
+        balls.y[i] = y;
+
+        if (x - b.radius <= 0 || x + b.radius >= b.right) {
+            balls.speedX[i] = -balls.speedX[i];
+        }
+        if (y - b.radius <= 0) {
+            balls.speedY[i] = -balls.speedY[i];
+        }
+        if (b.solidFloor && y + b.radius >= b.bottom) {
+            balls.speedY[i] = -abs(balls.speedY[i]);
+        }
+        if (x + b.radius > b.paddleLeft && x - b.radius < b.paddleRight &&
+            y + b.radius > b.paddleTop && y - b.radius < b.paddleBottom) {
+            balls.speedY[i] = -abs(balls.speedY[i]);
+        }
+    }
+
+    // Moves every ball one tick and bounces it off the walls and the paddle.
+    // With SSE2 four balls are handled per iteration using compare masks in
+    // place of branches; the scalar path gives bit-identical results.
+    void integrate(BallPool& balls, const Bounds& b) {
+        int i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+        const __m128i radius = _mm_set1_epi32(b.radius);
+        const __m128i one = _mm_set1_epi32(1);
+        const __m128i right = _mm_set1_epi32(b.right - 1);
+        const __m128i bottom = _mm_set1_epi32(b.bottom - 1);
+        const __m128i floorOn = _mm_set1_epi32(b.solidFloor ? -1 : 0);
+        const __m128i paddleLeft = _mm_set1_epi32(b.paddleLeft);
+        const __m128i paddleRight = _mm_set1_epi32(b.paddleRight);
+        const __m128i paddleTop = _mm_set1_epi32(b.paddleTop);
+        const __m128i paddleBottom = _mm_set1_epi32(b.paddleBottom);
+        const __m128i zero = _mm_setzero_si128();
+
+        for (; i + 4 <= balls.count; i += 4) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(balls.x + i));
+            __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(balls.y + i));
+            __m128i vx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(balls.speedX + i));
+            __m128i vy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(balls.speedY + i));
+
+            x = _mm_add_epi32(x, vx);
+            y = _mm_add_epi32(y, vy);
+            __m128i left = _mm_sub_epi32(x, radius);
+            __m128i rightEdge = _mm_add_epi32(x, radius);
+            __m128i top = _mm_sub_epi32(y, radius);
+            __m128i bottomEdge = _mm_add_epi32(y, radius);
+
+            // Negating where a mask is all ones: (v ^ m) - m
+            __m128i hitSide = _mm_or_si128(_mm_cmplt_epi32(left, one), _mm_cmpgt_epi32(rightEdge, right));
+            vx = _mm_sub_epi32(_mm_xor_si128(vx, hitSide), hitSide);
+            __m128i hitTop = _mm_cmplt_epi32(top, one);
+            vy = _mm_sub_epi32(_mm_xor_si128(vy, hitTop), hitTop);
+
+            // Floor and paddle both send the ball up: speedY = -abs(speedY)
+            __m128i hitFloor = _mm_and_si128(floorOn, _mm_cmpgt_epi32(bottomEdge, bottom));
+            __m128i hitPaddle = _mm_and_si128(
+                _mm_and_si128(_mm_cmpgt_epi32(rightEdge, paddleLeft), _mm_cmplt_epi32(left, paddleRight)),
+                _mm_and_si128(_mm_cmpgt_epi32(bottomEdge, paddleTop), _mm_cmplt_epi32(top, paddleBottom)));
+            __m128i goUp = _mm_or_si128(hitFloor, hitPaddle);
+            __m128i sign = _mm_srai_epi32(vy, 31);
+            __m128i up = _mm_sub_epi32(zero, _mm_sub_epi32(_mm_xor_si128(vy, sign), sign));
+            vy = _mm_or_si128(_mm_and_si128(goUp, up), _mm_andnot_si128(goUp, vy));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(balls.x + i), x);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(balls.y + i), y);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(balls.speedX + i), vx);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(balls.speedY + i), vy);
+        }
+#endif
+        for (; i < balls.count; ++i) {
+            integrateOne(balls, i, b);
+        }
+    }
 
+    // Balls that reached the top of the paddle this tick. integrate() has
+    // already turned them upward; a ball still overlapping on the following
+    // tick is not counted again because its previous bottom edge was below
+    // the paddle's top.
+    void paddleTouches(const BallPool& balls, const Bounds& b, std::vector<int>& out) {
+        out.clear();
+        for (int i = 0; i < balls.count; ++i) {
+            int x = balls.x[i], y = balls.y[i];
+            if (x + b.radius > b.paddleLeft && x - b.radius < b.paddleRight &&
+                y + b.radius > b.paddleTop && y - b.radius < b.paddleBottom &&
+                y + b.radius - abs(balls.speedY[i]) <= b.paddleTop) {
+                out.push_back(i);
+            }
+        }
+    }
+
+    // Circle against rect: closest point of the rect to the ball's centre
+    bool hitsBrick(const BallPool& balls, int i, const BrickPool& bricks, int b) {
+        int centerX = balls.pixelX(i);
+        int centerY = balls.pixelY(i);
+        int left = bricks.x[b], top = bricks.y[b];
+        int right = left + bricks.width[b], bottom = top + bricks.height[b];
+        int closestX = (centerX < left) ? left : (centerX > right) ? right : centerX;
+        int closestY = (centerY < top) ? top : (centerY > bottom) ? bottom : centerY;
+
+        int distanceX = centerX - closestX;
+        int distanceY = centerY - closestY;
+        return (distanceX * distanceX + distanceY * distanceY) < (balls.radius * balls.radius);
+    }
+
+    bool isCollisionHorizontal(const BallPool& balls, int i, const BrickPool& bricks, int b) {
+        int centerY = balls.pixelY(i);
+        return centerY > bricks.y[b] && centerY < bricks.y[b] + bricks.height[b];
+    }
+}
+
+// ParticlePool Class
+// Cosmetic debris and sparks. Storage is fixed when the game starts, so an
+// emission never allocates; when the pool is full or the last frame ran over
+// budget new particles are dropped rather than slowing the frame down.
+class ParticlePool {
 public:
-    Ball(int x, int y, int radius, int speedX, int speedY, int screenWidth, int screenHeight, SDL_Renderer* renderer)
-        : GameObject(x, y, renderer), radius(radius), speedX(BALL_SPEED_X), speedY(BALL_SPEED_Y), screenWidth(screenWidth), screenHeight(screenHeight) {}
-    int getRadius() const { return radius; }
-    void update(Paddle& paddle){
-        x += speedX;
-        y += speedY;
+    static const int CAPACITY = 4096;        // A multiple of four for the SIMD loop
+    static const int EMIT_PER_FRAME = 256;
+    static const int EMIT_WHEN_SLOW = 32;
+
+    ParticlePool(double budgetMicros, int capacity = CAPACITY)
+        : x(capacity), y(capacity), speedX(capacity), speedY(capacity), life(capacity), fade(capacity),
+          size(capacity), color(capacity), indices(capacity * 6), capacity(capacity),
+          count(0), emitAllowance(EMIT_PER_FRAME), seed(2463534242u), budgetMicros(budgetMicros),
+          frameMicros(0), totalMicros(0), peakMicros(0), frames(0), framesOverBudget(0), emitted(0), dropped(0) {
+        // Two triangles per quad; the index buffer never changes
+        for (int i = 0; i < capacity; ++i) {
+            int v = i * 4;
+            int* quad = &indices[i * 6];
+            quad[0] = v; quad[1] = v + 1; quad[2] = v + 2;
+            quad[3] = v + 2; quad[4] = v + 3; quad[5] = v;
+        }
+    }
+
+    // Chunks of the brick flying apart and falling
+    void emitDebris(const SDL_Rect& brick, SDL_Color brickColor) {
+        int n = reserve(12);
+        for (int k = 0; k < n; ++k) {
+            float px = brick.x + random01() * brick.w;
+            float py = brick.y + random01() * brick.h;
+            float vx = (px - (brick.x + brick.w * 0.5f)) / brick.w * 3.0f + (random01() - 0.5f);
+            float vy = -random01() * 2.0f;
+            add(px, py, vx, vy, 40.0f + random01() * 30.0f, 2.0f + random01() * 3.0f, brickColor);
+        }
+    }
+
+    // A short fan of sparks thrown up where a ball meets the paddle
+    void emitSparks(float px, float py) {
+        const SDL_Color spark = {255, 240, 160, 255};
+        int n = reserve(8);
+        for (int k = 0; k < n; ++k) {
+            add(px, py, (random01() - 0.5f) * 4.0f, -1.0f - random01() * 2.5f, 12.0f + random01() * 10.0f, 2.0f, spark);
+        }
+    }
 
-        if (x - radius <= 0 || x + radius >= screenWidth) {
-            speedX = -speedX;
+    // One tick of motion, gravity and ageing, then dead particles are swapped
+    // out. Times itself together with snapshot() against the frame budget.
+    void update() {
+        Uint64 start = SDL_GetPerformanceCounter();
+        const float gravity = 0.12f;
+        int i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+        const __m128 g = _mm_set1_ps(gravity);
+        const __m128 one = _mm_set1_ps(1.0f);
+        for (; i + 4 <= count; i += 4) {
+            __m128 vy = _mm_add_ps(_mm_loadu_ps(&speedY[i]), g);
+            _mm_storeu_ps(&x[i], _mm_add_ps(_mm_loadu_ps(&x[i]), _mm_loadu_ps(&speedX[i])));
+            _mm_storeu_ps(&y[i], _mm_add_ps(_mm_loadu_ps(&y[i]), vy));
+            _mm_storeu_ps(&speedY[i], vy);
+            _mm_storeu_ps(&life[i], _mm_sub_ps(_mm_loadu_ps(&life[i]), one));
         }
-        if (y - radius <= 0) {
-            speedY = -speedY;
+#endif
+        for (; i < count; ++i) {
+            speedY[i] += gravity;
+            x[i] += speedX[i];
+            y[i] += speedY[i];
+            life[i] -= 1.0f;
         }
 
-        if (collidesWith(paddle)) {
-            speedY = -abs(speedY);
+        for (i = 0; i < count;) {
+            if (life[i] > 0.0f) {
+                ++i;
+                continue;
+            }
+            --count;
+            x[i] = x[count]; y[i] = y[count];
+            speedX[i] = speedX[count]; speedY[i] = speedY[count];
+            life[i] = life[count]; fade[i] = fade[count];
+            size[i] = size[count]; color[i] = color[count];
         }
+        frameMicros = elapsedMicros(start);
     }
 
-    bool isCollisionHorizontal(const Brick& brick) {
-        int centerY = y;
-        return centerY > brick.getY() && centerY < brick.getY() + brick.getHeight();
+    // Every live particle as quads for one SDL_RenderGeometry call
+    void snapshot(RenderSnapshot& out) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        out.vertices.resize(count * 4);
+        for (int i = 0; i < count; ++i) {
+            float half = size[i] * 0.5f;
+            SDL_Color c = color[i];
+            float alpha = life[i] * fade[i];
+            c.a = static_cast<Uint8>(c.a * (alpha < 1.0f ? alpha : 1.0f));
+            SDL_Vertex* v = &out.vertices[i * 4];
+            v[0].position.x = x[i] - half; v[0].position.y = y[i] - half;
+            v[1].position.x = x[i] + half; v[1].position.y = y[i] - half;
+            v[2].position.x = x[i] + half; v[2].position.y = y[i] + half;
+            v[3].position.x = x[i] - half; v[3].position.y = y[i] + half;
+            for (int k = 0; k < 4; ++k) {
+                v[k].color = c;
+                v[k].tex_coord.x = v[k].tex_coord.y = 0.0f;
+            }
+        }
+        out.indices = indices.data();
+        out.indexCount = count * 6;
+        endFrame(frameMicros + elapsedMicros(start));
     }
 
-    void reverseXDirection() {
-        speedX = -speedX;
+    void printStats() const {
+        if (frames == 0) return;
+        std::cout << "Particles: " << totalMicros / frames << " us/frame average, " << peakMicros << " us peak, "
+                  << framesOverBudget << " of " << frames << " frames over the " << budgetMicros << " us budget, "
+                  << emitted << " emitted, " << dropped << " dropped" << std::endl;
     }
 
+    int getCount() const { return count; }
 
-    bool collidesWith(const Paddle& paddle) {
-        SDL_Rect paddleRect = paddle.getRect();
-        return x + radius > paddleRect.x && x - radius < paddleRect.x + paddleRect.w &&
-               y + radius > paddleRect.y && y - radius < paddleRect.y + paddleRect.h;
+private:
+    std::vector<float> x, y, speedX, speedY;
+    std::vector<float> life;  // Ticks left
+    std::vector<float> fade;  // 1 / ticks of fading at the end of life
+    std::vector<float> size;
+    std::vector<SDL_Color> color;
+    std::vector<int> indices;
+    int capacity;
+    int count;
+    int emitAllowance;        // Particles still allowed this frame
+    Uint32 seed;
+    double budgetMicros;
+    double frameMicros;
+    double totalMicros, peakMicros;
+    long long frames, framesOverBudget, emitted, dropped;
+
+    // How many of the wanted particles may be emitted; the rest are dropped
+    int reserve(int wanted) {
+        int n = std::min(wanted, std::min(emitAllowance, capacity - count));
+        emitAllowance -= n;
+        emitted += n;
+        dropped += wanted - n;
+        return n;
     }
-    bool collidesWith(const Brick& brick) {
-        if (!brick.isVisible()) return false;
 
-        int centerX = x;
-        int centerY = y;
-        int closestX = (centerX < brick.getX()) ? brick.getX() : (centerX > brick.getX() + brick.getWidth()) ? brick.getX() + brick.getWidth() : centerX;
-        int closestY = (centerY < brick.getY()) ? brick.getY() : (centerY > brick.getY() + brick.getHeight()) ? brick.getY() + brick.getHeight() : centerY;
+    void add(float px, float py, float vx, float vy, float ticks, float side, SDL_Color c) {
+        x[count] = px; y[count] = py;
+        speedX[count] = vx; speedY[count] = vy;
+        life[count] = ticks;
+        fade[count] = 1.0f / 15.0f;
+        size[count] = side;
+        color[count] = c;
+        count++;
+    }
 
-        int distanceX = centerX - closestX;
-        int distanceY = centerY - closestY;
+    void endFrame(double micros) {
+        totalMicros += micros;
+        if (micros > peakMicros) peakMicros = micros;
+        frames++;
+        bool overBudget = micros > budgetMicros;
+        if (overBudget) framesOverBudget++;
+        emitAllowance = overBudget ? EMIT_WHEN_SLOW : EMIT_PER_FRAME;
+    }
+
+    float random01() {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return (seed >> 8) * (1.0f / 16777216.0f);
+    }
+
+    static double elapsedMicros(Uint64 start) {
+        return static_cast<double>(SDL_GetPerformanceCounter() - start) * 1e6 / SDL_GetPerformanceFrequency();
+    }
+};
 
-        if ((distanceX * distanceX + distanceY * distanceY) < (radius * radius)) {
-            reverseYDirection();
-            return true;
+// Uniform grid over the play field. Each brick is listed in every cell its
+// rect touches, stored as one flat array with per-cell offsets. A ball only
+// tests the bricks in the few cells under it, so the cost of a collision
+// check does not grow with the number of bricks in the level.
+class BrickGrid {
+private:
+    int cellSize;
+    int columns, rows;
+    int* cellStart;   // first entry of each cell in cellBricks
+    int* cellCount;   // live entries in each cell
+    int* cellBricks;  // brick indices grouped by cell
+    unsigned* queryStamp; // per brick, to skip bricks seen in another cell
+    int stampCount;
+    unsigned currentQuery;
+    std::vector<int> candidates;
+
+    void cellRange(const SDL_Rect& rect, int& minX, int& minY, int& maxX, int& maxY) const {
+        levelCellRange(rect.x, rect.y, rect.w, rect.h, cellSize, columns, rows, minX, minY, maxX, maxY);
+    }
+
+public:
+    BrickGrid() : cellSize(1), columns(0), rows(0), cellStart(nullptr), cellCount(nullptr), cellBricks(nullptr),
+                  queryStamp(nullptr), stampCount(0), currentQuery(0) {}
+
+    static size_t bytesFor(const BrickPool& bricks, int width, int height, int cellSize) {
+        size_t cells = static_cast<size_t>(width / cellSize + 1) * (height / cellSize + 1);
+        // Worst case every brick straddles four cells
+        return (2 * cells + 1) * sizeof(int) + bricks.count * (4 * sizeof(int) + sizeof(unsigned)) + 64;
+    }
+
+    bool build(Arena& arena, const BrickPool& bricks, int width, int height, int newCellSize) {
+        cellSize = newCellSize;
+        columns = width / cellSize + 1;
+        rows = height / cellSize + 1;
+        int cells = columns * rows;
+        cellStart = arena.allocate<int>(cells + 1);
+        cellCount = arena.allocate<int>(cells);
+        queryStamp = arena.allocate<unsigned>(bricks.count);
+        if (!cellStart || !cellCount || !queryStamp) return false;
+        std::fill(cellStart, cellStart + cells + 1, 0);
+        std::fill(cellCount, cellCount + cells, 0);
+        stampCount = bricks.count;
+        std::fill(queryStamp, queryStamp + stampCount, 0u);
+        currentQuery = 0;
+        // A query never returns more than every brick; the room to spare
+        // covers the bigger levels that follow
+        if (candidates.capacity() < static_cast<size_t>(bricks.count)) candidates.reserve(2 * bricks.count);
+
+        // Count, prefix sum, then fill: a counting sort of bricks into cells
+        int minX, minY, maxX, maxY;
+        for (int i = 0; i < bricks.count; ++i) {
+            cellRange(bricks.rect(i), minX, minY, maxX, maxY);
+            for (int cy = minY; cy <= maxY; ++cy)
+                for (int cx = minX; cx <= maxX; ++cx)
+                    cellCount[cy * columns + cx]++;
+        }
+        for (int c = 0; c < cells; ++c) {
+            cellStart[c + 1] = cellStart[c] + cellCount[c];
+            cellCount[c] = 0;
+        }
+        cellBricks = arena.allocate<int>(cellStart[cells]);
+        if (!cellBricks) return false;
+        for (int i = 0; i < bricks.count; ++i) {
+            cellRange(bricks.rect(i), minX, minY, maxX, maxY);
+            for (int cy = minY; cy <= maxY; ++cy) {
+                for (int cx = minX; cx <= maxX; ++cx) {
+                    int cell = cy * columns + cx;
+                    cellBricks[cellStart[cell] + cellCount[cell]++] = i;
+                }
+            }
         }
-        return false;
+        return true;
     }
 
+    // Uses the grid prebuilt in a level file. Removals reorder the cell
+    // entries, which only touches our private copy of the mapped pages.
+    bool attach(Arena& arena, const LevelHeader& header, unsigned char* data) {
+        cellSize = header.cellSize;
+        columns = header.gridColumns;
+        rows = header.gridRows;
+        int cells = columns * rows;
+        cellStart = reinterpret_cast<int*>(data + header.cellStartOffset);
+        cellBricks = reinterpret_cast<int*>(data + header.cellBricksOffset);
+        cellCount = arena.allocate<int>(cells);
+        queryStamp = arena.allocate<unsigned>(header.brickCount);
+        if (!cellCount || !queryStamp) return false;
+        for (int c = 0; c < cells; ++c) cellCount[c] = cellStart[c + 1] - cellStart[c];
+        stampCount = static_cast<int>(header.brickCount);
+        std::fill(queryStamp, queryStamp + stampCount, 0u);
+        currentQuery = 0;
+        if (candidates.capacity() < header.brickCount) candidates.reserve(2 * header.brickCount);
+        return true;
+    }
 
-    void draw() override {
-        SDL_Rect rect = { x - radius, y - radius, 2 * radius, 2 * radius };
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-        SDL_RenderFillRect(renderer, &rect);
+    static size_t bytesFor(const LevelHeader& header) {
+        return (static_cast<size_t>(header.gridColumns) * header.gridRows) * sizeof(int) +
+               header.brickCount * sizeof(unsigned) + 64;
     }
 
-    void reverseYDirection() {
-        speedY = -speedY;
+    // Lists every brick again. Removal only reorders entries within a cell,
+    // so each cell still holds all of its bricks past its live count.
+    void restoreAll() {
+        int cells = columns * rows;
+        for (int c = 0; c < cells; ++c) cellCount[c] = cellStart[c + 1] - cellStart[c];
     }
 
-    bool isOutOfBounds(int screenHeight) {
-        return y - radius > screenHeight;
+    // Drops a destroyed brick from every cell it was listed in
+    void remove(int index, const BrickPool& bricks) {
+        int minX, minY, maxX, maxY;
+        cellRange(bricks.rect(index), minX, minY, maxX, maxY);
+        for (int cy = minY; cy <= maxY; ++cy) {
+            for (int cx = minX; cx <= maxX; ++cx) {
+                int cell = cy * columns + cx;
+                int* first = &cellBricks[cellStart[cell]];
+                int& count = cellCount[cell];
+                for (int k = 0; k < count; ++k) {
+                    if (first[k] == index) {
+                        first[k] = first[--count];
+                        break;
+                    }
+                }
+            }
+        }
     }
 
-    void reset(int newX, int newY) {
-        x = newX;
-        y = newY;
-        speedX = BALL_SPEED_X;
-        speedY = BALL_SPEED_Y;
+    // Live bricks whose cells overlap the area, in ascending index order so
+    // that results do not depend on removal history
+    const std::vector<int>& query(const SDL_Rect& area) {
+        candidates.clear();
+        if (++currentQuery == 0) {
+            // Old stamps could equal the restarted counter
+            std::fill(queryStamp, queryStamp + stampCount, 0u);
+            currentQuery = 1;
+        }
+        int minX, minY, maxX, maxY;
+        cellRange(area, minX, minY, maxX, maxY);
+        for (int cy = minY; cy <= maxY; ++cy) {
+            for (int cx = minX; cx <= maxX; ++cx) {
+                int cell = cy * columns + cx;
+                for (int k = 0; k < cellCount[cell]; ++k) {
+                    int index = cellBricks[cellStart[cell] + k];
+                    if (queryStamp[index] != currentQuery) {
+                        queryStamp[index] = currentQuery;
+                        candidates.push_back(index);
+                    }
+                }
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+        return candidates;
     }
 };
 
@@ -201,28 +782,88 @@ public:
     int getScore() const {
         return score;
     }
+
+    void setScore(int value) {
+        score = value;
+    }
+};
+
+// Colours of the generated wall; the last one marks multiball bricks
+const SDL_Color BUILTIN_PALETTE[] = {
+    {255, 165, 0, 255}, // Orange
+    {255, 0, 0, 255},   // Red
+    {224, 255, 255, 255}, // Light Blue
+    {0, 0, 255, 255},   // Blue
+    {255, 255, 0, 255}, // Yellow
+    {128, 0, 128, 255}, // Purple
+    {0, 255, 0, 255}    // Green
+};
+const int BUILTIN_PALETTE_COUNT = sizeof(BUILTIN_PALETTE) / sizeof(BUILTIN_PALETTE[0]);
+
+// A ball-brick overlap found during a tick, resolved after all balls moved
+struct BrickContact {
+    int brick;
+    int ball;
+    bool operator<(const BrickContact& other) const {
+        return brick != other.brick ? brick < other.brick : ball < other.ball;
+    }
 };
 
 // Game Class
-class Game {
+class Game : public Snapshotable, public Simulation, public GameEnv {
+public:
+    static const int ENV_ACTIONS = 3;
+    static const int ENV_BRICKS = 90;      // The built-in walls have up to 9 rows of 10
+    static const int ENV_STATE_SIZE = 8 + ENV_BRICKS;
+
 private:
-    static const int BALL_SPEED_X = -1;
-    static const int BALL_SPEED_Y = 1;
+    static const int MAX_BALLS = 64;
+    static const int MULTIBALL_EVERY = 7;  // One brick in seven holds a multiball
+    static const int MAX_WALL_ROWS = 9;    // Generated walls gain a row a level up to this
+    static const Uint8 MULTIBALL_COLOR = 6;
     int screenWidth, screenHeight;
-    std::vector<GameObject*> gameObjects; // Container for all game objects
+    Arena levelArena;    // Bricks, balls and the grid for the current level
+    MappedFile levelFile; // levels/levelN.bbl when there is one
+    BrickPool bricks;
+    BallPool balls;
+    BrickGrid brickGrid;
+    int ballCapacity;
+    bool stressMode;     // Headless benchmark: solid floor, no logging
+    bool quiet;          // Training copy: no logging, printing or particles
+    std::vector<BrickContact> contacts;
+    std::vector<Uint8> flipX, flipY;
+    std::vector<int> splits;
+    std::vector<int> paddleTouches;
+    ParticlePool particles;
     SDL_Window* window;
     SDL_Renderer* renderer;
-    Paddle* paddle;  // Paddle now a pointer
-    Ball* ball;      // Ball now a pointer
+    Uint32 wallVersion;  // Changes with the wall; the painter keeps it in a texture until then
+    Uint32 wallBase;     // Last time the wall changed other than by bricks breaking
+    SDL_Rect wallErased[RenderSnapshot::MAX_LAYER_ERASED]; // Bricks broken since wallBase
+    int wallErasedCount;
+    RenderSnapshot frame; // Stress recording draws on this thread
+    Paddle paddle;
     int lives;
+    int level;
     TTF_Font* font;
     Score gameScore;
     bool quit;
+    Rng colorRng;        // Colours of generated walls
+    QuickSaveSlots quickSaves;
+    RewindControl rewind;
 
 public:
-    Game()
-        : screenWidth(1000), screenHeight(600), window(nullptr), renderer(nullptr),
-          lives(3), quit(false) {
+    Game(bool headless = false, bool quiet = false)
+        : screenWidth(1000), screenHeight(600), levelArena(64 * 1024), ballCapacity(MAX_BALLS), stressMode(false),
+          quiet(quiet), particles(1000.0, quiet ? 0 : ParticlePool::CAPACITY), window(nullptr), renderer(nullptr), wallVersion(1), wallBase(1), wallErasedCount(0),
+          paddle(350, 550, 150, 20, 5, 1000, SDL_SCANCODE_LEFT, SDL_SCANCODE_RIGHT),
+          lives(3), level(1), font(nullptr), quit(false), quickSaves("brick", GAME_BRICK, *this),
+          rewind("brick", *this) {
+
+        if (headless) {
+            loadLevel(level);
+            return;
+        }
 
         if (SDL_Init(SDL_INIT_VIDEO) < 0) {
             std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
@@ -252,56 +893,403 @@ public:
             return;
         }
 
-        // Initialize paddle and ball
-        paddle = new Paddle(350, 550, 150, 20, 5, screenWidth, renderer, SDL_SCANCODE_LEFT, SDL_SCANCODE_RIGHT);
-        gameObjects.push_back(paddle);
-
-        ball = new Ball(screenWidth / 2, screenHeight - 50, 10, BALL_SPEED_X, BALL_SPEED_Y, screenWidth, screenHeight, renderer);
-        gameObjects.push_back(ball);
-
-        initializeBricks();
+        loadLevel(level);
     }
 
     ~Game() {
-        for (auto obj : gameObjects) {
-            delete obj;
-        }
+        if (!window) return; // Headless
+        particles.printStats();
+        rewind.printStats();
         TTF_CloseFont(font);
         TTF_Quit();
         SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
-        SDL_Quit();
+        SDL_QuitSubSystem(SDL_INIT_VIDEO);
     }
 
     void run() {
-        while (!quit) {
-            SDL_Event e;
-            while (SDL_PollEvent(&e) != 0) {
-                if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_CLOSE) {
-                    quit = true;
-                }
-            }
+        logEvent(GAME_BRICK, EVENT_GAME_START);
+        if (!runSimulation("brick", *this, renderer)) {
+            quit = true;
+            logEvent(GAME_BRICK, EVENT_QUIT);
+        }
+        videoCapture().stop();
+        recordScore("brick", gameScore.getScore());
+    }
 
-            const Uint8* keystate = SDL_GetKeyboardState(NULL);
-            paddle->handleInput(keystate);
+    // Worst-case frame budget: thousands of balls against the wall with a
+    // solid floor so none are lost. Reports balls x ticks per second. With a
+    // record path every tick is also drawn off screen and recorded.
+    void runStress(int ballCount, int ticks, const char* recordPath) {
+        stressMode = true;
+        ballCapacity = ballCount;
+        loadLevel(level);
+        addStressBalls(ballCount);
+
+        SDL_Surface* target = nullptr;
+        if (recordPath) {
+            target = SDL_CreateRGBSurfaceWithFormat(0, screenWidth, screenHeight, 32, SDL_PIXELFORMAT_RGBA8888);
+            renderer = target ? SDL_CreateSoftwareRenderer(target) : nullptr;
+            if (!renderer || !videoCapture().start(recordPath, screenWidth, screenHeight, 60, false)) {
+                std::cerr << "Cannot record the stress run: " << SDL_GetError() << std::endl;
+                if (renderer) SDL_DestroyRenderer(renderer);
+                renderer = nullptr;
+            }
+        }
 
+        SnapshotPainter painter(renderer);
+        Uint64 start = SDL_GetPerformanceCounter();
+        long long ballTicks = 0;
+        for (int t = 0; t < ticks; ++t) {
+            ballTicks += balls.count;
             updateGame();
+            if (renderer) {
+                snapshot(frame);
+                painter.draw(frame);
+                presentFrame(renderer);
+            }
+        }
+        double seconds = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+        std::cout << "Brick stress: " << ballCount << " balls, " << ticks << " ticks, "
+                  << seconds * 1000.0 << " ms, "
+                  << static_cast<long long>(ballTicks / seconds) << " balls*ticks/sec, "
+                  << (seconds * 1e9 / ballTicks) << " ns per ball tick, "
+                  << gameScore.getScore() / 10 << " bricks broken" << std::endl;
+
+        if (recordPath) {
+            videoCapture().stop();
+            if (renderer) SDL_DestroyRenderer(renderer);
+            if (target) SDL_FreeSurface(target);
+            renderer = nullptr;
+        }
+    }
+
+    // Level, lives, score, paddle, colour RNG, every ball, then per brick
+    // its colour, hit points and whether it is still standing. Geometry is
+    // not stored: it comes from the level itself.
+    void saveState(std::vector<unsigned char>& out) const {
+        // Room for every ball and the biggest wall, so the state does not
+        // grow as balls split or levels go by
+        out.reserve(sizeof(SaveStateHeader) + 8 * sizeof(Sint32) + 4 * ballCapacity * sizeof(int) + 3 * wallCapacity());
+        StateWriter writer(out, GAME_BRICK, STATE_VERSION);
+        writer.put<Sint32>(level);
+        writer.put<Sint32>(lives);
+        writer.put<Sint32>(gameScore.getScore());
+        writer.put<Sint32>(paddle.getX());
+        writer.put<Sint32>(paddle.getVelocity());
+        writer.put<Uint32>(colorRng.getState());
+        writer.put<Sint32>(balls.count);
+        writer.putBytes(balls.x, balls.count * sizeof(int));
+        writer.putBytes(balls.y, balls.count * sizeof(int));
+        writer.putBytes(balls.speedX, balls.count * sizeof(int));
+        writer.putBytes(balls.speedY, balls.count * sizeof(int));
+        writer.put<Sint32>(bricks.count);
+        writer.putBytes(bricks.colorIndex, bricks.count);
+        writer.putBytes(bricks.hitPoints, bricks.count);
+        writer.putBytes(bricks.alive, bricks.count);
+        writer.finish();
+    }
 
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            SDL_RenderClear(renderer);
+    // A state from another level loads that level first. The save is checked
+    // against that level's bricks and palette before anything changes, so a
+    // failed load leaves the game as it was.
+    bool loadState(const unsigned char* data, size_t size) {
+        StateReader reader(data, size, GAME_BRICK, STATE_VERSION);
+        Sint32 header[7];
+        reader.getBytes(header, sizeof(header));
+        Sint32 savedLevel = header[0], ballCount = header[6];
+        if (!reader.ok() || savedLevel < 1 || ballCount < 0 || ballCount > ballCapacity) return false;
+        const unsigned char* ballData = reader.take(4 * ballCount * sizeof(int));
+        Sint32 brickCount = -1;
+        reader.get(brickCount);
+        if (!reader.ok() || brickCount < 0) return false;
+        const unsigned char* colorData = reader.take(brickCount);
+        const unsigned char* hitPointData = reader.take(brickCount);
+        const unsigned char* aliveData = reader.take(brickCount);
+        if (!reader.done()) return false;
+
+        int levelBricks = bricks.count, levelColors = bricks.paletteCount;
+        if (savedLevel != level) levelShape(savedLevel, levelBricks, levelColors);
+        if (brickCount != levelBricks) return false;
+        for (int i = 0; i < brickCount; ++i) {
+            if (colorData[i] >= levelColors || aliveData[i] > 1) return false;
+            if (aliveData[i] && hitPointData[i] == 0) return false;
+        }
+
+        if (savedLevel != level) {
+            level = savedLevel;
+            loadLevel(level);
+        }
 
-            for (auto obj : gameObjects) {
-                obj->update();
-                obj->draw();
+        lives = header[1];
+        gameScore.setScore(header[2]);
+        paddle.setMotion(header[3], header[4]);
+        colorRng.setState(static_cast<Uint32>(header[5]));
+
+        balls.count = ballCount;
+        size_t column = ballCount * sizeof(int);
+        memcpy(balls.x, ballData, column);
+        memcpy(balls.y, ballData + column, column);
+        memcpy(balls.speedX, ballData + 2 * column, column);
+        memcpy(balls.speedY, ballData + 3 * column, column);
+
+        memcpy(bricks.colorIndex, colorData, brickCount);
+        memcpy(bricks.hitPoints, hitPointData, brickCount);
+        memcpy(bricks.alive, aliveData, brickCount);
+        bricks.liveCount = 0;
+        brickGrid.restoreAll();
+        for (int i = 0; i < brickCount; ++i) {
+            if (bricks.alive[i]) {
+                bricks.liveCount++;
+            } else {
+                brickGrid.remove(i, bricks);
             }
+        }
+        wallReplaced();
+        return true;
+    }
+
+    // A multiball game part way through, then times saving and loading
+    void benchSaveState(int iterations) {
+        stressMode = true;
+        addStressBalls(16);
+        for (int t = 0; t < 2000; ++t) updateGame();
+        benchmarkSaveState("brick", *this, iterations);
+        benchmarkRewind("brick", *this, [this]() -> Uint32 { updateGame(); return tickMicros(); }, 60 * RewindControl::SAMPLES_PER_SECOND);
+    }
 
-            SDL_RenderPresent(renderer);
+    // A wall part way through a multiball game, drawn by SDL and by the
+    // software rasteriser in a hidden window of the game's size
+    void benchRaster(int frames, int ballCount) {
+        stressMode = true;
+        ballCapacity = ballCount;
+        loadLevel(level);
+        addStressBalls(ballCount);
+        for (int t = 0; t < 300; ++t) updateGame();
+
+        SDL_Init(SDL_INIT_VIDEO);
+        SDL_Window* hidden = SDL_CreateWindow("Brick Breaker", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                              screenWidth, screenHeight, SDL_WINDOW_HIDDEN);
+        SDL_Renderer* target = hidden ? SDL_CreateRenderer(hidden, -1, SDL_RENDERER_ACCELERATED) : nullptr;
+        if (!target) {
+            std::cerr << "Cannot open a window for the raster benchmark: " << SDL_GetError() << std::endl;
+        } else {
+            snapshot(frame);
+            benchmarkSoftRaster(target, frame, frames);
+            SDL_DestroyRenderer(target);
         }
+        if (hidden) SDL_DestroyWindow(hidden);
+        SDL_Quit();
     }
+
+    // The simulation thread's side, see runSimulation()
+    Uint32 tickMicros() const { return 1000000 / 60; }
+
+    void keyPressed(const SDL_KeyboardEvent& key) {
+        if (key.repeat == 0) quickSaves.handleKey(key.keysym.sym);
+    }
+
+    void recordRewind(bool on) { rewind.setEnabled(on); }
+
+    void tick(const Uint8* keystate) {
+        if (!rewind.rewinding(keystate)) {
+            paddle.handleInput(keystate);
+
+            updateGame();
+            paddle.update();
+            rewind.recordTick(tickMicros());
+        }
+    }
+
+    // The wall only changes when a brick breaks, so it goes in the layer,
+    // refilled only when it changes. The painter keeps it in a texture and
+    // clears broken bricks out of that one by one.
+    void snapshot(RenderSnapshot& out) {
+        const SDL_Color black = {0, 0, 0, 255};
+        out.clear(black);
+        // Sized for every ball and the biggest wall, so the lists only grow
+        // on a bigger custom level
+        out.shapes.reserve(1 + balls.capacity);
+        if (out.layerVersion != wallVersion) {
+            out.layer.clear();
+            out.layer.reserve(wallCapacity());
+            bricks.snapshot(out.layer);
+            out.layerVersion = wallVersion;
+        }
+        out.layerBase = wallBase;
+        out.layerErasedCount = wallErasedCount;
+        std::copy(wallErased, wallErased + wallErasedCount, out.layerErased);
+        paddle.snapshot(out.shapes);
+        balls.snapshot(out.shapes);
+        particles.snapshot(out);
+    }
+
+    bool finished() const { return quit; }
+
+    // Training side, see game_env.h. Actions: 0 let go, 1 left, 2 right;
+    // a step is one tick at 60 Hz.
+    void reset(Uint32 seed) {
+        colorRng.seed(seed);
+        level = 1;
+        lives = 3;
+        gameScore.setScore(0);
+        quit = false;
+        paddle.setMotion(350, 0); // Where the constructor puts it
+        loadLevel(level);
+    }
+
+    float step(int action) {
+        int before = gameScore.getScore();
+        paddle.steer(action == 1, action == 2);
+        updateGame();
+        paddle.update();
+        return static_cast<float>(gameScore.getScore() - before);
+    }
+
+    bool done() const { return quit; }
+
+    // Paddle position and speed, the lowest ball, the number of balls and
+    // lives left, then whether each of the first ENV_BRICKS bricks stands
+    void observe(float* state) const {
+        int lowest = -1;
+        for (int i = 0; i < balls.count; ++i) {
+            if (lowest < 0 || balls.y[i] > balls.y[lowest]) lowest = i;
+        }
+        const float ballSpeed = 4.0f * SUBPIXEL;
+        state[0] = static_cast<float>(paddle.getX()) / screenWidth;
+        state[1] = static_cast<float>(paddle.getVelocity()) / paddle.getMaxSpeed();
+        state[2] = lowest < 0 ? 0.0f : static_cast<float>(balls.pixelX(lowest)) / screenWidth;
+        state[3] = lowest < 0 ? 0.0f : static_cast<float>(balls.pixelY(lowest)) / screenHeight;
+        state[4] = lowest < 0 ? 0.0f : balls.speedX[lowest] / ballSpeed;
+        state[5] = lowest < 0 ? 0.0f : balls.speedY[lowest] / ballSpeed;
+        state[6] = static_cast<float>(balls.count) / MAX_BALLS;
+        state[7] = lives / 3.0f;
+        for (int i = 0; i < ENV_BRICKS; ++i) state[8 + i] = i < bricks.count && bricks.alive[i] ? 1.0f : 0.0f;
+    }
+
 private:
-    void initializeBricks() {
-        int rows = 5;
-        int cols = screenWidth / (80 + 20);  // Brick size and padding
+    static const Uint8 STATE_VERSION = 1;
+
+    // Spreads balls over the lower half moving upward, the same way every run
+    void addStressBalls(int ballCount) {
+        Uint32 seed = 12345;
+        while (balls.count < ballCount && balls.count < ballCapacity) {
+            seed = seed * 1103515245u + 12345u;
+            int x = 20 + static_cast<int>((seed >> 8) % (screenWidth - 40));
+            seed = seed * 1103515245u + 12345u;
+            int y = 320 + static_cast<int>((seed >> 8) % 200);
+            seed = seed * 1103515245u + 12345u;
+            int speedX = static_cast<int>((seed >> 8) % (4 * SUBPIXEL)) - 2 * SUBPIXEL;
+            balls.add(x * SUBPIXEL, y * SUBPIXEL, speedX, -2 * SUBPIXEL);
+        }
+    }
+
+    // Everything a level owns comes out of levelArena, so switching levels
+    // is one reset instead of a delete per brick. A level file is mapped and
+    // used in place; without one a wall is generated.
+    // The wall changed other than by bricks breaking, so the painter draws
+    // it again in full
+    void wallReplaced() {
+        wallVersion++;
+        wallBase = wallVersion;
+        wallErasedCount = 0;
+    }
+
+    // Bricks on the biggest generated wall, or on this level if it is bigger
+    int wallCapacity() const {
+        return std::max(bricks.count, MAX_WALL_ROWS * (screenWidth / (80 + 20)));
+    }
+
+    // The brick and palette counts loadLevel(number) would give, without
+    // loading it
+    void levelShape(int number, int& brickCount, int& paletteCount) {
+        char path[64];
+        snprintf(path, sizeof(path), "levels/level%d.bbl", number);
+        MappedFile file;
+        if (file.open(path) && levelValidate(file.data(), file.size())) {
+            LevelHeader header;
+            memcpy(&header, file.data(), sizeof(header));
+            brickCount = static_cast<int>(header.brickCount);
+            paletteCount = static_cast<int>(header.paletteCount);
+            return;
+        }
+        brickCount = std::min(4 + number, MAX_WALL_ROWS) * (screenWidth / (80 + 20));
+        paletteCount = BUILTIN_PALETTE_COUNT;
+    }
+
+    void loadLevel(int number) {
+        Uint64 start = SDL_GetPerformanceCounter();
+
+        // The stress run keeps its swarm across levels
+        std::vector<int> keptBalls;
+        if (stressMode) {
+            for (int i = 0; i < balls.count; ++i) {
+                keptBalls.push_back(balls.x[i]);
+                keptBalls.push_back(balls.y[i]);
+                keptBalls.push_back(balls.speedX[i]);
+                keptBalls.push_back(balls.speedY[i]);
+            }
+        }
+
+        char path[64];
+        snprintf(path, sizeof(path), "levels/level%d.bbl", number);
+        bool fromFile = levelFile.open(path);
+        if (fromFile && !levelValidate(levelFile.data(), levelFile.size())) {
+            std::cerr << "Ignoring invalid level file " << path << std::endl;
+            levelFile.close();
+            fromFile = false;
+        }
+
+        if (fromFile) {
+            LevelHeader header;
+            memcpy(&header, levelFile.data(), sizeof(header));
+            levelArena.reserve(2 * header.brickCount + BallPool::bytesFor(ballCapacity) + BrickGrid::bytesFor(header) + 64);
+            bricks.attach(levelArena, header, levelFile.data());
+            balls.allocate(levelArena, ballCapacity);
+            brickGrid.attach(levelArena, header, levelFile.data());
+        } else {
+            int rows = std::min(4 + number, MAX_WALL_ROWS);
+            int cols = screenWidth / (80 + 20);  // Brick size and padding
+            int brickWidth = 80;
+            int brickPadding = 20;
+
+            size_t needed = BrickPool::bytesFor(rows * cols) + BallPool::bytesFor(ballCapacity);
+            BrickPool sizing;
+            sizing.count = rows * cols;
+            needed += BrickGrid::bytesFor(sizing, screenWidth, screenHeight, brickWidth + brickPadding);
+            levelArena.reserve(needed);
+
+            bricks.allocate(levelArena, rows * cols, BUILTIN_PALETTE, BUILTIN_PALETTE_COUNT);
+            balls.allocate(levelArena, ballCapacity);
+            initializeBricks(rows, cols);
+            brickGrid.build(levelArena, bricks, screenWidth, screenHeight, brickWidth + brickPadding);
+        }
+        flipX.assign(ballCapacity, 0);
+        flipY.assign(ballCapacity, 0);
+        // Room for a ball touching a few bricks at once, so ticks only grow
+        // these in rare pile-ups
+        contacts.reserve(4 * ballCapacity);
+        splits.reserve(4 * ballCapacity);
+        paddleTouches.reserve(ballCapacity);
+        wallReplaced();
+
+        if (stressMode) {
+            for (size_t k = 0; k + 3 < keptBalls.size(); k += 4) {
+                balls.add(keptBalls[k], keptBalls[k + 1], keptBalls[k + 2], keptBalls[k + 3]);
+            }
+            return;
+        }
+        balls.add(screenWidth / 2 * SUBPIXEL, (screenHeight - 50) * SUBPIXEL, BallPhysics::BALL_SPEED_X, BallPhysics::BALL_SPEED_Y);
+        if (number > 1) resetBallAndPaddle();
+
+        if (quiet) return;
+        double micros = static_cast<double>(SDL_GetPerformanceCounter() - start) * 1e6 / SDL_GetPerformanceFrequency();
+        std::cout << "Level " << number << ": " << bricks.count << " bricks from "
+                  << (fromFile ? path : "built-in wall") << " in " << micros << " us" << std::endl;
+    }
+
+    void initializeBricks(int rows, int cols) {
         int brickWidth = 80;
         int brickHeight = 30;
         int brickPadding = 20;
@@ -312,60 +1300,119 @@ private:
             for (int c = 0; c < cols; ++c) {
                 int x = offsetX + c * (brickWidth + brickPadding);
                 int y = offsetY + r * (brickHeight + brickPadding);
-                SDL_Color color = getRandomColor();
-                Brick* brick = new Brick(x, y, brickWidth, brickHeight, color, renderer);
-                gameObjects.push_back(brick);
+                int index = bricks.count;
+                if (index % MULTIBALL_EVERY == MULTIBALL_EVERY / 2) {
+                    bricks.add(x, y, brickWidth, brickHeight, MULTIBALL_COLOR, LEVEL_BRICK_MULTIBALL);
+                } else {
+                    bricks.add(x, y, brickWidth, brickHeight, getRandomColor(), 0);
+                }
             }
         }
     }
 
     void updateGame() {
-        ball->update(*paddle);
-
-        for (auto obj : gameObjects) {
-            // Cast object to Brick to check for collision
-            Brick* brick = dynamic_cast<Brick*>(obj);
-            if (brick && brick->isVisible() && ball->collidesWith(*brick)) {
-                brick->setVisible(false);
-                // Determine if the collision is horizontal or vertical
-                if (ball->isCollisionHorizontal(*brick)) {
-                    ball->reverseXDirection();
-                } else {
-                    ball->reverseYDirection();
-                }
-                gameScore.addPoints(10);
-                std::cout << "Score: " << gameScore.getScore() << std::endl;
-            }
+        BallPhysics::Bounds bounds = BallPhysics::makeBounds(balls, paddle, screenWidth, screenHeight, stressMode);
+        BallPhysics::integrate(balls, bounds);
+        if (!stressMode && !quiet) {
+            BallPhysics::paddleTouches(balls, bounds, paddleTouches);
+            for (int i : paddleTouches) particles.emitSparks(static_cast<float>(balls.pixelX(i)), static_cast<float>(paddle.getY()));
+            particles.update();
+        }
+        resolveBrickContacts();
+
+        if (bricks.liveCount == 0) {
+            level++;
+            if (!stressMode && !quiet) logEvent(GAME_BRICK, EVENT_LEVEL, level);
+            loadLevel(level);
+            return;
         }
 
-        if (ball->isOutOfBounds(screenHeight)) {
+        if (stressMode) return;
+
+        balls.removeOutOfBounds(screenHeight);
+        if (balls.count == 0) {
             lives--;
-            std::cout << "Lives left: " << lives << std::endl;
+            if (!quiet) logEvent(GAME_BRICK, EVENT_LIFE_LOST, lives);
             if (lives <= 0) {
                 quit = true;
-                std::cout << "Game Over!" << std::endl;
+                if (!quiet) logEvent(GAME_BRICK, EVENT_GAME_OVER, gameScore.getScore());
             } else {
+                balls.add(0, 0, 0, 0);
                 resetBallAndPaddle();
             }
         }
     }
 
+    // Contacts are first gathered for every ball, then sorted by brick and
+    // ball so the outcome does not depend on the order balls were tested in.
+    // A brick breaks once even if several balls reach it on the same tick,
+    // and each ball bounces at most once per axis.
+    void resolveBrickContacts() {
+        contacts.clear();
+        for (int i = 0; i < balls.count; ++i) {
+            // Only the bricks sharing a grid cell with the ball can be hit
+            for (int b : brickGrid.query(balls.bounds(i))) {
+                if (BallPhysics::hitsBrick(balls, i, bricks, b)) {
+                    BrickContact contact = {b, i};
+                    contacts.push_back(contact);
+                }
+            }
+        }
+        if (contacts.empty()) return;
+        std::sort(contacts.begin(), contacts.end());
+
+        splits.clear();
+        for (size_t k = 0; k < contacts.size(); ++k) {
+            const BrickContact& contact = contacts[k];
+            bool firstForBrick = (k == 0 || contacts[k - 1].brick != contact.brick);
+            if (firstForBrick && --bricks.hitPoints[contact.brick] == 0) {
+                bricks.kill(contact.brick);
+                brickGrid.remove(contact.brick, bricks);
+                if (wallErasedCount < RenderSnapshot::MAX_LAYER_ERASED) {
+                    wallVersion++;
+                    wallErased[wallErasedCount++] = bricks.rect(contact.brick);
+                } else {
+                    wallReplaced(); // Too many to clear one at a time
+                }
+                if (!stressMode && !quiet) particles.emitDebris(bricks.rect(contact.brick), bricks.palette[bricks.colorIndex[contact.brick]]);
+                if (bricks.flags[contact.brick] & LEVEL_BRICK_MULTIBALL) splits.push_back(contact.ball);
+                gameScore.addPoints(10);
+                if (!stressMode && !quiet) logEvent(GAME_BRICK, EVENT_SCORE, gameScore.getScore(), 10);
+            }
+            // Determine if the collision is horizontal or vertical
+            if (BallPhysics::isCollisionHorizontal(balls, contact.ball, bricks, contact.brick)) {
+                flipX[contact.ball] = 1;
+            } else {
+                flipY[contact.ball] = 1;
+            }
+        }
+        for (size_t k = 0; k < contacts.size(); ++k) {
+            int i = contacts[k].ball;
+            if (flipX[i]) balls.speedX[i] = -balls.speedX[i];
+            if (flipY[i]) balls.speedY[i] = -balls.speedY[i];
+            flipX[i] = flipY[i] = 0;
+        }
+        for (int i : splits) splitBall(i);
+    }
+
+    // Multiball: two extra balls leave at +-30 degrees from the original
+    void splitBall(int i) {
+        const int cosine = 222, sine = 128; // 30 degrees in 1/256ths
+        int vx = balls.speedX[i], vy = balls.speedY[i];
+        balls.add(balls.x[i], balls.y[i], (vx * cosine - vy * sine) / 256, (vx * sine + vy * cosine) / 256);
+        balls.add(balls.x[i], balls.y[i], (vx * cosine + vy * sine) / 256, (vy * cosine - vx * sine) / 256);
+    }
+
     void resetBallAndPaddle() {
-        paddle->reset();
-        ball->reset(paddle->getX() + paddle->getWidth() / 2 - ball->getRadius(), paddle->getY() - ball->getRadius() * 2);
-    }
-
-    SDL_Color getRandomColor() {
-        const std::vector<SDL_Color> colors = {
-            {255, 165, 0, 255}, // Orange
-            {255, 0, 0, 255},   // Red
-            {224, 255, 255, 255}, // Light Blue
-            {0, 0, 255, 255},   // Blue
-            {255, 255, 0, 255}, // Yellow
-            {128, 0, 128, 255}  // Purple
-        };
-        int randomIndex = rand() % colors.size();
-        return colors[randomIndex];
+        paddle.reset();
+        balls.x[0] = (paddle.getX() + paddle.getWidth() / 2 - balls.radius) * SUBPIXEL;
+        balls.y[0] = (paddle.getY() - balls.radius * 2) * SUBPIXEL;
+        balls.speedX[0] = BallPhysics::BALL_SPEED_X;
+        balls.speedY[0] = BallPhysics::BALL_SPEED_Y;
+    }
+
+    Uint8 getRandomColor() {
+        return static_cast<Uint8>(colorRng.below(MULTIBALL_COLOR));
     }
 };
 
@@ -376,8 +1423,68 @@ void runBrickGame() {
     game.run();
 }
 
+void runBrickStress(int ballCount, int ticks, const char* recordPath) {
+    Game game(true);
+    game.runStress(ballCount, ticks, recordPath);
+}
+
+void benchBrickSaveState(int iterations) {
+    Game game(true);
+    game.benchSaveState(iterations);
+}
+
+void benchBrickRaster(int frames, int ballCount) {
+    Game game(true);
+    game.benchRaster(frames, ballCount);
+}
+
+static GameEnv* createBrickEnv() {
+    return new Game(true, true);
+}
+
+static Simulation* createBrickSimulation(bool rewind) {
+    Game* game = new Game(true, true);
+    game->recordRewind(rewind);
+    return game;
+}
+
+// Attract mode: keeps the middle of the paddle under the lowest ball. The
+// paddle's inertia makes it miss now and then.
+static int autoplayBrick(const float* state) {
+    if (state[6] == 0.0f) return 0;
+    float gap = (state[2] * 1000 + 10) - (state[0] * 1000 + 75);
+    return gap < -20 ? 1 : gap > 20 ? 2 : 0;
+}
+
+// Emulator --brick-stress <balls> [ticks [video]]
+// Emulator --bench-savestate [iterations]
+// Emulator --bench-raster [frames [balls]]
+static bool runBrickCommand(int argc, char* argv[]) {
+    if (argc >= 3 && strcmp(argv[1], "--brick-stress") == 0) {
+        runBrickStress(atoi(argv[2]), argc > 3 ? atoi(argv[3]) : 1000, argc > 4 ? argv[4] : nullptr);
+        return true;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-savestate") == 0) {
+        benchBrickSaveState(argc > 2 ? atoi(argv[2]) : 10000);
+        return true;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-raster") == 0) {
+        benchBrickRaster(argc > 2 ? atoi(argv[2]) : 600, argc > 3 ? atoi(argv[3]) : 64);
+        return true;
+    }
+    return false;
+}
+
+GAME_MODULE_EXPORT const GameModule* arcadeGameModule() {
+    static const GameEnvSpec env = {Game::ENV_ACTIONS, Game::ENV_STATE_SIZE, 1000, 600, createBrickEnv,
+                                     autoplayBrick};
+    static const GameModule module = {GAME_MODULE_API_VERSION, "Brick breaker", "brick", true, runBrickGame, runBrickCommand, &env,
+                                      createBrickSimulation};
+    return &module;
+}
+
 
 
 // Ensure to include SDL and TTF libraries during compilation.
 
-//g++ -std=c++11 -o brick brick_breaker.cpp -IC:\mingw_dev_lib\include\SDL2 -LC:\mingw_dev_lib\lib -lmingw32 -lSDL2main -lSDL2 -lSDL2_image -lSDL2_ttf
\ No newline at end of file
+//g++ -std=c++11 -shared -o games/brick_breaker.dll brick_breaker.cpp -IC:\mingw_dev_lib\include\SDL2 -LC:\mingw_dev_lib\lib -L. -larcade_core -lmingw32 -lSDL2 -lSDL2_ttf
\ No newline at end of file
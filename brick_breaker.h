@@ -3,4 +3,15 @@
 
 void runBrickGame();
 
+// Headless multiball benchmark, prints balls x ticks per second. A record
+// path also saves every tick as video (.y4m) or PNG frames.
+void runBrickStress(int ballCount, int ticks, const char* recordPath = nullptr);
+
+// Headless timing of save state and load state
+void benchBrickSaveState(int iterations);
+
+// Times drawing a busy frame through SDL and through the software
+// rasteriser and checks that both give the same pixels
+void benchBrickRaster(int frames, int ballCount);
+
 #endif // 
@@ -0,0 +1,357 @@
+#include "crt_filter.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const int BLOOM_SCALE = 4;          // Bloom is worked out at 1/4 size along each side
+const int BLOOM_THRESHOLD = 140;    // Channel values above this glow
+const Uint16 SCANLINE_DARK = 168;   // Brightness of every second row, out of 256
+const Uint16 MASK_DIM = 190;        // The two channels a grille column does not emphasise
+const float CURVE = 0.06f;          // Bulge of the screen towards the corners
+const float VIGNETTE = 0.22f;       // Darkening at the corners
+
+double microsSince(Uint64 start) {
+    return static_cast<double>(SDL_GetPerformanceCounter() - start) * 1e6 / SDL_GetPerformanceFrequency();
+}
+
+// Never destroyed, like the software rasteriser's pool
+ThreadPool& crtPool() {
+    static ThreadPool* pool = new ThreadPool();
+    return *pool;
+}
+
+// a to b by t/256, two channels per multiply
+Uint32 lerpPixel(Uint32 a, Uint32 b, Uint32 t) {
+    Uint32 rb = ((a & 0xFF00FF) * (256 - t) + (b & 0xFF00FF) * t) >> 8;
+    Uint32 g = ((a & 0xFF00) * (256 - t) + (b & 0xFF00) * t) >> 8;
+    return (rb & 0xFF00FF) | (g & 0xFF00);
+}
+
+// (in + glow) * mask * row, with glow optional. Channels are B, G, R, A in
+// memory, and so are the four mask weights of each column.
+void composeRow(const Uint32* in, const Uint32* glow, Uint32* out, const Uint16* mask, Uint16 row, int width) {
+    int x = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rowWeight = _mm_set1_epi16(static_cast<short>(row));
+    const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    for (; x + 4 <= width; x += 4) {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x));
+        if (glow) c = _mm_adds_epu8(c, _mm_loadu_si128(reinterpret_cast<const __m128i*>(glow + x)));
+        __m128i lo = _mm_unpacklo_epi8(c, zero);
+        __m128i hi = _mm_unpackhi_epi8(c, zero);
+        lo = _mm_srli_epi16(_mm_mullo_epi16(lo, _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + x * 4))), 8);
+        hi = _mm_srli_epi16(_mm_mullo_epi16(hi, _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + x * 4 + 8))), 8);
+        lo = _mm_srli_epi16(_mm_mullo_epi16(lo, rowWeight), 8);
+        hi = _mm_srli_epi16(_mm_mullo_epi16(hi, rowWeight), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_or_si128(_mm_packus_epi16(lo, hi), opaque));
+    }
+#endif
+    for (; x < width; ++x) {
+        Uint32 c = in[x], g = glow ? glow[x] : 0, result = 0xFF000000u;
+        for (int k = 0; k < 3; ++k) {
+            Uint32 v = std::min<Uint32>(((c >> (8 * k)) & 0xFF) + ((g >> (8 * k)) & 0xFF), 255);
+            v = (((v * mask[x * 4 + k]) >> 8) * row) >> 8;
+            result |= v << (8 * k);
+        }
+        out[x] = result;
+    }
+}
+
+} // namespace
+
+CrtFilter::CrtFilter()
+    : quality(CRT_OFF), width(0), height(0), bloomWidth(0), bloomHeight(0), texture(nullptr), textureWindow(0),
+      frames(0), filterMicros(0), peakFilterMicros(0), totalMicros(0), peakTotalMicros(0) {}
+
+CrtFilter::~CrtFilter() {
+    if (!frames) return;
+    std::cout << "CRT filter (" << crtQualityName(quality) << ", " << crtPool().threads() << " threads): " << frames
+              << " frames, filter " << filterMicros / frames << " us average, " << peakFilterMicros
+              << " us peak, with read back and upload " << totalMicros / frames << " us average, " << peakTotalMicros
+              << " us peak" << std::endl;
+}
+
+// Tables that only depend on the frame size, built again when it changes
+void CrtFilter::resize(int newWidth, int newHeight) {
+    if (newWidth == width && newHeight == height && (quality < CRT_FULL || !curveSource.empty())) return;
+    width = newWidth;
+    height = newHeight;
+
+    rowWeight.resize(height);
+    for (int y = 0; y < height; ++y) rowWeight[y] = (y & 1) ? SCANLINE_DARK : 256;
+
+    // Aperture grille: red, green and blue columns in turn
+    maskWeight.resize(static_cast<size_t>(width) * 4);
+    for (int x = 0; x < width; ++x) {
+        int bright = 2 - x % 3; // Memory order is B, G, R
+        for (int k = 0; k < 4; ++k) maskWeight[x * 4 + k] = (k == bright || k == 3) ? 256 : MASK_DIM;
+    }
+
+    bloomWidth = (width + BLOOM_SCALE - 1) / BLOOM_SCALE;
+    bloomHeight = (height + BLOOM_SCALE - 1) / BLOOM_SCALE;
+    bloom.assign(static_cast<size_t>(bloomWidth) * bloomHeight, 0);
+    bloomTemp.assign(bloom.size(), 0);
+    bloomRows.assign(static_cast<size_t>((height + BAND_ROWS - 1) / BAND_ROWS) * (width + bloomWidth), 0);
+    bloomColumn.resize(width);
+    bloomWeight.resize(width);
+    for (int x = 0; x < width; ++x) {
+        // Where the column falls between bloom pixels, in 1/256ths
+        int fx = std::max(0, (x * 2 + 1) * 128 / BLOOM_SCALE - 128);
+        bloomColumn[x] = std::min(fx >> 8, bloomWidth - 1);
+        bloomWeight[x] = static_cast<Uint16>(fx & 0xFF);
+    }
+
+    if (quality >= CRT_FULL) {
+        size_t pixels = static_cast<size_t>(width) * height;
+        // Each screen pixel looks up the frame pixel the bulging glass
+        // shows there; corners fall outside the frame and stay black
+        curved.assign(pixels, 0);
+        curveSource.resize(pixels);
+        curveShade.resize(pixels);
+        for (int y = 0; y < height; ++y) {
+            float v = (y + 0.5f) / height * 2.0f - 1.0f;
+            for (int x = 0; x < width; ++x) {
+                float u = (x + 0.5f) / width * 2.0f - 1.0f;
+                float su = u * (1.0f + CURVE * v * v), sv = v * (1.0f + CURVE * u * u);
+                int sx = static_cast<int>((su + 1.0f) * 0.5f * width);
+                int sy = static_cast<int>((sv + 1.0f) * 0.5f * height);
+                size_t i = static_cast<size_t>(y) * width + x;
+                bool inside = sx >= 0 && sx < width && sy >= 0 && sy < height;
+                curveSource[i] = inside ? sy * width + sx : -1;
+                curveShade[i] = static_cast<Uint16>(256.0f * (1.0f - VIGNETTE * (u * u + v * v) * 0.5f));
+            }
+        }
+    }
+}
+
+void CrtFilter::curveBand(const Uint32* in, int top, int bottom) {
+    for (int y = top; y < bottom; ++y) {
+        size_t row = static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; ++x) {
+            int source = curveSource[row + x];
+            if (source < 0) {
+                curved[row + x] = 0xFF000000u;
+                continue;
+            }
+            curved[row + x] = 0xFF000000u | lerpPixel(0, in[source], curveShade[row + x]);
+        }
+    }
+}
+
+// One bloom pixel per BLOOM_SCALE square: the average of how far each
+// channel goes over the threshold, doubled
+void CrtFilter::bloomDownsample(const Uint32* in, int row) {
+    int top = row * BLOOM_SCALE, bottom = std::min(top + BLOOM_SCALE, height);
+    for (int bx = 0; bx < bloomWidth; ++bx) {
+        int left = bx * BLOOM_SCALE, right = std::min(left + BLOOM_SCALE, width);
+        Uint32 sum[3] = {0, 0, 0};
+#if defined(__SSE2__) || defined(_M_X64)
+        if (right - left == 4) {
+            // Four pixels a row, channels summed in 16 bits
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i threshold = _mm_set1_epi8(static_cast<char>(BLOOM_THRESHOLD));
+            __m128i acc = zero;
+            for (int y = top; y < bottom; ++y) {
+                __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + static_cast<size_t>(y) * width + left));
+                c = _mm_subs_epu8(c, threshold);
+                acc = _mm_add_epi16(acc, _mm_add_epi16(_mm_unpacklo_epi8(c, zero), _mm_unpackhi_epi8(c, zero)));
+            }
+            acc = _mm_add_epi16(acc, _mm_srli_si128(acc, 8));
+            Uint32 bg = static_cast<Uint32>(_mm_cvtsi128_si32(acc));
+            Uint32 ra = static_cast<Uint32>(_mm_cvtsi128_si32(_mm_srli_si128(acc, 4)));
+            sum[0] = bg & 0xFFFF;
+            sum[1] = bg >> 16;
+            sum[2] = ra & 0xFFFF;
+        } else
+#endif
+        for (int y = top; y < bottom; ++y) {
+            const Uint32* pixels = in + static_cast<size_t>(y) * width;
+            for (int x = left; x < right; ++x) {
+                for (int k = 0; k < 3; ++k) {
+                    int v = static_cast<int>((pixels[x] >> (8 * k)) & 0xFF) - BLOOM_THRESHOLD;
+                    if (v > 0) sum[k] += v;
+                }
+            }
+        }
+        Uint32 result = 0;
+        for (int k = 0; k < 3; ++k) result |= std::min<Uint32>(sum[k] * 2 / (BLOOM_SCALE * BLOOM_SCALE), 255) << (8 * k);
+        bloom[static_cast<size_t>(row) * bloomWidth + bx] = result;
+    }
+}
+
+// 1 4 6 4 1 blur along rows from bloom into bloomTemp, or along columns
+// from bloomTemp back into bloom
+void CrtFilter::bloomBlur(int row, bool vertical) {
+    static const Uint32 TAPS[5] = {1, 4, 6, 4, 1};
+    const std::vector<Uint32>& from = vertical ? bloomTemp : bloom;
+    std::vector<Uint32>& to = vertical ? bloom : bloomTemp;
+    for (int bx = 0; bx < bloomWidth; ++bx) {
+        Uint32 sum[3] = {0, 0, 0};
+        for (int t = 0; t < 5; ++t) {
+            int x = vertical ? bx : std::min(std::max(bx + t - 2, 0), bloomWidth - 1);
+            int y = vertical ? std::min(std::max(row + t - 2, 0), bloomHeight - 1) : row;
+            Uint32 c = from[static_cast<size_t>(y) * bloomWidth + x];
+            for (int k = 0; k < 3; ++k) sum[k] += ((c >> (8 * k)) & 0xFF) * TAPS[t];
+        }
+        to[static_cast<size_t>(row) * bloomWidth + bx] = (sum[0] >> 4) | ((sum[1] >> 4) << 8) | ((sum[2] >> 4) << 16);
+    }
+}
+
+void CrtFilter::composeBand(const Uint32* in, Uint32* out, int band, int top, int bottom) {
+    Uint32* glow = nullptr;
+    Uint32* mixed = nullptr;
+    if (quality >= CRT_BALANCED) {
+        glow = &bloomRows[static_cast<size_t>(band) * (width + bloomWidth)];
+        mixed = glow + width;
+    }
+    for (int y = top; y < bottom; ++y) {
+        if (glow) {
+            // Bilinear from the small bloom picture: between two of its rows
+            // first, then along the row
+            int fy = std::max(0, (y * 2 + 1) * 128 / BLOOM_SCALE - 128);
+            int y0 = std::min(fy >> 8, bloomHeight - 1), y1 = std::min(y0 + 1, bloomHeight - 1);
+            const Uint32* upper = &bloom[static_cast<size_t>(y0) * bloomWidth];
+            const Uint32* lower = &bloom[static_cast<size_t>(y1) * bloomWidth];
+            for (int bx = 0; bx < bloomWidth; ++bx) mixed[bx] = lerpPixel(upper[bx], lower[bx], fy & 0xFF);
+            for (int x = 0; x < width; ++x) {
+                int x0 = bloomColumn[x];
+                glow[x] = lerpPixel(mixed[x0], mixed[std::min(x0 + 1, bloomWidth - 1)], bloomWeight[x]);
+            }
+        }
+        size_t row = static_cast<size_t>(y) * width;
+        composeRow(in + row, glow, out + row, maskWeight.data(), rowWeight[y], width);
+    }
+}
+
+void CrtFilter::filter(const Uint32* in, Uint32* out, int newWidth, int newHeight, ThreadPool& pool) {
+    if (quality == CRT_OFF || newWidth <= 0 || newHeight <= 0) return;
+    resize(newWidth, newHeight);
+    int bands = (height + BAND_ROWS - 1) / BAND_ROWS;
+    const Uint32* source = in;
+    if (quality >= CRT_FULL) {
+        pool.run(bands, [this, in](int band) {
+            curveBand(in, band * BAND_ROWS, std::min((band + 1) * BAND_ROWS, height));
+        });
+        source = curved.data();
+    }
+    if (quality >= CRT_BALANCED) {
+        pool.run(bloomHeight, [this, source](int row) { bloomDownsample(source, row); });
+        pool.run(bloomHeight, [this](int row) { bloomBlur(row, false); });
+        pool.run(bloomHeight, [this](int row) { bloomBlur(row, true); });
+    }
+    // Two captures at most keep the job inside std::function, off the heap
+    struct { const Uint32* in; Uint32* out; } pass = {source, out};
+    pool.run(bands, [this, &pass](int band) {
+        composeBand(pass.in, pass.out, band, band * BAND_ROWS, std::min((band + 1) * BAND_ROWS, height));
+    });
+}
+
+void CrtFilter::apply(SDL_Renderer* renderer) {
+    if (quality == CRT_OFF) return;
+    Uint64 start = SDL_GetPerformanceCounter();
+    int w = 0, h = 0;
+    SDL_GetRendererOutputSize(renderer, &w, &h);
+    if (w <= 0 || h <= 0) return;
+    size_t pixels = static_cast<size_t>(w) * h;
+    if (frame.size() != pixels) {
+        frame.resize(pixels);
+        filtered.resize(pixels);
+    }
+    if (SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_ARGB8888, frame.data(), w * 4) != 0) return;
+
+    Uint64 filterStart = SDL_GetPerformanceCounter();
+    filter(frame.data(), filtered.data(), w, h, crtPool());
+    double micros = microsSince(filterStart);
+    filterMicros += micros;
+    if (micros > peakFilterMicros) peakFilterMicros = micros;
+
+    // Each game has its own window and renderer. A texture goes with its
+    // renderer when that is destroyed, so one whose window is gone is
+    // only forgotten.
+    Uint32 window = SDL_GetWindowID(SDL_RenderGetWindow(renderer));
+    int textureWidth = 0, textureHeight = 0;
+    if (texture && window == textureWindow) SDL_QueryTexture(texture, nullptr, nullptr, &textureWidth, &textureHeight);
+    if (texture && (window != textureWindow || textureWidth != w || textureHeight != h)) {
+        if (SDL_GetWindowFromID(textureWindow)) SDL_DestroyTexture(texture);
+        texture = nullptr;
+    }
+    if (!texture) {
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, w, h);
+        if (!texture) return;
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+        textureWindow = window;
+    }
+    if (SDL_UpdateTexture(texture, nullptr, filtered.data(), w * 4) != 0) {
+        // Lost with a device reset; made again next frame
+        SDL_DestroyTexture(texture);
+        texture = nullptr;
+        return;
+    }
+    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+
+    frames++;
+    micros = microsSince(start);
+    totalMicros += micros;
+    if (micros > peakTotalMicros) peakTotalMicros = micros;
+}
+
+CrtQuality parseCrtQuality(const char* name) {
+    if (strcmp(name, "fast") == 0) return CRT_FAST;
+    if (strcmp(name, "balanced") == 0) return CRT_BALANCED;
+    if (strcmp(name, "full") == 0) return CRT_FULL;
+    return CRT_OFF;
+}
+
+const char* crtQualityName(CrtQuality quality) {
+    switch (quality) {
+        case CRT_OFF: return "off";
+        case CRT_FAST: return "fast";
+        case CRT_BALANCED: return "balanced";
+        case CRT_FULL: return "full";
+    }
+    return "unknown";
+}
+
+CrtFilter& crtFilter() {
+    static CrtFilter filter;
+    return filter;
+}
+
+void benchmarkCrt(int frames, int width, int height) {
+    if (frames <= 0 || width <= 0 || height <= 0) return;
+    // Dark background, bright blocks and thin lines, like the games
+    std::vector<Uint32> in(static_cast<size_t>(width) * height), out(in.size());
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            Uint32 c = 0xFF000000u;
+            if ((x / 50 + y / 25) % 5 == 0) c = 0xFF000000u | (((x * 7) & 0xFF) << 16) | (((y * 3) & 0xFF) << 8) | 0xC0;
+            if (x % 97 == 0 || y % 89 == 0) c = 0xFFFFFFFFu;
+            in[static_cast<size_t>(y) * width + x] = c;
+        }
+    }
+
+    ThreadPool& pool = crtPool();
+    const CrtQuality presets[3] = {CRT_FAST, CRT_BALANCED, CRT_FULL};
+    for (CrtQuality preset : presets) {
+        CrtFilter filter;
+        filter.setQuality(preset);
+        filter.filter(in.data(), out.data(), width, height, pool); // Tables are built on the first frame
+        double total = 0, peak = 0;
+        for (int f = 0; f < frames; ++f) {
+            Uint64 start = SDL_GetPerformanceCounter();
+            filter.filter(in.data(), out.data(), width, height, pool);
+            double micros = microsSince(start);
+            total += micros;
+            if (micros > peak) peak = micros;
+        }
+        std::cout << "CRT " << crtQualityName(preset) << " at " << width << "x" << height << " on " << pool.threads()
+                  << " threads: " << total / frames / 1000 << " ms per frame, " << peak / 1000 << " ms peak, "
+                  << (total / frames < 16667 ? "inside" : "over") << " a 60 Hz budget" << std::endl;
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef CRT_FILTER_H
+#define CRT_FILTER_H
+
+#include <SDL.h>
+#include <vector>
+#include "thread_pool.h"
+
+// How much of the arcade monitor look to add; each preset adds to the one
+// before it
+enum CrtQuality {
+    CRT_OFF,
+    CRT_FAST,       // Scanlines and an aperture grille phosphor mask
+    CRT_BALANCED,   // ... and bloom around bright pixels
+    CRT_FULL        // ... and a curved screen with darkened corners
+};
+
+// A CRT look applied on the CPU, since plain SDL_Renderer has no shaders.
+// presentFrame() reads the finished frame back, runs it through the filter
+// and draws the result over the window before presenting. The frame is
+// split into bands of rows across a ThreadPool, and the per-pixel work is
+// done four pixels at a time with SSE2 where available. Prints its average
+// and peak cost per frame when the emulator exits.
+class CrtFilter {
+public:
+    static const int BAND_ROWS = 16;
+
+    CrtFilter();
+    ~CrtFilter();
+
+    void setQuality(CrtQuality newQuality) { quality = newQuality; }
+    CrtQuality getQuality() const { return quality; }
+
+    // Replaces what the renderer is about to present with the filtered frame
+    void apply(SDL_Renderer* renderer);
+
+    // The filter itself: width x height ARGB8888 pixels from in to out
+    void filter(const Uint32* in, Uint32* out, int width, int height, ThreadPool& pool);
+
+private:
+    void resize(int width, int height);
+    void curveBand(const Uint32* in, int top, int bottom);
+    void bloomDownsample(const Uint32* in, int row);
+    void bloomBlur(int row, bool vertical);
+    void composeBand(const Uint32* in, Uint32* out, int band, int top, int bottom);
+
+    CrtQuality quality;
+    int width, height;
+    std::vector<Uint32> frame;          // Read back from the renderer
+    std::vector<Uint32> filtered;
+    std::vector<Uint32> curved;         // The frame bent onto the curved screen
+    std::vector<int> curveSource;       // Per pixel: where it comes from, -1 for outside the screen
+    std::vector<Uint16> curveShade;     // Per pixel: corner darkening, 256 is none
+    std::vector<Uint16> rowWeight;      // Scanlines, 256 is full brightness
+    std::vector<Uint16> maskWeight;     // Four channel weights per column
+    int bloomWidth, bloomHeight;
+    std::vector<Uint32> bloom, bloomTemp;   // Bright parts at 1/BLOOM_SCALE size
+    std::vector<int> bloomColumn;       // Per column: the bloom pixel to its left
+    std::vector<Uint16> bloomWeight;    // Per column: how far towards the next one, in 1/256ths
+    std::vector<Uint32> bloomRows;      // Per band: a full-width row of bloom and a bloom-width one
+    SDL_Texture* texture;
+    Uint32 textureWindow;               // The window of the renderer that owns texture
+    long long frames;
+    double filterMicros, peakFilterMicros;
+    double totalMicros, peakTotalMicros;   // With the read back and upload
+};
+
+// The filter every presented frame goes through. Emulator --crt [preset]
+CrtFilter& crtFilter();
+
+// "fast", "balanced" or "full"; CRT_OFF for anything else
+CrtQuality parseCrtQuality(const char* name);
+const char* crtQualityName(CrtQuality quality);
+
+// Filters a test picture of width x height at every preset and prints the
+// time per frame. Emulator --bench-crt [frames [width height]]
+void benchmarkCrt(int frames, int width, int height);
+
+#endif
@@ -1,49 +1,132 @@
-#include "pong.h"
-#include "brick_breaker.h"
-#include "tetris.h"
-#include "snake.h"
+#include "game_registry.h"
 #include "game_over.h"
+#include "event_log.h"
+#include "leaderboard.h"
+#include "frame_export.h"
+#include "frame_pipeline.h"
+#include "soft_raster.h"
+#include "batched_env.h"
+#include "alloc_tracker.h"
+#include "metrics.h"
+#include "flight_recorder.h"
+#include "crt_filter.h"
+#include "attract_mode.h"
+#include "game_scheduler.h"
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_ttf.h>
 #include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <vector>
 #include <SDL_mixer.h>
 
 const int WINDOW_WIDTH = 800;
 const int WINDOW_HEIGHT = 600;
 const int BUTTON_WIDTH = 200;
 const int BUTTON_HEIGHT = 50;
+const int BUTTON_SPACING = 100;
+
+static int audioBytesPerSecond = 0; // Of the mixed stream, once the device is open
+
+// Runs on the audio thread after SDL_mixer mixes each buffer. One that
+// follows the last by more than one and a half of its own length was
+// mixed late, and the device has most likely run dry in between.
+static void SDLCALL watchAudio(void*, Uint8*, int length) {
+    static Uint64 lastMix = 0;
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (lastMix && audioBytesPerSecond > 0) {
+        Uint64 expected = static_cast<Uint64>(length) * SDL_GetPerformanceFrequency() / audioBytesPerSecond;
+        if (now - lastMix > expected * 3 / 2) metrics().audioUnderruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    lastMix = now;
+}
+
+// Steps of opening the menu, timed on every start for --bench-startup
+enum StartupStep {
+    STARTUP_SDL_INIT,      // SDL, SDL_image and SDL_ttf
+    STARTUP_WINDOW,        // Window and renderer
+    STARTUP_BACKGROUND,    // IMG_LoadTexture
+    STARTUP_FONT,          // TTF_OpenFont
+    STARTUP_AUDIO,         // Mix_OpenAudio
+    STARTUP_MUSIC,         // Mix_LoadMUS and Mix_PlayMusic
+    STARTUP_FIRST_FRAME,
+    STARTUP_STEPS
+};
+
+static const char* const STARTUP_STEP_NAMES[STARTUP_STEPS] = {
+    "SDL_Init", "window and renderer", "IMG_LoadTexture", "TTF_OpenFont", "Mix_OpenAudio", "Mix_LoadMUS",
+    "first frame"};
 
 class Emulator {
 public:
-    Emulator();
+    Emulator(GameRegistry& games);
     ~Emulator();
     void run();
 
+    friend void benchmarkStartup(GameRegistry& games, int passes, Uint64 processStart);
+
 private:
+    // Menu text drawn once into a texture and reused every frame
+    struct CachedText {
+        std::string text;
+        SDL_Color color;
+        SDL_Texture* texture;
+        int width, height;
+    };
+
     SDL_Window* window;
     SDL_Renderer* renderer;
     SDL_Texture* backgroundTexture;
     TTF_Font* font;
     GameOver gameOverScreen;
-    SDL_Rect button1, button2, button3, button4;
+    GameRegistry& games;
+    std::vector<SDL_Rect> buttons;   // One per game, in registry order
+    AttractMode* attract;            // Live previews beside the buttons
+    size_t nextPreview;              // The button whose preview starts after the next frame
     bool quit;
     Mix_Music* backgroundMusic;
+    std::vector<CachedText> textCache;
+    double startupMicros[STARTUP_STEPS];
+    Uint64 gameReturned;             // When the last game's run() came back
+    Uint64 menuPresented;            // When the last menu frame was presented
     bool init();
+    void launch(size_t index);
+    void startPreview(size_t index);
     void handleEvents();
     void render();
     bool isInside(int x, int y, SDL_Rect rect);
     void renderText(const char* text, SDL_Color color, int x, int y);
+    void renderBestScore(const char* game, SDL_Color color, const SDL_Rect& button);
+    void clearTextCache();
 };
 
-Emulator::Emulator() : window(nullptr), renderer(nullptr), backgroundTexture(nullptr), font(nullptr), gameOverScreen(500, 500, "font.ttf", 60, 1000), backgroundMusic(nullptr) {
-    button1 = {100, 100, BUTTON_WIDTH, BUTTON_HEIGHT};
-    button2 = {100, 200, BUTTON_WIDTH, BUTTON_HEIGHT};
-    button3 = {100, 300, BUTTON_WIDTH, BUTTON_HEIGHT};
-    button4 = {100, 400, BUTTON_WIDTH, BUTTON_HEIGHT};
+Emulator::Emulator(GameRegistry& games) : window(nullptr), renderer(nullptr), backgroundTexture(nullptr), font(nullptr), gameOverScreen(500, 500, "font.ttf", 60, 1000), games(games), attract(nullptr), nextPreview(0), backgroundMusic(nullptr), gameReturned(0), menuPresented(0) {
+    for (double& micros : startupMicros) micros = 0;
+    // A column of buttons, squeezed together when there are many games
+    int spacing = BUTTON_SPACING;
+    if (games.size() > 1 && 100 + static_cast<int>(games.size()) * spacing > WINDOW_HEIGHT - 50) {
+        spacing = (WINDOW_HEIGHT - 150) / static_cast<int>(games.size() - 1);
+        if (spacing < BUTTON_HEIGHT + 4) spacing = BUTTON_HEIGHT + 4;
+    }
+    for (size_t i = 0; i < games.size(); ++i) {
+        SDL_Rect button = {100, 100 + static_cast<int>(i) * spacing, BUTTON_WIDTH, BUTTON_HEIGHT};
+        buttons.push_back(button);
+    }
 }
 
 Emulator::~Emulator() {
+    delete attract;
+    clearTextCache();
+    if (backgroundMusic) {
+        Mix_HaltMusic();
+        Mix_FreeMusic(backgroundMusic);
+    }
+    Mix_CloseAudio();
     TTF_CloseFont(font);
     SDL_DestroyTexture(backgroundTexture);
     SDL_DestroyRenderer(renderer);
@@ -54,23 +137,42 @@ Emulator::~Emulator() {
 }
 
 bool Emulator::init() {
+    Uint64 mark = SDL_GetPerformanceCounter();
+    auto finished = [this, &mark](StartupStep step) {
+        Uint64 now = SDL_GetPerformanceCounter();
+        startupMicros[step] = static_cast<double>(now - mark) * 1e6 / SDL_GetPerformanceFrequency();
+        mark = now;
+    };
+
     if (SDL_Init(SDL_INIT_VIDEO) < 0 || IMG_Init(IMG_INIT_PNG) < 0 || TTF_Init() < 0) {
         std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
         return false;
     }
+    finished(STARTUP_SDL_INIT);
 
     window = SDL_CreateWindow("Arcade Emulator", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_SHOWN);
     renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    finished(STARTUP_WINDOW);
     backgroundTexture = IMG_LoadTexture(renderer, "background.png");
+    finished(STARTUP_BACKGROUND);
     font = TTF_OpenFont("font.ttf", 24);
     if (!font) {
         std::cerr << "Failed to load font: " << TTF_GetError() << std::endl;
         return false;
     }
+    finished(STARTUP_FONT);
+    if (SDL_RenderTargetSupported(renderer)) attract = new AttractMode(renderer);
     if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
             std::cerr << "SDL_mixer could not initialize! SDL_mixer Error: " << Mix_GetError() << std::endl;//music implemented
             return false;
         }
+        finished(STARTUP_AUDIO);
+        int frequency = 0, channels = 0;
+        Uint16 format = 0;
+        if (Mix_QuerySpec(&frequency, &format, &channels)) {
+            audioBytesPerSecond = frequency * channels * (SDL_AUDIO_BITSIZE(format) / 8);
+            Mix_SetPostMix(watchAudio, nullptr);
+        }
 
         backgroundMusic = Mix_LoadMUS("game.mp3");
         if (!backgroundMusic) {
@@ -82,6 +184,7 @@ bool Emulator::init() {
             std::cerr << "SDL_mixer could not play music! SDL_mixer Error: " << Mix_GetError() << std::endl;
             return false;
         }
+        finished(STARTUP_MUSIC);
 
         return true;
     }
@@ -96,41 +199,66 @@ void Emulator::run() {
     SDL_Event e;
 
     while (!quit) {
+        heartbeat(LOOP_MAIN);
+        Uint64 start = SDL_GetPerformanceCounter();
         handleEvents();
+        recordPhase(PHASE_EVENTS, start);
         render();
     }
 }
 
+// A thumbnail left of the button with the game playing itself. This loads
+// the game's library; a game that fails to load keeps a plain button.
+void Emulator::startPreview(size_t index) {
+    const GameModule* game = games.module(index);
+    if (!game || !game->env || game->env->screenWidth <= 0 || game->env->screenHeight <= 0) return;
+    int width = BUTTON_HEIGHT * game->env->screenWidth / game->env->screenHeight;
+    SDL_Rect area = {buttons[index].x - 10 - width, buttons[index].y, width, BUTTON_HEIGHT};
+    attract->add(*game->env, area);
+}
+
 void Emulator::handleEvents() {
     SDL_Event e;
     while (SDL_PollEvent(&e) != 0) {
+        recordInput(e);
         if (e.type == SDL_QUIT) {
             quit = true;
+        } else if ((e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET) && attract) {
+            attract->invalidate();
         } else if (e.type == SDL_MOUSEBUTTONDOWN) {
             int x, y;
             SDL_GetMouseState(&x, &y);
 
-            if (isInside(x, y, button1)) {
-                runTetrisGame();
-                gameOverScreen.show();
-                std::cout << "Game Over" << std::endl;
-            } else if (isInside(x, y, button2)) {
-                runPongGame();
-                std::cout << "Pong" << std::endl;
-            } else if (isInside(x, y, button3)) {
-                runBrickGame();
-                gameOverScreen.show();
-                std::cout << "Game Over" << std::endl;
-            } else if (isInside(x, y, button4)) {
-                runSnakeGame();
-                gameOverScreen.show();
-                std::cout << "Game Over" << std::endl;
+            for (size_t i = 0; i < buttons.size(); ++i) {
+                if (!isInside(x, y, buttons[i])) continue;
+                launch(i);
+                break;
             }
         }
     }
 }
 
+// Plays a game until its window is closed, then shows the game over screen
+void Emulator::launch(size_t index) {
+    const GameModule* game = games.module(index); // Loaded already if its preview has started
+    if (!game) return;
+    metrics().activeGame.store(game->scoreName, std::memory_order_relaxed);
+    heartbeatIdle(LOOP_MAIN); // The game's own loop beats once it runs
+    game->run();
+    gameReturned = SDL_GetPerformanceCounter();
+    metrics().activeGame.store(nullptr, std::memory_order_relaxed);
+    clearTextCache(); // The best score may have changed
+    if (attract) attract->resume();
+    if (game->showGameOver) {
+        gameOverScreen.show();
+        std::cout << "Game Over" << std::endl;
+    } else {
+        std::cout << game->title << std::endl;
+    }
+}
+
 void Emulator::render() {
+    Uint64 start = SDL_GetPerformanceCounter();
     SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
     SDL_RenderClear(renderer);
 
@@ -139,37 +267,275 @@ void Emulator::render() {
     }
 
     SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255); // Button color
-    SDL_RenderFillRect(renderer, &button1);
-    SDL_RenderFillRect(renderer, &button2);
-    SDL_RenderFillRect(renderer, &button3);
-    SDL_RenderFillRect(renderer, &button4);
+    for (const SDL_Rect& button : buttons) SDL_RenderFillRect(renderer, &button);
+
+    if (attract) {
+        // Nobody is watching a hidden or minimised menu
+        if (SDL_GetWindowFlags(window) & (SDL_WINDOW_HIDDEN | SDL_WINDOW_MINIMIZED)) {
+            attract->resume();
+        } else {
+            attract->update();
+        }
+        attract->draw();
+    }
 
     SDL_Color textColor = {255, 255, 255, 255}; // Text color
 
-    renderText("Tetris", textColor, button1.x + (BUTTON_WIDTH - strlen("Tetris") * 12) / 2, button1.y + (BUTTON_HEIGHT - 24) / 2);
-    renderText("Pong", textColor, button2.x + (BUTTON_WIDTH - strlen("Pong") * 12) / 2, button2.y + (BUTTON_HEIGHT - 24) / 2);
-    renderText("Brick breaker", textColor, button3.x + (BUTTON_WIDTH - strlen("Brick breaker") * 12) / 2, button3.y + (BUTTON_HEIGHT - 24) / 2);
-    renderText("Snake", textColor, button4.x + (BUTTON_WIDTH - strlen("Snake") * 12) / 2, button4.y + (BUTTON_HEIGHT - 24) / 2);
+    for (size_t i = 0; i < buttons.size(); ++i) {
+        const GameRegistry::Entry& game = games.at(i);
+        int textWidth = static_cast<int>(game.title.size()) * 12;
+        renderText(game.title.c_str(), textColor, buttons[i].x + (BUTTON_WIDTH - textWidth) / 2, buttons[i].y + (BUTTON_HEIGHT - 24) / 2);
+        renderBestScore(game.scoreName.c_str(), textColor, buttons[i]);
+    }
+    recordPhase(PHASE_DRAW, start);
+
+    start = SDL_GetPerformanceCounter();
+    presentFrame(renderer);
+    recordPhase(PHASE_PRESENT, start);
+    menuPresented = SDL_GetPerformanceCounter();
 
-    SDL_RenderPresent(renderer);
+    // One game's library per frame, after the frame is up, so the menu shows
+    // at once and the thumbnails appear as their games load
+    if (attract && nextPreview < buttons.size()) startPreview(nextPreview++);
 }
 
 bool Emulator::isInside(int x, int y, SDL_Rect rect) {
     return (x > rect.x) && (x < rect.x + rect.w) && (y > rect.y) && (y < rect.y + rect.h);
 }
 
+// High score beside a game's button, read from the leaderboard's mapped index
+void Emulator::renderBestScore(const char* game, SDL_Color color, const SDL_Rect& button) {
+    int best = leaderboardFor(game).best();
+    if (best <= 0) return;
+    char text[32];
+    snprintf(text, sizeof(text), "Best: %d", best);
+    renderText(text, color, button.x + BUTTON_WIDTH + 20, button.y + (BUTTON_HEIGHT - 24) / 2);
+}
+
 void Emulator::renderText(const char* text, SDL_Color color, int x, int y) {
-    SDL_Surface* surface = TTF_RenderText_Solid(font, text, color);
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_Rect dstRect = {x, y, surface->w, surface->h};
-    SDL_RenderCopy(renderer, texture, NULL, &dstRect);
-    SDL_FreeSurface(surface);
-    SDL_DestroyTexture(texture);
+    const CachedText* found = nullptr;
+    for (const CachedText& cached : textCache) {
+        if (cached.text == text && cached.color.r == color.r && cached.color.g == color.g &&
+            cached.color.b == color.b && cached.color.a == color.a) {
+            found = &cached;
+            break;
+        }
+    }
+    if (!found) {
+        SDL_Surface* surface = TTF_RenderText_Solid(font, text, color);
+        if (!surface) return;
+        CachedText cached = {text, color, SDL_CreateTextureFromSurface(renderer, surface), surface->w, surface->h};
+        SDL_FreeSurface(surface);
+        textCache.push_back(cached);
+        found = &textCache.back();
+    }
+    SDL_Rect dstRect = {x, y, found->width, found->height};
+    SDL_RenderCopy(renderer, found->texture, NULL, &dstRect);
+}
+
+void Emulator::clearTextCache() {
+    for (CachedText& cached : textCache) SDL_DestroyTexture(cached.texture);
+    textCache.clear();
+}
+
+// What --bench-startup sees of a game while it is launched: the first
+// frame from a window other than the menu's, which it then closes as a
+// player would, and the last frame before the game goes
+struct LaunchProbe {
+    Uint32 menuWindow;
+    Uint32 gameWindow;
+    Uint64 firstFrame, lastFrame;
+};
+
+static LaunchProbe launchProbe;
+
+static void observeLaunch(SDL_Renderer* renderer) {
+    SDL_Window* window = SDL_RenderGetWindow(renderer);
+    Uint32 id = window ? SDL_GetWindowID(window) : 0;
+    if (id == launchProbe.menuWindow) return;
+    if (!launchProbe.gameWindow) {
+        launchProbe.gameWindow = id;
+        launchProbe.firstFrame = SDL_GetPerformanceCounter();
+        SDL_Event close;
+        SDL_zero(close);
+        close.type = SDL_WINDOWEVENT;
+        close.window.event = SDL_WINDOWEVENT_CLOSE;
+        close.window.windowID = id;
+        SDL_PushEvent(&close);
+    }
+    if (id == launchProbe.gameWindow) launchProbe.lastFrame = SDL_GetPerformanceCounter(); // Not the game over screen
+}
+
+static double millisBetween(Uint64 from, Uint64 to) {
+    return static_cast<double>(to - from) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+static void printPercentiles(const std::string& name, std::vector<double>& millis) {
+    if (millis.empty()) return;
+    std::sort(millis.begin(), millis.end());
+    auto at = [&millis](double fraction) { return millis[std::min(millis.size() - 1, static_cast<size_t>(fraction * millis.size()))]; };
+    std::cout << "  " << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(2)
+              << " p50 " << std::setw(8) << at(0.5) << " ms  p90 " << std::setw(8) << at(0.9) << " ms  p99 "
+              << std::setw(8) << at(0.99) << " ms  max " << std::setw(8) << millis.back() << " ms" << std::endl;
+}
+
+// Opens the menu from scratch passes times, each time launching every game,
+// closing it on its first frame and waiting for the menu to draw again, and
+// prints percentiles of each step. Runs on SDL's dummy video and audio
+// drivers unless SDL_VIDEODRIVER or SDL_AUDIODRIVER say otherwise.
+void benchmarkStartup(GameRegistry& games, int passes, Uint64 processStart) {
+    if (passes <= 0) return;
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+    SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+    SDL_setenv("SDL_RENDER_DRIVER", "software", 0); // Dummy windows have no accelerated renderer
+    setPresentObserver(observeLaunch);
+
+    std::vector<double> steps[STARTUP_STEPS], menu, processToMenu;
+    std::vector<std::vector<double> > firstFrame(games.size()), teardown(games.size()), gameOver(games.size()),
+        menuAgain(games.size()), exitToMenu(games.size());
+    for (int pass = 0; pass < passes; ++pass) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        Emulator* emulator = new Emulator(games);
+        if (!emulator->init()) {
+            delete emulator;
+            break;
+        }
+        launchProbe.menuWindow = SDL_GetWindowID(emulator->window);
+        Uint64 frameStart = SDL_GetPerformanceCounter();
+        emulator->render();
+        Uint64 ready = emulator->menuPresented; // Not the preview started after it
+        emulator->startupMicros[STARTUP_FIRST_FRAME] = millisBetween(frameStart, ready) * 1000.0;
+        for (int step = 0; step < STARTUP_STEPS; ++step) steps[step].push_back(emulator->startupMicros[step] / 1000.0);
+        menu.push_back(millisBetween(start, ready));
+        if (pass == 0) processToMenu.push_back(millisBetween(processStart, ready));
+
+        for (size_t i = 0; i < games.size(); ++i) {
+            launchProbe.gameWindow = 0;
+            Uint64 click = SDL_GetPerformanceCounter();
+            emulator->launch(i);
+            Uint64 closed = SDL_GetPerformanceCounter(); // The game over screen has gone too
+            emulator->render();
+            Uint64 back = emulator->menuPresented;
+            if (!launchProbe.gameWindow) continue; // Never showed a frame
+            firstFrame[i].push_back(millisBetween(click, launchProbe.firstFrame));
+            teardown[i].push_back(millisBetween(launchProbe.lastFrame, emulator->gameReturned));
+            gameOver[i].push_back(millisBetween(emulator->gameReturned, closed));
+            menuAgain[i].push_back(millisBetween(closed, back));
+            exitToMenu[i].push_back(millisBetween(launchProbe.lastFrame, back));
+        }
+        delete emulator;
+    }
+    setPresentObserver(nullptr);
+
+    std::cout << "Startup over " << menu.size() << " passes:" << std::endl;
+    printPercentiles("process start to menu (first)", processToMenu);
+    printPercentiles("menu start to first frame", menu);
+    for (int step = 0; step < STARTUP_STEPS; ++step) printPercentiles(std::string("  ") + STARTUP_STEP_NAMES[step], steps[step]);
+    for (size_t i = 0; i < games.size(); ++i) {
+        const std::string& title = games.at(i).title;
+        printPercentiles(title + ": click to first frame", firstFrame[i]);
+        printPercentiles(title + ": last frame to menu", exitToMenu[i]);
+        printPercentiles("  game shutdown", teardown[i]);
+        const GameModule* game = games.module(i);
+        if (game && game->showGameOver) printPercentiles("  game over screen", gameOver[i]);
+        printPercentiles("  menu frame", menuAgain[i]);
+    }
 }
 
 int main(int argc, char* argv[]) {
-    Emulator emulator;
+    Uint64 processStart = SDL_GetPerformanceCounter();
+    trackSdlAllocations();
+    startEventLog("arcade-events");
+    Uint32 stallMs = DEFAULT_STALL_MS;
+
+    // Options for every game go before any other option:
+    // Emulator [--export-frames [/name]] [--soft-raster [threads]] [--metrics [port]] [--stall-ms <ms>]
+    //          [--crt [fast|balanced|full]] ...
+    for (;;) {
+        int used = 0;
+        if (argc >= 2 && strcmp(argv[1], "--export-frames") == 0) {
+            // Mirror every frame to shared memory for a local compositor
+            used = argc >= 3 && argv[2][0] == '/' ? 2 : 1;
+            frameExport().start(used == 2 ? argv[2] : FRAME_SHARE_NAME);
+        } else if (argc >= 2 && strcmp(argv[1], "--soft-raster") == 0) {
+            // Draw the games' rects on the CPU
+            used = argc >= 3 && atoi(argv[2]) > 0 ? 2 : 1;
+            enableSoftRaster(used == 2 ? atoi(argv[2]) - 1 : 0);
+        } else if (argc >= 2 && strcmp(argv[1], "--metrics") == 0) {
+            // Serve counters and timings to a Prometheus scraper on this machine
+            used = argc >= 3 && atoi(argv[2]) > 0 ? 2 : 1;
+            startMetricsServer(used == 2 ? atoi(argv[2]) : METRICS_PORT);
+        } else if (argc >= 3 && strcmp(argv[1], "--stall-ms") == 0) {
+            // Freezes longer than this are written to stalls/; 0 turns that off
+            used = 2;
+            stallMs = static_cast<Uint32>(atoi(argv[2]));
+        } else if (argc >= 2 && strcmp(argv[1], "--crt") == 0) {
+            // Scanlines, phosphor mask, bloom and curvature over every frame
+            used = argc >= 3 && parseCrtQuality(argv[2]) != CRT_OFF ? 2 : 1;
+            crtFilter().setQuality(used == 2 ? parseCrtQuality(argv[2]) : CRT_BALANCED);
+            std::cout << "CRT filter " << crtQualityName(crtFilter().getQuality()) << std::endl;
+        }
+        if (!used) break;
+        argc -= used;
+        argv += used;
+    }
+    startStallWatch(stallMs);
+
+    // The menu lists the games from games.txt. Other options, such as
+    // --net-pong, --brick-stress and --bench-savestate, belong to the games.
+    GameRegistry games;
+    games.loadManifest("games.txt");
+    if (argc >= 3 && strcmp(argv[1], "--bench-env") == 0) {
+        // Emulator --bench-env <game> [copies [steps [state|pixels]]]
+        const GameModule* game = games.find(argv[2]);
+        if (!game || !game->env) return 1;
+        benchmarkBatchedEnv(argv[2], *game->env, argc > 3 ? atoi(argv[3]) : 1024, argc > 4 ? atoi(argv[4]) : 1000,
+                            argc > 5 && strcmp(argv[5], "pixels") == 0 ? ENV_OBSERVE_PIXELS : ENV_OBSERVE_STATE);
+        return 0;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-startup") == 0) {
+        // Emulator --bench-startup [passes]
+        benchmarkStartup(games, argc > 2 ? atoi(argv[2]) : 10, processStart);
+        return 0;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-crt") == 0) {
+        // Emulator --bench-crt [frames [width height]]
+        benchmarkCrt(argc > 2 ? atoi(argv[2]) : 300, argc > 4 ? atoi(argv[3]) : 1000, argc > 4 ? atoi(argv[4]) : 800);
+        return 0;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-scheduler") == 0) {
+        // Emulator --bench-scheduler [copies [seconds]]: every game at once
+        // on one thread
+        std::vector<const GameModule*> modules;
+        for (size_t i = 0; i < games.size(); ++i) {
+            if (const GameModule* game = games.module(i)) modules.push_back(game);
+        }
+        benchmarkScheduler(modules, argc > 2 ? atoi(argv[2]) : 4, argc > 3 ? atoi(argv[3]) : 5);
+        return 0;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--check-allocs") == 0) {
+        // Emulator --check-allocs [ticks]: exits with 1 if a game allocates
+        // once it is under way
+        int ticks = argc > 2 ? atoi(argv[2]) : 3600;
+        bool clean = true;
+        for (size_t i = 0; i < games.size(); ++i) {
+            const GameModule* game = games.module(i);
+            if (game && checkGameAllocations(*game, ticks) > 0) clean = false;
+        }
+        return clean ? 0 : 1;
+    }
+    if (argc >= 2) {
+        if (games.runCommand(argc, argv)) return 0;
+        std::cerr << "Unknown option " << argv[1] << std::endl;
+        return 1;
+    }
+
+    Emulator emulator(games);
     emulator.run();
     return 0;
 }
-//g++ -std=c++11 -o Emulator emulator.cpp tetris.cpp brick_breaker.cpp pong.cpp snake.cpp game_over.cpp -IC:\mingw_dev_lib\include\SDL2 -LC:\mingw_dev_lib\lib -lmingw32 -lSDL2main -lSDL2 -lSDL2_image -lSDL2_ttf -lSDL2_mixer
\ No newline at end of file
+// Build the shared code once, each game as a module in games/, then the emulator itself:
+//g++ -std=c++11 -shared -o arcade_core.dll game_over.cpp udp_channel.cpp mapped_file.cpp event_log.cpp leaderboard.cpp save_state.cpp rewind_buffer.cpp video_capture.cpp frame_export.cpp frame_pipeline.cpp render_snapshot.cpp simulation.cpp thread_pool.cpp soft_raster.cpp batched_env.cpp alloc_tracker.cpp metrics.cpp flight_recorder.cpp crt_filter.cpp game_scheduler.cpp -Wl,--out-implib,libarcade_core.a -IC:\mingw_dev_lib\include\SDL2 -LC:\mingw_dev_lib\lib -lmingw32 -lSDL2 -lSDL2_image -lSDL2_ttf -lSDL2_net -lpsapi -ldbghelp -lws2_32
+//g++ -std=c++11 -shared -o games/tetris.dll tetris.cpp -IC:\mingw_dev_lib\include\SDL2 -LC:\mingw_dev_lib\lib -L. -larcade_core -lmingw32 -lSDL2 -lSDL2_ttf   (likewise pong.cpp, brick_breaker.cpp, snake.cpp)
+//g++ -std=c++11 -shared -DARCADE_ENV_BUILD -o arcade_env.dll arcade_env.cpp game_registry.cpp -IC:\mingw_dev_lib\include\SDL2 -LC:\mingw_dev_lib\lib -L. -larcade_core -lmingw32 -lSDL2   (the C interface for training, see arcade_env.h)
+//g++ -std=c++11 -o Emulator emulator.cpp game_registry.cpp attract_mode.cpp -IC:\mingw_dev_lib\include\SDL2 -LC:\mingw_dev_lib\lib -L. -larcade_core -lmingw32 -lSDL2main -lSDL2 -lSDL2_image -lSDL2_ttf -lSDL2_mixer
\ No newline at end of file
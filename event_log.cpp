@@ -0,0 +1,176 @@
+#include "event_log.h"
+#include "flight_recorder.h"
+#include "spsc_ring.h"
+#include <SDL.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t RING_CAPACITY = 8192;   // About 200 KB of records
+const int WRITE_BATCH = 256;
+const Uint32 IDLE_WAIT_MS = 5;
+
+SpscRing<EventRecord, RING_CAPACITY> ring;
+
+// Producer side
+uint32_t nextSequence = 0;
+std::vector<EventRecord> overflow;   // Records that did not fit in the ring, in order
+size_t overflowStart = 0;
+
+// Writer side
+SDL_Thread* writerThread = nullptr;
+std::atomic<bool> writerRunning(false);
+std::atomic<bool> stopRequested(false);
+std::string filePrefix;
+uint32_t maxBytes = 0;
+bool echoToConsole = true;
+uint64_t runStartNs = 0;
+FILE* file = nullptr;
+uint32_t fileIndex = 0;
+uint32_t fileBytes = 0;
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+bool openNextFile() {
+    if (file) fclose(file);
+    fileIndex++;
+    char name[512];
+    snprintf(name, sizeof(name), "%s-%llu-%04u.log", filePrefix.c_str(),
+             static_cast<unsigned long long>(runStartNs / 1000000000ull), fileIndex);
+    file = fopen(name, "wb");
+    if (!file) {
+        std::cerr << "Cannot open event log " << name << std::endl;
+        return false;
+    }
+    EventFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, EVENT_LOG_MAGIC, 4);
+    header.version = EVENT_LOG_VERSION;
+    header.recordSize = sizeof(EventRecord);
+    header.fileIndex = fileIndex;
+    header.runStartNs = runStartNs;
+    fwrite(&header, sizeof(header), 1, file);
+    fileBytes = sizeof(header);
+    return true;
+}
+
+void writeBatch(const EventRecord* records, int count) {
+    for (int i = 0; i < count; ++i) {
+        if (file && fileBytes + sizeof(EventRecord) > maxBytes) openNextFile();
+        if (file) {
+            fwrite(&records[i], sizeof(EventRecord), 1, file);
+            fileBytes += sizeof(EventRecord);
+        }
+        if (echoToConsole) {
+            char text[128];
+            formatEvent(records[i], text, sizeof(text));
+            fputs(text, stdout);
+            fputc('\n', stdout);
+        }
+    }
+    // One flush per batch instead of one per event
+    if (file) fflush(file);
+    if (echoToConsole) fflush(stdout);
+}
+
+// Drains the ring until asked to stop, then drains it once more
+int writerMain(void*) {
+    EventRecord batch[WRITE_BATCH];
+    for (;;) {
+        bool stopping = stopRequested.load(std::memory_order_acquire);
+        int count = 0;
+        while (count < WRITE_BATCH && ring.pop(batch[count])) count++;
+        if (count > 0) {
+            writeBatch(batch, count);
+        } else if (stopping) {
+            break;
+        } else {
+            SDL_Delay(IDLE_WAIT_MS);
+        }
+    }
+    if (file) fclose(file);
+    file = nullptr;
+    return 0;
+}
+
+// Moves waiting overflow records into the ring, oldest first
+void drainOverflow() {
+    while (overflowStart < overflow.size() && ring.push(overflow[overflowStart])) overflowStart++;
+    if (overflowStart == overflow.size()) {
+        overflow.clear();
+        overflowStart = 0;
+    }
+}
+
+} // namespace
+
+bool startEventLog(const char* prefix, uint32_t maxFileBytes, bool echo) {
+    if (writerRunning) return true;
+    filePrefix = prefix;
+    maxBytes = maxFileBytes < 4096 ? 4096 : maxFileBytes;
+    echoToConsole = echo;
+    runStartNs = nowNs();
+    fileIndex = 0;
+    if (!openNextFile()) return false;
+
+    stopRequested = false;
+    writerThread = SDL_CreateThread(writerMain, "EventLog", nullptr);
+    if (!writerThread) {
+        std::cerr << "Cannot start event log thread: " << SDL_GetError() << std::endl;
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+    writerRunning = true;
+    static bool registered = false;
+    if (!registered) {
+        atexit(stopEventLog); // Flushed even if the process exits early
+        registered = true;
+    }
+    return true;
+}
+
+void stopEventLog() {
+    if (!writerRunning) return;
+    // Shutdown may wait for the writer; play never does
+    while (!overflow.empty()) {
+        drainOverflow();
+        if (!overflow.empty()) SDL_Delay(1);
+    }
+    stopRequested.store(true, std::memory_order_release);
+    SDL_WaitThread(writerThread, nullptr);
+    writerThread = nullptr;
+    writerRunning = false;
+}
+
+void logEvent(EventGame game, EventType type, int32_t value0, int32_t value1) {
+    recordGameEvent(game, type, value0, value1);
+    EventRecord record;
+    record.timeNs = nowNs();
+    record.sequence = nextSequence++;
+    record.type = type;
+    record.game = game;
+    record.reserved = 0;
+    record.value0 = value0;
+    record.value1 = value1;
+
+    if (!writerRunning) {
+        char text[128];
+        formatEvent(record, text, sizeof(text));
+        std::cout << text << '\n';
+        return;
+    }
+    if (!overflow.empty()) drainOverflow();
+    if (!overflow.empty() || !ring.push(record)) {
+        overflow.push_back(record);
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <cstdint>
+#include <cstdio>
+
+// Game events (scores, lives, game over...) are recorded as fixed-size
+// binary records. logEvent() only copies a record into a queue; a
+// background thread writes them to numbered log files and echoes them to
+// the console. Use event_reader to decode the files.
+
+enum EventGame : uint8_t {
+    GAME_EMULATOR = 0,
+    GAME_TETRIS = 1,
+    GAME_PONG = 2,
+    GAME_BRICK = 3,
+    GAME_SNAKE = 4
+};
+
+enum EventType : uint16_t {
+    EVENT_GAME_START = 1,
+    EVENT_GAME_OVER = 2,   // value0: final score
+    EVENT_QUIT = 3,        // window closed
+    EVENT_SCORE = 4,       // value0: score, value1: points added
+    EVENT_LIFE_LOST = 5,   // value0: lives left
+    EVENT_LEVEL = 6,       // value0: level reached
+    EVENT_PONG_SCORES = 7, // value0: paddle A, value1: paddle B
+    EVENT_STATE_SAVED = 8, // value0: quick save slot, value1: bytes
+    EVENT_STATE_LOADED = 9 // value0: quick save slot, value1: bytes
+};
+
+struct EventRecord {
+    uint64_t timeNs;     // Wall clock, nanoseconds since the Unix epoch
+    uint32_t sequence;   // Consecutive across a run, so gaps are detectable
+    uint16_t type;
+    uint8_t game;
+    uint8_t reserved;
+    int32_t value0;
+    int32_t value1;
+};
+
+static_assert(sizeof(EventRecord) == 24, "EventRecord is a file format");
+
+// Every log file starts with this header
+struct EventFileHeader {
+    char magic[4];        // "AELG"
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t fileIndex;   // 1, 2, 3... within a run
+    uint32_t reserved;
+    uint64_t runStartNs;  // Identifies the run the file belongs to
+};
+
+#define EVENT_LOG_MAGIC "AELG"
+const uint16_t EVENT_LOG_VERSION = 1;
+
+// Starts the writer thread. Files are named <prefix>-<runStart>-<index>.log
+// and a new one is started once maxFileBytes is reached; old files are
+// never deleted. Before this is called, or if it fails, events are printed
+// directly instead.
+bool startEventLog(const char* prefix, uint32_t maxFileBytes = 4 * 1024 * 1024, bool echo = true);
+
+// Writes everything still queued and stops the writer. Also run at exit.
+void stopEventLog();
+
+// Game thread only. Never blocks and never drops an event: if the writer
+// falls behind, records wait in a side buffer until the queue has room.
+void logEvent(EventGame game, EventType type, int32_t value0 = 0, int32_t value1 = 0);
+
+inline const char* eventGameName(uint8_t game) {
+    switch (game) {
+        case GAME_EMULATOR: return "emulator";
+        case GAME_TETRIS: return "tetris";
+        case GAME_PONG: return "pong";
+        case GAME_BRICK: return "brick";
+        case GAME_SNAKE: return "snake";
+    }
+    return "unknown";
+}
+
+inline const char* eventTypeName(uint16_t type) {
+    switch (type) {
+        case EVENT_GAME_START: return "start";
+        case EVENT_GAME_OVER: return "game over";
+        case EVENT_QUIT: return "quit";
+        case EVENT_SCORE: return "score";
+        case EVENT_LIFE_LOST: return "life lost";
+        case EVENT_LEVEL: return "level";
+        case EVENT_PONG_SCORES: return "scores";
+        case EVENT_STATE_SAVED: return "state saved";
+        case EVENT_STATE_LOADED: return "state loaded";
+    }
+    return "unknown";
+}
+
+// One line of text, as echoed to the console and printed by event_reader
+inline int formatEvent(const EventRecord& record, char* text, size_t size) {
+    const char* game = eventGameName(record.game);
+    switch (record.type) {
+        case EVENT_SCORE:
+            return snprintf(text, size, "[%s] score %d (+%d)", game, record.value0, record.value1);
+        case EVENT_GAME_OVER:
+            return snprintf(text, size, "[%s] game over, score %d", game, record.value0);
+        case EVENT_LIFE_LOST:
+            return snprintf(text, size, "[%s] life lost, %d left", game, record.value0);
+        case EVENT_LEVEL:
+            return snprintf(text, size, "[%s] level %d", game, record.value0);
+        case EVENT_PONG_SCORES:
+            return snprintf(text, size, "[%s] paddle A %d, paddle B %d", game, record.value0, record.value1);
+        case EVENT_STATE_SAVED:
+        case EVENT_STATE_LOADED:
+            return snprintf(text, size, "[%s] %s, slot %d, %d bytes", game, eventTypeName(record.type), record.value0, record.value1);
+    }
+    return snprintf(text, size, "[%s] %s", game, eventTypeName(record.type));
+}
+
+#endif
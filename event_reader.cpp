@@ -0,0 +1,87 @@
+#include "event_log.h"
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+
+// Prints the records in one or more event log files. Give the files of a
+// run in order; missing sequence numbers are reported as gaps.
+//
+// Usage:
+//   event_reader [--raw] <file.log>...
+
+static void printTime(uint64_t timeNs) {
+    time_t seconds = static_cast<time_t>(timeNs / 1000000000ull);
+    struct tm* local = localtime(&seconds);
+    char stamp[32];
+    if (local) {
+        strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", local);
+    } else {
+        snprintf(stamp, sizeof(stamp), "%llu", static_cast<unsigned long long>(seconds));
+    }
+    printf("%s.%06u ", stamp, static_cast<unsigned>((timeNs / 1000) % 1000000));
+}
+
+int main(int argc, char* argv[]) {
+    bool raw = false;
+    int first = 1;
+    if (argc > 1 && std::string(argv[1]) == "--raw") {
+        raw = true;
+        first = 2;
+    }
+    if (first >= argc) {
+        std::cerr << "Usage: event_reader [--raw] <file.log>..." << std::endl;
+        return 1;
+    }
+
+    bool haveSequence = false;
+    uint32_t expected = 0;
+    uint64_t runStart = 0;
+    long long records = 0, missing = 0;
+    for (int a = first; a < argc; ++a) {
+        FILE* file = fopen(argv[a], "rb");
+        if (!file) {
+            std::cerr << "Cannot open " << argv[a] << std::endl;
+            return 1;
+        }
+        EventFileHeader header;
+        if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, EVENT_LOG_MAGIC, 4) != 0 ||
+            header.version != EVENT_LOG_VERSION || header.recordSize != sizeof(EventRecord)) {
+            std::cerr << argv[a] << " is not an event log this reader understands" << std::endl;
+            fclose(file);
+            return 1;
+        }
+        if (runStart != header.runStartNs) {
+            runStart = header.runStartNs;
+            haveSequence = false; // Sequence numbers restart with each run
+        }
+
+        EventRecord record;
+        while (fread(&record, sizeof(record), 1, file) == 1) {
+            if (haveSequence && record.sequence != expected) {
+                printf("-- gap: expected event %u, found %u\n", expected, record.sequence);
+                missing += static_cast<uint32_t>(record.sequence - expected);
+            }
+            expected = record.sequence + 1;
+            haveSequence = true;
+            records++;
+
+            if (raw) {
+                printf("%llu %u %u %u %d %d\n", static_cast<unsigned long long>(record.timeNs), record.sequence,
+                       record.game, record.type, record.value0, record.value1);
+            } else {
+                char text[128];
+                formatEvent(record, text, sizeof(text));
+                printTime(record.timeNs);
+                printf("#%u %s\n", record.sequence, text);
+            }
+        }
+        fclose(file);
+    }
+    std::cerr << records << " events";
+    if (missing) std::cerr << ", " << missing << " missing";
+    std::cerr << std::endl;
+    return missing ? 2 : 0;
+}
+
+//g++ -std=c++11 -o event_reader event_reader.cpp
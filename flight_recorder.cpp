@@ -0,0 +1,340 @@
+#include "flight_recorder.h"
+#include "event_log.h"
+#include "metrics.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <dbghelp.h>
+#include <direct.h>
+#else
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+const int RING_SIZE = 16384;           // About 20 s of a 60 Hz game
+const int DUMP_SECONDS = 5;
+const Uint32 WATCH_INTERVAL_MS = 10;
+const int MAX_DUMPS = 20;              // Per run, so a sick machine cannot fill the disk
+const int MAX_STACK = 64;
+
+enum RecordKind : Uint8 {
+    KIND_PHASE,        // detail: FlightPhase, value0: microseconds
+    KIND_KEY,          // detail: 1 down, 0 up, value0: scancode, value1: repeat
+    KIND_MOUSE,        // detail: button, value0, value1: position
+    KIND_GAME_EVENT    // detail: game << 16 | type, values as logged
+};
+
+// Written by any thread, read by the watchdog. A slot's sequence is 0
+// while it is being written and its index + 1 afterwards, so a reader can
+// tell a torn slot from a whole one.
+struct FlightSlot {
+    std::atomic<Uint64> sequence;
+    std::atomic<Uint64> time;          // Performance counter
+    std::atomic<Uint32> what;          // kind << 24 | detail
+    std::atomic<Sint32> value0;
+    std::atomic<Sint32> value1;
+};
+
+FlightSlot ring[RING_SIZE];
+std::atomic<Uint64> nextIndex(0);
+std::atomic<Uint64> beats[LOOP_COUNT];   // Performance counter of the last heartbeat, 0 when idle
+
+Uint32 threshold = 0;
+SDL_Thread* watchThread = nullptr;
+std::atomic<bool> stopRequested(false);
+void* stackFrames[MAX_STACK];
+
+#ifdef _WIN32
+HANDLE mainThread = nullptr;
+#else
+const int STACK_SIGNAL = SIGUSR2;
+pthread_t mainThread;
+std::atomic<int> stackDepth(-1);   // Set by the signal handler on the main thread
+
+void stackSignal(int) {
+    stackDepth.store(backtrace(stackFrames, MAX_STACK), std::memory_order_release);
+}
+#endif
+
+void record(RecordKind kind, Uint32 detail, Sint32 value0, Sint32 value1) {
+    Uint64 index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+    FlightSlot& slot = ring[index % RING_SIZE];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.time.store(SDL_GetPerformanceCounter(), std::memory_order_relaxed);
+    slot.what.store(static_cast<Uint32>(kind) << 24 | (detail & 0xFFFFFF), std::memory_order_relaxed);
+    slot.value0.store(value0, std::memory_order_relaxed);
+    slot.value1.store(value1, std::memory_order_relaxed);
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+const char* phaseName(Uint32 phase) {
+    switch (phase) {
+        case PHASE_EVENTS: return "events";
+        case PHASE_DRAW: return "draw";
+        case PHASE_PRESENT: return "present";
+        case PHASE_TICK: return "tick";
+    }
+    return "unknown";
+}
+
+const char* loopName(int loop) {
+    return loop == LOOP_MAIN ? "main" : "simulation";
+}
+
+// The main thread's return addresses in stackFrames, stopped wherever it
+// is stuck. Returns how many, 0 if it could not be stopped.
+int captureMainStack() {
+#ifdef _WIN32
+    if (!mainThread || SuspendThread(mainThread) == static_cast<DWORD>(-1)) return 0;
+    int depth = 0;
+    CONTEXT context;
+    ZeroMemory(&context, sizeof(context));
+    context.ContextFlags = CONTEXT_FULL;
+    if (GetThreadContext(mainThread, &context)) {
+        STACKFRAME64 frame;
+        ZeroMemory(&frame, sizeof(frame));
+#if defined(_M_X64) || defined(__x86_64__)
+        DWORD machine = IMAGE_FILE_MACHINE_AMD64;
+        frame.AddrPC.Offset = context.Rip;
+        frame.AddrFrame.Offset = context.Rbp;
+        frame.AddrStack.Offset = context.Rsp;
+#else
+        DWORD machine = IMAGE_FILE_MACHINE_I386;
+        frame.AddrPC.Offset = context.Eip;
+        frame.AddrFrame.Offset = context.Ebp;
+        frame.AddrStack.Offset = context.Esp;
+#endif
+        frame.AddrPC.Mode = frame.AddrFrame.Mode = frame.AddrStack.Mode = AddrModeFlat;
+        while (depth < MAX_STACK &&
+               StackWalk64(machine, GetCurrentProcess(), mainThread, &frame, &context, NULL,
+                           SymFunctionTableAccess64, SymGetModuleBase64, NULL) &&
+               frame.AddrPC.Offset) {
+            stackFrames[depth++] = reinterpret_cast<void*>(frame.AddrPC.Offset);
+        }
+    }
+    ResumeThread(mainThread);
+    return depth;
+#else
+    // The handler runs on the main thread even while it is blocked in a
+    // system call; SA_RESTART resumes the call afterwards
+    stackDepth.store(-1, std::memory_order_relaxed);
+    if (pthread_kill(mainThread, STACK_SIGNAL) != 0) return 0;
+    for (int waited = 0; waited < 100; ++waited) {
+        int depth = stackDepth.load(std::memory_order_acquire);
+        if (depth >= 0) return depth;
+        SDL_Delay(1);
+    }
+    return 0;
+#endif
+}
+
+void writeStack(FILE* file, int depth) {
+    if (depth == 0) {
+        fprintf(file, "  (the main thread could not be stopped)\n");
+        return;
+    }
+#ifdef _WIN32
+    HANDLE process = GetCurrentProcess();
+    char buffer[sizeof(SYMBOL_INFO) + 256];
+    SYMBOL_INFO* symbol = reinterpret_cast<SYMBOL_INFO*>(buffer);
+    for (int i = 0; i < depth; ++i) {
+        DWORD64 address = reinterpret_cast<DWORD64>(stackFrames[i]);
+        DWORD64 offset = 0;
+        ZeroMemory(buffer, sizeof(buffer));
+        symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+        symbol->MaxNameLen = 255;
+        if (SymFromAddr(process, address, &offset, symbol)) {
+            fprintf(file, "  %s+0x%llx\n", symbol->Name, static_cast<unsigned long long>(offset));
+        } else {
+            fprintf(file, "  0x%llx\n", static_cast<unsigned long long>(address));
+        }
+    }
+#else
+    fflush(file);
+    backtrace_symbols_fd(stackFrames, depth, fileno(file));
+#endif
+}
+
+// The records of the last few seconds, oldest first, timed from now
+void writeRing(FILE* file, Uint64 now) {
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 end = nextIndex.load(std::memory_order_acquire);
+    Uint64 begin = end > static_cast<Uint64>(RING_SIZE) ? end - RING_SIZE : 0;
+    Uint64 oldest = now > DUMP_SECONDS * frequency ? now - DUMP_SECONDS * frequency : 0;
+    for (Uint64 i = begin; i < end; ++i) {
+        const FlightSlot& slot = ring[i % RING_SIZE];
+        Uint64 sequence = slot.sequence.load(std::memory_order_acquire);
+        Uint64 time = slot.time.load(std::memory_order_relaxed);
+        Uint32 what = slot.what.load(std::memory_order_relaxed);
+        Sint32 value0 = slot.value0.load(std::memory_order_relaxed);
+        Sint32 value1 = slot.value1.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence != i + 1 || slot.sequence.load(std::memory_order_relaxed) != sequence) continue;
+        if (time < oldest) continue;
+
+        double ms = (static_cast<double>(time) - static_cast<double>(now)) * 1000.0 / frequency;
+        Uint32 detail = what & 0xFFFFFF;
+        fprintf(file, "%10.3f  ", ms);
+        switch (what >> 24) {
+            case KIND_PHASE:
+                fprintf(file, "%-8s %d us\n", phaseName(detail), value0);
+                break;
+            case KIND_KEY:
+                fprintf(file, "key %s %s%s\n", detail ? "down" : "up",
+                        SDL_GetScancodeName(static_cast<SDL_Scancode>(value0)), value1 ? " (repeat)" : "");
+                break;
+            case KIND_MOUSE:
+                fprintf(file, "mouse button %u at %d,%d\n", detail, value0, value1);
+                break;
+            case KIND_GAME_EVENT: {
+                EventRecord event = {};
+                event.game = static_cast<uint8_t>(detail >> 16);
+                event.type = static_cast<uint16_t>(detail & 0xFFFF);
+                event.value0 = value0;
+                event.value1 = value1;
+                char text[128];
+                formatEvent(event, text, sizeof(text));
+                fprintf(file, "%s\n", text);
+                break;
+            }
+        }
+    }
+}
+
+// Opened while the loop is still stuck; the caller adds how long it lasted
+FILE* dumpStall(int loop, Uint64 silentMs, Uint64 now, int number) {
+#ifdef _WIN32
+    _mkdir("stalls");
+#else
+    mkdir("stalls", 0755);
+#endif
+    char path[96];
+    snprintf(path, sizeof(path), "stalls/stall-%lld-%d.txt", static_cast<long long>(time(nullptr)), number);
+    int depth = captureMainStack();
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        std::cerr << "Cannot write stall report " << path << std::endl;
+        return nullptr;
+    }
+    const char* game = metrics().activeGame.load(std::memory_order_relaxed);
+    fprintf(file, "The %s loop has been stuck for %llu ms (threshold %u ms), playing %s\n\nMain thread stack:\n",
+            loopName(loop), static_cast<unsigned long long>(silentMs), threshold, game ? game : "the menu");
+    writeStack(file, depth);
+    fprintf(file, "\nThe last %d s, in ms before the stall was noticed:\n", DUMP_SECONDS);
+    writeRing(file, now);
+    fflush(file);
+    std::cerr << "The " << loopName(loop) << " loop stalled for " << silentMs << " ms, see " << path << std::endl;
+    return file;
+}
+
+int watchMain(void*) {
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 reported[LOOP_COUNT] = {};
+    FILE* open[LOOP_COUNT] = {};
+    int dumps = 0;
+    while (!stopRequested.load(std::memory_order_acquire)) {
+        SDL_Delay(WATCH_INTERVAL_MS);
+        Uint64 now = SDL_GetPerformanceCounter();
+        for (int loop = 0; loop < LOOP_COUNT; ++loop) {
+            Uint64 beat = beats[loop].load(std::memory_order_acquire);
+            if (open[loop] && beat != reported[loop]) {
+                // Moving again (or idle): the stall is over
+                Uint64 lasted = beat ? (beat - reported[loop]) * 1000 / frequency : 0;
+                if (beat) fprintf(open[loop], "\nThe loop went on after %llu ms\n", static_cast<unsigned long long>(lasted));
+                fclose(open[loop]);
+                open[loop] = nullptr;
+            }
+            if (!beat || beat >= now || beat == reported[loop]) continue;
+            Uint64 silentMs = (now - beat) * 1000 / frequency;
+            if (silentMs < threshold) continue;
+            reported[loop] = beat;
+            if (dumps < MAX_DUMPS) open[loop] = dumpStall(loop, silentMs, now, ++dumps);
+        }
+    }
+    for (int loop = 0; loop < LOOP_COUNT; ++loop) {
+        if (open[loop]) fclose(open[loop]);
+    }
+    return 0;
+}
+
+} // namespace
+
+void recordPhase(FlightPhase phase, Uint64 start) {
+    Uint64 micros = (SDL_GetPerformanceCounter() - start) * 1000000 / SDL_GetPerformanceFrequency();
+    record(KIND_PHASE, phase, static_cast<Sint32>(micros), 0);
+}
+
+void recordInput(const SDL_Event& event) {
+    if (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
+        record(KIND_KEY, event.type == SDL_KEYDOWN ? 1 : 0, event.key.keysym.scancode, event.key.repeat);
+    } else if (event.type == SDL_MOUSEBUTTONDOWN) {
+        record(KIND_MOUSE, event.button.button, event.button.x, event.button.y);
+    }
+}
+
+void recordGameEvent(uint8_t game, uint16_t type, int32_t value0, int32_t value1) {
+    record(KIND_GAME_EVENT, static_cast<Uint32>(game) << 16 | type, value0, value1);
+}
+
+void heartbeat(FlightLoop loop) {
+    beats[loop].store(SDL_GetPerformanceCounter(), std::memory_order_release);
+}
+
+void heartbeatIdle(FlightLoop loop) {
+    beats[loop].store(0, std::memory_order_release);
+}
+
+bool startStallWatch(Uint32 thresholdMs) {
+    if (watchThread || thresholdMs == 0) return true;
+    threshold = thresholdMs;
+#ifdef _WIN32
+    if (!DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &mainThread,
+                         THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION, FALSE, 0)) {
+        mainThread = nullptr;
+    }
+    SymInitialize(GetCurrentProcess(), NULL, TRUE);
+#else
+    mainThread = pthread_self();
+    backtrace(stackFrames, 1); // Loads the unwinder now rather than inside the signal handler
+    struct sigaction action = {};
+    action.sa_handler = stackSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(STACK_SIGNAL, &action, nullptr);
+#endif
+    metrics();
+    stopRequested = false;
+    watchThread = SDL_CreateThread(watchMain, "StallWatch", nullptr);
+    if (!watchThread) {
+        std::cerr << "Cannot start the stall watchdog: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    static bool registered = false;
+    if (!registered) {
+        atexit(stopStallWatch);
+        registered = true;
+    }
+    return true;
+}
+
+void stopStallWatch() {
+    if (!watchThread) return;
+    stopRequested.store(true, std::memory_order_release);
+    SDL_WaitThread(watchThread, nullptr);
+    watchThread = nullptr;
+#ifdef _WIN32
+    SymCleanup(GetCurrentProcess());
+    CloseHandle(mainThread);
+    mainThread = nullptr;
+#endif
+}
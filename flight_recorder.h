@@ -0,0 +1,53 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <SDL.h>
+#include <cstdint>
+
+// Always-on record of the last seconds of play, for freezes that cannot be
+// reproduced. Game loops note how long each phase of a frame took, the
+// input they saw and the game events they logged into a fixed ring; each
+// note is a handful of relaxed atomic stores, so it stays on in release
+// builds. A watchdog thread checks the loops' heartbeats, and when one has
+// been silent past the threshold it writes the ring and the main thread's
+// stack to stalls/stall-<time>-<n>.txt while the stall is still going on.
+
+enum FlightPhase : Uint8 {
+    PHASE_EVENTS,    // Main thread: polling and handling events
+    PHASE_DRAW,      // Main thread: drawing a snapshot or the menu
+    PHASE_PRESENT,   // Main thread: presentFrame()
+    PHASE_TICK       // Simulation: one tick and its snapshot
+};
+
+enum FlightLoop {
+    LOOP_MAIN,         // The menu's or a game's main thread loop
+    LOOP_SIMULATION,   // runSimulation()'s tick thread
+    LOOP_COUNT
+};
+
+const Uint32 DEFAULT_STALL_MS = 250;
+
+// Notes that a phase which started at SDL_GetPerformanceCounter() value
+// start has just ended
+void recordPhase(FlightPhase phase, Uint64 start);
+
+// Key presses and releases and mouse clicks; other events are ignored
+void recordInput(const SDL_Event& event);
+
+// Called by logEvent() for every game event
+void recordGameEvent(uint8_t game, uint16_t type, int32_t value0, int32_t value1);
+
+// Once per loop iteration. A loop that stops beating for longer than the
+// threshold is reported once per stall.
+void heartbeat(FlightLoop loop);
+
+// The loop is stopping or about to block on purpose (a game starting, the
+// game over screen); it is not watched until its next heartbeat.
+void heartbeatIdle(FlightLoop loop);
+
+// Starts the watchdog. Call on the main thread, whose stack goes into the
+// dumps. thresholdMs 0 leaves recording on but never dumps.
+bool startStallWatch(Uint32 thresholdMs = DEFAULT_STALL_MS);
+void stopStallWatch();
+
+#endif
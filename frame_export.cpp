@@ -0,0 +1,109 @@
+#include "frame_export.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+static uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+FrameExport::FrameExport()
+    : header(nullptr), writeSlot(0), sequence(0), skipped(0), publishMicros(0), peakPublishMicros(0) {}
+
+FrameExport::~FrameExport() {
+    stop();
+}
+
+FrameSlotHeader* FrameExport::slot(uint32_t index) const {
+    return reinterpret_cast<FrameSlotHeader*>(memory.data() + sizeof(FrameShareHeader) +
+                                              static_cast<size_t>(index) * header->slotBytes);
+}
+
+bool FrameExport::start(const char* name) {
+    if (header) return true;
+    if (!memory.openSharedMemory(name, frameShareBytes())) {
+        std::cerr << "Cannot open shared memory " << name << " for frame export" << std::endl;
+        return false;
+    }
+    this->name = name;
+    header = reinterpret_cast<FrameShareHeader*>(memory.data());
+
+    // A reader ignores the memory until the magic is back
+    memset(header->magic, 0, sizeof(header->magic));
+    std::atomic_thread_fence(std::memory_order_release);
+    header->version = FRAME_SHARE_VERSION;
+    header->slotBytes = frameShareSlotBytes();
+    header->writerProcess = static_cast<uint32_t>(getpid());
+    header->writerStartNs = nowNs();
+    new (&header->middle) std::atomic<uint32_t>(1);
+    new (&header->readerSlot) std::atomic<uint32_t>(2);
+    // Clearing every slot also faults its pages in now rather than during play
+    memset(slot(0), 0, static_cast<size_t>(header->slotBytes) * FRAME_SHARE_SLOTS);
+    writeSlot = 0;
+    sequence = 0;
+    skipped = 0;
+    publishMicros = peakPublishMicros = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, FRAME_SHARE_MAGIC, 4);
+    std::cout << "Exporting frames to shared memory " << name << std::endl;
+    return true;
+}
+
+void FrameExport::stop() {
+    if (!header) return;
+    std::cout << "Frame export: " << sequence << " frames published, " << skipped << " too large";
+    if (sequence) {
+        std::cout << ", " << publishMicros / sequence << " us per frame, " << peakPublishMicros << " us peak";
+    }
+    std::cout << std::endl;
+    // The memory stays so a reader keeps the last frame until the next start
+    header = nullptr;
+    memory.close();
+}
+
+void FrameExport::publish(SDL_Renderer* renderer) {
+    if (!header) return;
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    int width = 0, height = 0;
+    SDL_GetRendererOutputSize(renderer, &width, &height);
+    if (width <= 0 || height <= 0 || width > FRAME_SHARE_MAX_WIDTH || height > FRAME_SHARE_MAX_HEIGHT) {
+        skipped++;
+        return;
+    }
+
+    FrameSlotHeader* target = slot(writeSlot);
+    unsigned char* pixels = reinterpret_cast<unsigned char*>(target + 1);
+    if (SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_ARGB8888, pixels, width * 4) != 0) {
+        skipped++;
+        return;
+    }
+    target->sequence = ++sequence;
+    target->timestampNs = nowNs();
+    target->width = width;
+    target->height = height;
+    target->pitch = width * 4;
+    target->format = SDL_PIXELFORMAT_ARGB8888;
+
+    // Hand the slot over and take back whichever one was waiting
+    uint32_t previous = header->middle.exchange(writeSlot | FRAME_SHARE_FRESH, std::memory_order_acq_rel);
+    writeSlot = previous & (FRAME_SHARE_FRESH - 1);
+
+    double micros = static_cast<double>(SDL_GetPerformanceCounter() - start) * 1e6 / SDL_GetPerformanceFrequency();
+    publishMicros += micros;
+    if (micros > peakPublishMicros) peakPublishMicros = micros;
+}
+
+FrameExport& frameExport() {
+    static FrameExport exporter;
+    return exporter;
+}
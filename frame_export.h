@@ -0,0 +1,39 @@
+#ifndef FRAME_EXPORT_H
+#define FRAME_EXPORT_H
+
+#include <SDL.h>
+#include <string>
+#include "frame_share.h"
+#include "mapped_file.h"
+
+// Publishes every presented frame into a shared memory triple buffer (see
+// frame_share.h) so a compositor on the same machine can show it. The
+// frame is read back straight into the shared slot; publishing is then a
+// single atomic swap.
+class FrameExport {
+public:
+    FrameExport();
+    ~FrameExport();
+
+    bool start(const char* name = FRAME_SHARE_NAME);
+    void stop();
+    bool isRunning() const { return header != nullptr; }
+
+    void publish(SDL_Renderer* renderer);
+
+private:
+    FrameSlotHeader* slot(uint32_t index) const;
+
+    MappedFile memory;
+    FrameShareHeader* header;
+    std::string name;
+    uint32_t writeSlot;
+    uint64_t sequence;
+    long long skipped;
+    double publishMicros, peakPublishMicros;
+};
+
+// The export shared by every game and the menu
+FrameExport& frameExport();
+
+#endif
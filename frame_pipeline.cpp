@@ -0,0 +1,26 @@
+#include "frame_pipeline.h"
+#include "crt_filter.h"
+#include "frame_export.h"
+#include "metrics.h"
+#include "video_capture.h"
+
+static void (*presentObserver)(SDL_Renderer* renderer) = nullptr;
+
+void setPresentObserver(void (*observer)(SDL_Renderer* renderer)) {
+    presentObserver = observer;
+}
+
+void presentFrame(SDL_Renderer* renderer) {
+    // Before capture and export, so they show what the player sees
+    crtFilter().apply(renderer);
+    videoCapture().captureFrame(renderer);
+    frameExport().publish(renderer);
+    SDL_RenderPresent(renderer);
+    if (presentObserver) presentObserver(renderer);
+
+    // Presents come from one thread at a time, whichever owns the window
+    static Uint64 lastPresent = 0;
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (lastPresent) metrics().frameTime.observe((now - lastPresent) * 1000000 / SDL_GetPerformanceFrequency());
+    lastPresent = now;
+}
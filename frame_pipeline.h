@@ -0,0 +1,15 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <SDL.h>
+
+// Use in place of SDL_RenderPresent. Runs the finished frame through the CRT
+// filter and hands it to the video capture and the shared memory export when
+// they are on, then shows it.
+void presentFrame(SDL_Renderer* renderer);
+
+// Called after every present from then on, or no longer with null. Used by
+// Emulator --bench-startup to see when a game's first frame is shown.
+void setPresentObserver(void (*observer)(SDL_Renderer* renderer));
+
+#endif
@@ -0,0 +1,56 @@
+#include "frame_reader.h"
+#include <cstring>
+
+FrameReader::FrameReader() : header(nullptr) {}
+
+bool FrameReader::open(const char* name) {
+    close();
+    if (!memory.openSharedMemory(name, 0)) return false;
+    if (memory.size() < sizeof(FrameShareHeader)) {
+        memory.close();
+        return false;
+    }
+    header = reinterpret_cast<FrameShareHeader*>(memory.data());
+    return true;
+}
+
+void FrameReader::close() {
+    header = nullptr;
+    memory.close();
+}
+
+uint64_t FrameReader::writerStartNs() const {
+    return header ? header->writerStartNs : 0;
+}
+
+bool FrameReader::latest(SharedFrame& frame) {
+    if (!header || memcmp(header->magic, FRAME_SHARE_MAGIC, 4) != 0) return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header->version != FRAME_SHARE_VERSION ||
+        sizeof(FrameShareHeader) + static_cast<size_t>(header->slotBytes) * FRAME_SHARE_SLOTS > memory.size()) {
+        return false;
+    }
+
+    // Swap the slot we hold for the newer one in the middle, if there is one
+    uint32_t mine = header->readerSlot.load(std::memory_order_relaxed);
+    if (header->middle.load(std::memory_order_acquire) & FRAME_SHARE_FRESH) {
+        uint32_t previous = header->middle.exchange(mine, std::memory_order_acq_rel);
+        mine = previous & (FRAME_SHARE_FRESH - 1);
+        header->readerSlot.store(mine, std::memory_order_relaxed);
+    }
+    if (mine >= static_cast<uint32_t>(FRAME_SHARE_SLOTS)) return false;
+
+    const unsigned char* slotStart = memory.data() + sizeof(FrameShareHeader) + static_cast<size_t>(mine) * header->slotBytes;
+    const FrameSlotHeader* slot = reinterpret_cast<const FrameSlotHeader*>(slotStart);
+    if (slot->sequence == 0 || static_cast<uint64_t>(slot->pitch) * slot->height + sizeof(FrameSlotHeader) > header->slotBytes) {
+        return false;
+    }
+    frame.sequence = slot->sequence;
+    frame.timestampNs = slot->timestampNs;
+    frame.width = slot->width;
+    frame.height = slot->height;
+    frame.pitch = slot->pitch;
+    frame.format = slot->format;
+    frame.pixels = slotStart + sizeof(FrameSlotHeader);
+    return true;
+}
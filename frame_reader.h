@@ -0,0 +1,47 @@
+#ifndef FRAME_READER_H
+#define FRAME_READER_H
+
+#include <cstdint>
+#include "frame_share.h"
+#include "mapped_file.h"
+
+// Reader side of the emulator's frame export, for a separate process such
+// as a compositor. Needs only frame_reader.cpp and mapped_file.cpp, no SDL.
+//
+//   FrameReader reader;
+//   if (reader.open()) {
+//       SharedFrame frame;
+//       if (reader.latest(frame)) draw(frame.pixels, frame.width, frame.height, frame.pitch);
+//   }
+
+struct SharedFrame {
+    uint64_t sequence;
+    uint64_t timestampNs;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;
+    uint32_t format;
+    const unsigned char* pixels;   // Points into shared memory
+};
+
+class FrameReader {
+public:
+    FrameReader();
+
+    bool open(const char* name = FRAME_SHARE_NAME);
+    void close();
+
+    // Fills in the newest complete frame. The pixels are read in place and
+    // stay untouched by the emulator until the next call. False until the
+    // emulator has published a frame.
+    bool latest(SharedFrame& frame);
+
+    // Changes whenever the emulator restarts the export
+    uint64_t writerStartNs() const;
+
+private:
+    MappedFile memory;
+    FrameShareHeader* header;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef FRAME_SHARE_H
+#define FRAME_SHARE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Layout of the shared memory the emulator publishes its frames into, used
+// by both the exporter and the reader library.
+//
+// Three slots form a triple buffer. At any moment one slot belongs to the
+// writer, one to the reader, and the third is the hand-over slot named by
+// `middle`. The writer fills its slot and swaps it into the middle with the
+// FRESH bit set; the reader swaps its own slot for a fresh middle one.
+// Neither side ever waits for the other or copies a frame, and a slot is
+// never written while the reader holds it. There is one reader at a time.
+
+#define FRAME_SHARE_MAGIC "AFRM"
+#define FRAME_SHARE_NAME "/arcade-frames"
+
+const uint32_t FRAME_SHARE_VERSION = 1;
+const int FRAME_SHARE_SLOTS = 3;
+const uint32_t FRAME_SHARE_FRESH = 4;        // Set in middle when it holds an unread frame
+const int FRAME_SHARE_MAX_WIDTH = 1920;
+const int FRAME_SHARE_MAX_HEIGHT = 1200;
+
+struct FrameShareHeader {
+    char magic[4];              // "AFRM", written last when the writer starts
+    uint32_t version;
+    uint32_t slotBytes;         // Distance between slots, header included
+    uint32_t writerProcess;
+    uint64_t writerStartNs;     // Changes whenever a writer starts over
+    std::atomic<uint32_t> middle;         // Slot index, plus FRESH
+    std::atomic<uint32_t> readerSlot;     // Owned by the reader
+    char padding[32];
+};
+
+// Starts each slot; the pixels follow it directly
+struct FrameSlotHeader {
+    uint64_t sequence;          // 1 for the first frame published, 0 if none yet
+    uint64_t timestampNs;       // When the frame was presented (system clock)
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;
+    uint32_t format;            // SDL_PIXELFORMAT_ARGB8888
+    char padding[32];
+};
+
+static_assert(sizeof(FrameShareHeader) == 64, "FrameShareHeader must stay one cache line");
+static_assert(sizeof(FrameSlotHeader) == 64, "FrameSlotHeader must stay one cache line");
+
+inline uint32_t frameShareSlotBytes() {
+    return static_cast<uint32_t>(sizeof(FrameSlotHeader)) + FRAME_SHARE_MAX_WIDTH * FRAME_SHARE_MAX_HEIGHT * 4;
+}
+
+inline size_t frameShareBytes() {
+    return sizeof(FrameShareHeader) + static_cast<size_t>(frameShareSlotBytes()) * FRAME_SHARE_SLOTS;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef GAME_ENV_H
+#define GAME_ENV_H
+
+#include <SDL.h>
+#include "render_snapshot.h"
+
+// One headless copy of a game for training agents, driven by BatchedEnv
+// (batched_env.h). It never logs, prints or opens a window and shares no
+// state with other copies, so many can be stepped on different threads at
+// once. A step is one tick of the game with one discrete action.
+class GameEnv {
+public:
+    virtual ~GameEnv() {}
+
+    // Starts a new episode; the seed picks whatever the game randomises
+    virtual void reset(Uint32 seed) = 0;
+
+    // Plays one tick and returns the points scored on it
+    virtual float step(int action) = 0;
+
+    virtual bool done() const = 0;
+
+    // Writes GameEnvSpec::stateSize values, each roughly in [-1, 1]
+    virtual void observe(float* state) const = 0;
+
+    // What the game would draw now
+    virtual void snapshot(RenderSnapshot& out) = 0;
+};
+
+// What a game module offers for training, see GameModule::env
+struct GameEnvSpec {
+    int actionCount;     // Actions are 0 .. actionCount - 1; 0 does nothing
+    int stateSize;       // Values written by GameEnv::observe()
+    int screenWidth;     // Size of the game's snapshots
+    int screenHeight;
+    GameEnv* (*create)();
+    // Picks a sensible action from observe()'s state, for the menu's
+    // attract mode previews; null plays them at random
+    int (*autoplay)(const float* state);
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef GAME_MODULE_H
+#define GAME_MODULE_H
+
+#include <cstdint>
+#include "game_env.h"
+#include "simulation.h"
+
+// Every game is built as its own shared library exporting one function,
+// arcadeGameModule(), that describes it. The emulator lists the games from
+// games.txt and loads the libraries once the menu is showing, so games can
+// be added or rebuilt without touching the emulator. run() opens the game's
+// own window; it releases what it started with SDL_QuitSubSystem(), as
+// SDL_Quit() would take the menu's window and audio with it.
+
+#define GAME_MODULE_API_VERSION 4
+#define GAME_MODULE_ENTRY "arcadeGameModule"
+
+struct GameModule {
+    uint32_t apiVersion;      // GAME_MODULE_API_VERSION the game was built with
+    const char* title;
+    const char* scoreName;    // Leaderboard name, as in recordScore()
+    bool showGameOver;        // The menu shows its game over screen afterwards
+    void (*run)();
+    // Runs a command line option such as a benchmark. Returns false if the
+    // option is not one of this game's.
+    bool (*runCommand)(int argc, char* argv[]);
+    const GameEnvSpec* env;   // Headless copies for training; null if none
+    // A windowless copy played through its Simulation interface, for hosts
+    // that tick games themselves (game_scheduler.h); null if none. Without
+    // rewind it keeps no rewind history.
+    Simulation* (*createHeadless)(bool rewind);
+};
+
+typedef const GameModule* (*GameModuleEntry)();
+
+#ifdef _WIN32
+#define GAME_MODULE_EXPORT extern "C" __declspec(dllexport)
+#else
+#define GAME_MODULE_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+#endif
@@ -1,4 +1,5 @@
 #include "game_over.h"
+#include "frame_pipeline.h"
 #include <SDL.h>
 #include <SDL_ttf.h>
 #include <iostream>
@@ -21,7 +22,7 @@ void GameOver::show() {
             std::cerr << "Failed to load font: " << TTF_GetError() << std::endl;
             SDL_DestroyRenderer(renderer);
             SDL_DestroyWindow(window);
-            SDL_Quit();
+            SDL_QuitSubSystem(SDL_INIT_VIDEO);
             return;
         }
 
@@ -39,7 +40,7 @@ void GameOver::show() {
         SDL_RenderClear(renderer);
 
         SDL_RenderCopy(renderer, message, NULL, &messageRect);
-        SDL_RenderPresent(renderer);
+        presentFrame(renderer);
 
         SDL_Delay(displayDuration);
 
@@ -49,5 +50,5 @@ void GameOver::show() {
         SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
         TTF_Quit();
-        SDL_Quit();
+        SDL_QuitSubSystem(SDL_INIT_VIDEO);
     }
@@ -0,0 +1,88 @@
+#include "game_registry.h"
+#include <SDL.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#if defined(_WIN32)
+static const char* LIBRARY_SUFFIX = ".dll";
+#elif defined(__APPLE__)
+static const char* LIBRARY_SUFFIX = ".dylib";
+#else
+static const char* LIBRARY_SUFFIX = ".so";
+#endif
+
+GameRegistry::~GameRegistry() {
+    for (Entry& entry : entries) {
+        if (entry.handle) SDL_UnloadObject(entry.handle);
+    }
+}
+
+bool GameRegistry::loadManifest(const char* path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot open game list " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream fields(line);
+        Entry entry;
+        if (!(fields >> entry.library) || entry.library[0] == '#') continue;
+        fields >> entry.scoreName;
+        std::getline(fields >> std::ws, entry.title);
+        if (!entry.title.empty() && entry.title[entry.title.size() - 1] == '\r') entry.title.erase(entry.title.size() - 1);
+        if (entry.scoreName.empty() || entry.title.empty()) {
+            std::cerr << path << ":" << lineNumber << ": expected <library> <score name> <title>" << std::endl;
+            continue;
+        }
+        entry.handle = nullptr;
+        entry.module = nullptr;
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+const GameModule* GameRegistry::module(size_t index) {
+    if (index >= entries.size()) return nullptr;
+    Entry& entry = entries[index];
+    if (entry.module) return entry.module;
+    if (entry.handle) return nullptr; // Loaded before but unusable
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    std::string path = entry.library + LIBRARY_SUFFIX;
+    entry.handle = SDL_LoadObject(path.c_str());
+    if (!entry.handle) {
+        std::cerr << "Cannot load " << entry.title << ": " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+    GameModuleEntry describe = reinterpret_cast<GameModuleEntry>(SDL_LoadFunction(entry.handle, GAME_MODULE_ENTRY));
+    const GameModule* module = describe ? describe() : nullptr;
+    if (!module || module->apiVersion != GAME_MODULE_API_VERSION || !module->run) {
+        std::cerr << path << " is not a game module for this emulator" << std::endl;
+        return nullptr;
+    }
+    entry.module = module;
+    double ms = static_cast<double>(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    std::cout << "Loaded " << entry.title << " from " << path << " in " << ms << " ms" << std::endl;
+    return module;
+}
+
+const GameModule* GameRegistry::find(const std::string& scoreName) {
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].scoreName == scoreName) return module(i);
+    }
+    std::cerr << "No game called " << scoreName << std::endl;
+    return nullptr;
+}
+
+bool GameRegistry::runCommand(int argc, char* argv[]) {
+    bool handled = false;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const GameModule* game = module(i);
+        if (game && game->runCommand && game->runCommand(argc, argv)) handled = true;
+    }
+    return handled;
+}
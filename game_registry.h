@@ -0,0 +1,47 @@
+#ifndef GAME_REGISTRY_H
+#define GAME_REGISTRY_H
+
+#include <string>
+#include <vector>
+#include "game_module.h"
+
+// The games the emulator knows about, read from a manifest with one game
+// per line:
+//
+//   <library> <score name> <title>
+//
+// The library is given without its extension (.dll, .so or .dylib is
+// added). Blank lines and lines starting with # are skipped. Nothing is
+// loaded until a game is asked for.
+class GameRegistry {
+public:
+    struct Entry {
+        std::string library;
+        std::string scoreName;
+        std::string title;
+        void* handle;
+        const GameModule* module;
+    };
+
+    ~GameRegistry();
+
+    bool loadManifest(const char* path);
+
+    size_t size() const { return entries.size(); }
+    const Entry& at(size_t index) const { return entries[index]; }
+
+    // Loads the game's library the first time it is needed. Returns null if
+    // it cannot be loaded or was built for another interface version.
+    const GameModule* module(size_t index);
+
+    // The game with this score name, loaded as above
+    const GameModule* find(const std::string& scoreName);
+
+    // Offers a command line option to every game; true if any ran it
+    bool runCommand(int argc, char* argv[]);
+
+private:
+    std::vector<Entry> entries;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "game_scheduler.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+double toMicros(Uint64 counts) {
+    return static_cast<double>(counts) * 1e6 / SDL_GetPerformanceFrequency();
+}
+
+Uint64 fromMicros(Uint64 micros) {
+    return micros * SDL_GetPerformanceFrequency() / 1000000;
+}
+
+} // namespace
+
+int GameScheduler::add(Simulation& game) {
+    Task task;
+    task.game = &game;
+    task.done = game.finished();
+    task.ticks = 0;
+    task.skippedTicks = 0;
+    task.tickMicros = 0;
+    task.peakTickMicros = 0;
+    task.lateMicros = 0;
+    task.peakLateMicros = 0;
+    task.started = SDL_GetPerformanceCounter();
+    task.schedule.start(task.started);
+    game.snapshot(task.frame); // Something to draw before the first tick
+    tasks.push_back(task);
+    return static_cast<int>(tasks.size()) - 1;
+}
+
+int GameScheduler::runDue(const Uint8* keystate) {
+    int played = 0;
+    for (;;) {
+        // The game whose tick has waited longest goes next, so one that
+        // falls behind cannot keep the others waiting
+        Uint64 now = SDL_GetPerformanceCounter();
+        Task* next = nullptr;
+        for (Task& task : tasks) {
+            if (task.done || !task.schedule.isDue(now)) continue;
+            if (!next || task.schedule.nextDue() < next->schedule.nextDue()) next = &task;
+        }
+        if (!next) return played;
+
+        Task& task = *next;
+        double late = toMicros(now - task.schedule.nextDue());
+        task.lateMicros += late;
+        if (late > task.peakLateMicros) task.peakLateMicros = late;
+        task.skippedTicks += task.schedule.take(now, fromMicros(task.game->tickMicros()));
+
+        task.game->tick(keystate);
+        task.game->snapshot(task.frame);
+        task.done = task.game->finished();
+
+        double micros = toMicros(SDL_GetPerformanceCounter() - now);
+        task.ticks++;
+        task.tickMicros += micros;
+        if (micros > task.peakTickMicros) task.peakTickMicros = micros;
+        played++;
+    }
+}
+
+Uint64 GameScheduler::nextDue() const {
+    Uint64 due = 0;
+    for (const Task& task : tasks) {
+        if (task.done) continue;
+        if (!due || task.schedule.nextDue() < due) due = task.schedule.nextDue();
+    }
+    return due;
+}
+
+void GameScheduler::printStats(int handle, const char* name) const {
+    const Task& task = tasks[handle];
+    if (!task.ticks) return;
+    double seconds = toMicros(SDL_GetPerformanceCounter() - task.started) / 1e6;
+    std::cout << name << " scheduled: " << task.ticks << " ticks at " << task.ticks / seconds << " per second, "
+              << task.tickMicros / task.ticks << " us average, " << task.peakTickMicros << " us peak, started "
+              << task.lateMicros / task.ticks << " us late on average, " << task.peakLateMicros << " us at worst, "
+              << task.skippedTicks << " skipped" << (task.done ? ", finished" : "") << std::endl;
+}
+
+void benchmarkScheduler(const std::vector<const GameModule*>& games, int copies, int seconds) {
+    if (copies <= 0 || seconds <= 0) return;
+    GameScheduler scheduler;
+    std::vector<Simulation*> simulations;
+    std::vector<const char*> names;
+    for (const GameModule* module : games) {
+        if (!module->createHeadless) continue;
+        for (int c = 0; c < copies; ++c) {
+            simulations.push_back(module->createHeadless(false));
+            names.push_back(module->title);
+            scheduler.add(*simulations.back());
+        }
+    }
+    if (simulations.empty()) {
+        std::cout << "No game offers a headless simulation" << std::endl;
+        return;
+    }
+
+    // Nobody at the keyboard; the games play on until they finish or time is up
+    static const Uint8 noKeys[SDL_NUM_SCANCODES] = {};
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 start = SDL_GetPerformanceCounter();
+    Uint64 end = start + frequency * seconds;
+    Uint64 busy = 0;
+    long long ticks = 0;
+    for (Uint64 now = start; now < end; now = SDL_GetPerformanceCounter()) {
+        ticks += scheduler.runDue(noKeys);
+        Uint64 after = SDL_GetPerformanceCounter();
+        busy += after - now;
+        Uint64 due = scheduler.nextDue();
+        if (!due) break;
+        waitUntil(std::min(due, end), after);
+    }
+    double elapsed = toMicros(SDL_GetPerformanceCounter() - start);
+
+    for (int i = 0; i < scheduler.size(); ++i) scheduler.printStats(i, names[i]);
+    std::cout << "Scheduler: " << scheduler.size() << " games on one thread, " << ticks << " ticks in "
+              << elapsed / 1e6 << " s, " << 100.0 * toMicros(busy) / elapsed << "% of the thread busy" << std::endl;
+    for (Simulation* simulation : simulations) delete simulation;
+}
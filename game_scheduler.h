@@ -0,0 +1,57 @@
+#ifndef GAME_SCHEDULER_H
+#define GAME_SCHEDULER_H
+
+#include <SDL.h>
+#include <vector>
+#include "game_module.h"
+#include "simulation.h"
+
+// Runs the simulations of many games on the calling thread, for hosts that
+// want several at once, such as split screen or play in the background,
+// without a thread for each. Every game keeps its own cadence on a
+// TickSchedule. runDue() plays the ticks that have come due, earliest
+// deadline first, and keeps the newest snapshot of each game to draw; in
+// between, the host is free to handle events and draw. Games are not owned.
+class GameScheduler {
+public:
+    // Ticks start from now. Returns the game's handle.
+    int add(Simulation& game);
+
+    int size() const { return static_cast<int>(tasks.size()); }
+
+    // Plays every tick that is due with this keyboard for all games and
+    // returns how many it played
+    int runDue(const Uint8* keystate);
+
+    // When the next tick is due, in performance counter units; 0 when every
+    // game has finished
+    Uint64 nextDue() const;
+
+    const RenderSnapshot& latest(int handle) const { return tasks[handle].frame; }
+    bool finished(int handle) const { return tasks[handle].done; }
+
+    // Ticks, their cost and how late they started, for one game
+    void printStats(int handle, const char* name) const;
+
+private:
+    struct Task {
+        Simulation* game;
+        TickSchedule schedule;
+        RenderSnapshot frame;
+        bool done;
+        Uint64 ticks, skippedTicks;
+        double tickMicros, peakTickMicros;
+        double lateMicros, peakLateMicros;
+        Uint64 started;
+    };
+
+    std::vector<Task> tasks;
+};
+
+// Plays copies of each game together on this thread for the given time
+// and prints how well each kept its tick rate and how much of the thread
+// they used. Games without GameModule::createHeadless are left out.
+// Emulator --bench-scheduler [copies [seconds]]
+void benchmarkScheduler(const std::vector<const GameModule*>& games, int copies, int seconds);
+
+#endif
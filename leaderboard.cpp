@@ -0,0 +1,331 @@
+#include "leaderboard.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const uint32_t RECORD_MAGIC = 0x31524353;   // "SCR1"
+const char INDEX_MAGIC[4] = {'L', 'B', 'I', 'X'};
+const uint32_t INDEX_VERSION = 1;
+const size_t INDEX_FILE_SIZE = 4096;
+
+// One line of the log. The checksum lets a reader skip a record that was
+// only partly written when a process died.
+struct ScoreRecord {
+    uint32_t magic;
+    uint32_t checksum;
+    LeaderboardEntry entry;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(ScoreRecord) == 32, "ScoreRecord is a file format");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Index sequence is shared through the file");
+
+uint32_t fnv1a(const void* data, size_t size, uint32_t hash = 2166136261u) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t recordChecksum(const ScoreRecord& record) {
+    return fnv1a(&record.entry, sizeof(record.entry), fnv1a(&record.magic, sizeof(record.magic)));
+}
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+uint32_t currentProcessId() {
+#ifdef _WIN32
+    return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+    return static_cast<uint32_t>(getpid());
+#endif
+}
+
+void makeScoresDirectory() {
+#ifdef _WIN32
+    _mkdir("scores");
+#else
+    mkdir("scores", 0755);
+#endif
+}
+
+// Appends with a single write to a file opened for appending, so records
+// from several processes never interleave, then forces it to disk
+bool appendRecord(const std::string& path, const ScoreRecord& record) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    DWORD written = 0;
+    bool ok = WriteFile(file, &record, sizeof(record), &written, NULL) && written == sizeof(record) &&
+              FlushFileBuffers(file);
+    CloseHandle(file);
+    return ok;
+#else
+    int fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) return false;
+    bool ok = write(fd, &record, sizeof(record)) == static_cast<ssize_t>(sizeof(record)) && fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#endif
+}
+
+bool better(const LeaderboardEntry& a, const LeaderboardEntry& b) {
+    if (a.score != b.score) return a.score > b.score;
+    return a.timeNs < b.timeNs; // The earlier score keeps its place
+}
+
+void insertEntry(LeaderboardEntry* entries, uint32_t& count, const LeaderboardEntry& entry) {
+    uint32_t position = count;
+    while (position > 0 && better(entry, entries[position - 1])) position--;
+    if (position >= static_cast<uint32_t>(Leaderboard::TOP_N)) return;
+    uint32_t last = count < static_cast<uint32_t>(Leaderboard::TOP_N) ? count : Leaderboard::TOP_N - 1;
+    for (uint32_t i = last; i > position; --i) entries[i] = entries[i - 1];
+    entries[position] = entry;
+    if (count < static_cast<uint32_t>(Leaderboard::TOP_N)) count++;
+}
+
+} // namespace
+
+// Lives in the mapped index file. Updates follow the seqlock pattern:
+// sequence is odd while the table is being rewritten, so readers copy it
+// without a lock and retry if it changed underneath them. Writers hold a
+// per-game file lock, which the OS drops if the process dies.
+struct Leaderboard::IndexHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t sequence;
+    uint32_t count;
+    uint64_t logBytes;     // The log prefix the table was built from
+    uint32_t checksum;     // Catches a table torn by a power cut
+    uint32_t reserved;
+    LeaderboardEntry entries[TOP_N];
+};
+
+static std::atomic<uint32_t>& atomicWord(const uint32_t* word) {
+    return *reinterpret_cast<std::atomic<uint32_t>*>(const_cast<uint32_t*>(word));
+}
+
+static uint32_t tableChecksum(uint32_t count, uint64_t logBytes, const LeaderboardEntry* entries) {
+    uint32_t hash = fnv1a(&count, sizeof(count));
+    hash = fnv1a(&logBytes, sizeof(logBytes), hash);
+    return fnv1a(entries, sizeof(LeaderboardEntry) * Leaderboard::TOP_N, hash);
+}
+
+Leaderboard::Leaderboard(const char* game)
+    : logPath(std::string("scores/") + game + ".log"), indexPath(std::string("scores/") + game + ".idx"),
+#ifdef _WIN32
+      lockHandle(nullptr)
+#else
+      lockFd(-1)
+#endif
+{
+}
+
+Leaderboard::~Leaderboard() {
+#ifdef _WIN32
+    if (lockHandle) CloseHandle(lockHandle);
+#else
+    if (lockFd >= 0) ::close(lockFd);
+#endif
+}
+
+Leaderboard::IndexHeader* Leaderboard::header() const {
+    return reinterpret_cast<IndexHeader*>(index.data());
+}
+
+bool Leaderboard::lockIndex() {
+#ifdef _WIN32
+    if (!lockHandle) {
+        HANDLE file = CreateFileA(indexPath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                  NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        lockHandle = file;
+    }
+    OVERLAPPED whole;
+    memset(&whole, 0, sizeof(whole));
+    return LockFileEx(lockHandle, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &whole) != 0;
+#else
+    if (lockFd < 0) {
+        lockFd = ::open(indexPath.c_str(), O_RDWR | O_CREAT, 0644);
+        if (lockFd < 0) return false;
+    }
+    return flock(lockFd, LOCK_EX) == 0;
+#endif
+}
+
+void Leaderboard::unlockIndex() {
+#ifdef _WIN32
+    OVERLAPPED whole;
+    memset(&whole, 0, sizeof(whole));
+    UnlockFileEx(lockHandle, 0, MAXDWORD, MAXDWORD, &whole);
+#else
+    flock(lockFd, LOCK_UN);
+#endif
+}
+
+bool Leaderboard::open() {
+    if (index.isOpen()) return true;
+    makeScoresDirectory();
+    if (!index.openShared(indexPath.c_str(), INDEX_FILE_SIZE) || index.size() < sizeof(IndexHeader)) {
+        std::cerr << "Cannot open leaderboard index " << indexPath << std::endl;
+        index.close();
+        return false;
+    }
+    if (!lockIndex()) {
+        std::cerr << "Cannot lock leaderboard index " << indexPath << std::endl;
+        index.close();
+        return false;
+    }
+    IndexHeader* h = header();
+    bool valid = memcmp(h->magic, INDEX_MAGIC, 4) == 0 && h->version == INDEX_VERSION &&
+                 (atomicWord(&h->sequence).load() & 1) == 0 && h->count <= static_cast<uint32_t>(TOP_N) &&
+                 h->checksum == tableChecksum(h->count, h->logBytes, h->entries);
+    catchUp(h, !valid);
+    unlockIndex();
+    return true;
+}
+
+// Folds log records past logBytes into the table; with rebuild, starts
+// again from an empty table and the start of the log. Caller holds the lock.
+void Leaderboard::catchUp(IndexHeader* h, bool rebuild) {
+    LeaderboardEntry entries[TOP_N];
+    uint32_t count = 0;
+    uint64_t from = 0;
+    if (!rebuild) {
+        memcpy(entries, h->entries, sizeof(entries));
+        count = h->count;
+        from = h->logBytes;
+    } else {
+        memset(entries, 0, sizeof(entries));
+    }
+
+    uint64_t consumed = from;
+    FILE* log = fopen(logPath.c_str(), "rb");
+    if (log) {
+        fseek(log, 0, SEEK_END);
+        long size = ftell(log);
+        if (size >= 0 && static_cast<uint64_t>(size) < from) {
+            // The log is shorter than the table claims; trust the log
+            fclose(log);
+            catchUp(h, true);
+            return;
+        }
+        if (size > 0 && static_cast<uint64_t>(size) > from) {
+            std::vector<unsigned char> tail(static_cast<size_t>(size - from));
+            fseek(log, static_cast<long>(from), SEEK_SET);
+            size_t got = fread(tail.data(), 1, tail.size(), log);
+            size_t position = 0;
+            while (position + sizeof(ScoreRecord) <= got) {
+                ScoreRecord record;
+                memcpy(&record, &tail[position], sizeof(record));
+                if (record.magic == RECORD_MAGIC && record.checksum == recordChecksum(record)) {
+                    insertEntry(entries, count, record.entry);
+                    position += sizeof(record);
+                } else {
+                    position++; // Torn record: look for the next good one
+                }
+            }
+            // Fewer than one record's worth left over is either torn or
+            // still being written; it is looked at again next time
+            consumed = from + position;
+        }
+        fclose(log);
+    } else if (!rebuild && from > 0) {
+        catchUp(h, true);
+        return;
+    }
+
+    if (!rebuild && consumed == from) return;
+
+    std::atomic<uint32_t>& sequence = atomicWord(&h->sequence);
+    uint32_t start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start | 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(h->magic, INDEX_MAGIC, 4);
+    h->version = INDEX_VERSION;
+    memcpy(h->entries, entries, sizeof(entries));
+    h->count = count;
+    h->logBytes = consumed;
+    h->checksum = tableChecksum(count, consumed, entries);
+    sequence.store((start | 1) + 1, std::memory_order_release);
+}
+
+bool Leaderboard::record(int score) {
+    if (!open()) return false;
+    ScoreRecord record;
+    memset(&record, 0, sizeof(record));
+    record.magic = RECORD_MAGIC;
+    record.entry.score = score;
+    record.entry.processId = currentProcessId();
+    record.entry.timeNs = nowNs();
+    record.checksum = recordChecksum(record);
+    if (!appendRecord(logPath, record)) {
+        std::cerr << "Cannot write score to " << logPath << std::endl;
+        return false;
+    }
+    // The score is safe in the log now; if the index update below is cut
+    // short, the next open() picks the record up from the log
+    if (!lockIndex()) return true;
+    catchUp(header(), false);
+    unlockIndex();
+    return true;
+}
+
+int Leaderboard::top(LeaderboardEntry* out, int max) const {
+    if (!index.isOpen() || max <= 0) return 0;
+    const IndexHeader* h = header();
+    std::atomic<uint32_t>& sequence = atomicWord(&h->sequence);
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1) continue;
+        uint32_t count = h->count;
+        if (count > static_cast<uint32_t>(TOP_N)) count = TOP_N;
+        int copied = static_cast<int>(count) < max ? static_cast<int>(count) : max;
+        memcpy(out, h->entries, copied * sizeof(LeaderboardEntry));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before) return copied;
+    }
+    return 0; // A writer died mid-update; open() rebuilds the table
+}
+
+int Leaderboard::best() const {
+    LeaderboardEntry first;
+    return top(&first, 1) == 1 ? first.score : 0;
+}
+
+Leaderboard& leaderboardFor(const char* game) {
+    static std::map<std::string, std::unique_ptr<Leaderboard>> boards;
+    std::unique_ptr<Leaderboard>& board = boards[game];
+    if (!board) {
+        board.reset(new Leaderboard(game));
+        board->open();
+    }
+    return *board;
+}
+
+void recordScore(const char* game, int score) {
+    leaderboardFor(game).record(score);
+}
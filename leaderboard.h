@@ -0,0 +1,65 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <cstdint>
+#include <string>
+#include "mapped_file.h"
+
+// High scores for one game. Every score is appended to scores/<game>.log,
+// which is the record of truth; scores/<game>.idx is a small memory-mapped
+// top-N table kept up to date from the log. Several emulators can record
+// scores for the same game at once.
+
+struct LeaderboardEntry {
+    int32_t score;
+    uint32_t processId;
+    uint64_t timeNs;     // Wall clock, nanoseconds since the Unix epoch
+};
+
+class Leaderboard {
+public:
+    static const int TOP_N = 10;
+
+    explicit Leaderboard(const char* game);
+    ~Leaderboard();
+
+    // Maps the index, bringing it up to date with whatever the log gained
+    // since it was last indexed. Rebuilds it from the whole log only if it
+    // is missing or damaged.
+    bool open();
+
+    // Appends the score to the log and syncs it to disk before updating the
+    // index, so a crash at any point loses nothing that was recorded
+    bool record(int score);
+
+    // Reads the mapped table without locking or touching the log. Entries
+    // are best first; returns how many were copied.
+    int top(LeaderboardEntry* out, int max) const;
+    int best() const;
+
+private:
+    Leaderboard(const Leaderboard&);
+    Leaderboard& operator=(const Leaderboard&);
+
+    struct IndexHeader;
+
+    bool lockIndex();
+    void unlockIndex();
+    IndexHeader* header() const;
+    void catchUp(IndexHeader* index, bool rebuild);
+
+    std::string logPath;
+    std::string indexPath;
+    MappedFile index;
+#ifdef _WIN32
+    void* lockHandle;
+#else
+    int lockFd;
+#endif
+};
+
+// One leaderboard per game name, opened on first use
+Leaderboard& leaderboardFor(const char* game);
+void recordScore(const char* game, int score);
+
+#endif
@@ -0,0 +1,270 @@
+#include "level_format.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Builds brick breaker .bbl level files from a text description:
+//
+//   field 1000 600      play field size in pixels
+//   cell 100            grid cell size (defaults to the larger brick pitch)
+//   color 255 165 0     palette entries; the first is index 0
+//   brick 80 30         brick size used by the rows below
+//   pitch 100 50        distance between row columns / between rows
+//   origin 10 50        top-left of the next row
+//   row 0 1 . 2x3 4*    one token per column: colour index, optional xN hit
+//                       points, optional * for a multiball brick, . for a gap
+//   place 10 10 40 20 1 [hitPoints] [*]   one brick at an exact position
+//
+// Usage:
+//   level_converter <input.txt> <output.bbl>
+//   level_converter --dense <columns> <rows> <output.bbl>   stress level
+
+struct BrickSpec {
+    int x, y, w, h;
+    int color;
+    int hitPoints;
+    bool multiball;
+};
+
+struct LevelSpec {
+    int fieldWidth = 1000, fieldHeight = 600;
+    int cellSize = 0;
+    std::vector<uint8_t> palette;
+    std::vector<BrickSpec> bricks;
+};
+
+static bool parseBrickToken(const std::string& token, BrickSpec& brick) {
+    if (token == ".") return false;
+    brick.hitPoints = 1;
+    brick.multiball = false;
+    std::string rest = token;
+    if (!rest.empty() && rest[rest.size() - 1] == '*') {
+        brick.multiball = true;
+        rest.erase(rest.size() - 1);
+    }
+    size_t times = rest.find('x');
+    if (times != std::string::npos) {
+        brick.hitPoints = atoi(rest.c_str() + times + 1);
+        rest.erase(times);
+    }
+    brick.color = atoi(rest.c_str());
+    return true;
+}
+
+static bool parseText(const char* path, LevelSpec& level) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return false;
+    }
+    int brickWidth = 80, brickHeight = 30, pitchX = 100, pitchY = 50, originX = 0, originY = 50;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        std::istringstream words(line);
+        std::string command;
+        if (!(words >> command)) continue;
+
+        if (command == "field") {
+            words >> level.fieldWidth >> level.fieldHeight;
+        } else if (command == "cell") {
+            words >> level.cellSize;
+        } else if (command == "color") {
+            int r, g, b;
+            words >> r >> g >> b;
+            level.palette.push_back(static_cast<uint8_t>(r));
+            level.palette.push_back(static_cast<uint8_t>(g));
+            level.palette.push_back(static_cast<uint8_t>(b));
+            level.palette.push_back(255);
+        } else if (command == "brick") {
+            words >> brickWidth >> brickHeight;
+        } else if (command == "pitch") {
+            words >> pitchX >> pitchY;
+        } else if (command == "origin") {
+            words >> originX >> originY;
+        } else if (command == "row") {
+            std::string token;
+            int column = 0;
+            while (words >> token) {
+                BrickSpec brick;
+                if (parseBrickToken(token, brick)) {
+                    brick.x = originX + column * pitchX;
+                    brick.y = originY;
+                    brick.w = brickWidth;
+                    brick.h = brickHeight;
+                    level.bricks.push_back(brick);
+                }
+                column++;
+            }
+            originY += pitchY;
+        } else if (command == "place") {
+            BrickSpec brick;
+            std::string flag;
+            int hitPoints;
+            words >> brick.x >> brick.y >> brick.w >> brick.h >> brick.color;
+            brick.hitPoints = 1;
+            brick.multiball = false;
+            if (words >> hitPoints) {
+                brick.hitPoints = hitPoints;
+                if (words >> flag) brick.multiball = (flag == "*");
+            }
+            level.bricks.push_back(brick);
+        } else {
+            std::cerr << path << ":" << lineNumber << ": unknown command '" << command << "'" << std::endl;
+            return false;
+        }
+        if (words.fail() && !words.eof()) {
+            std::cerr << path << ":" << lineNumber << ": malformed line" << std::endl;
+            return false;
+        }
+    }
+    if (level.cellSize <= 0) level.cellSize = pitchX > pitchY ? pitchX : pitchY;
+    return true;
+}
+
+// A wall of small bricks filling the top half of the field, for load and
+// collision benchmarks. Each brick keeps a 1 px gap to its neighbours, so
+// the grid must leave at least 2 px per column and row
+static bool makeDense(int columns, int rows, LevelSpec& level) {
+    if (columns <= 0 || rows <= 0 || level.fieldWidth / columns < 2 || (level.fieldHeight / 2) / rows < 2) {
+        std::cerr << "Dense wall needs 1 to " << level.fieldWidth / 2 << " columns and 1 to "
+                  << level.fieldHeight / 4 << " rows" << std::endl;
+        return false;
+    }
+    const uint8_t colors[] = {255, 165, 0, 255, 255, 0, 0, 255, 224, 255, 255, 255,
+                              0, 0, 255, 255, 255, 255, 0, 255, 128, 0, 128, 255};
+    level.palette.assign(colors, colors + sizeof(colors));
+    int pitchX = level.fieldWidth / columns;
+    int pitchY = (level.fieldHeight / 2) / rows;
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < columns; ++c) {
+            BrickSpec brick = {c * pitchX, r * pitchY, pitchX - 1, pitchY - 1, (r + c) % 6, 1, (r * columns + c) % 97 == 0};
+            level.bricks.push_back(brick);
+        }
+    }
+    level.cellSize = 32;
+    return true;
+}
+
+template <typename T>
+static void put(std::vector<unsigned char>& file, uint32_t offset, const T& value) {
+    memcpy(&file[offset], &value, sizeof(T));
+}
+
+static bool writeLevel(const LevelSpec& level, const char* path) {
+    uint32_t paletteCount = static_cast<uint32_t>(level.palette.size() / 4);
+    uint32_t count = static_cast<uint32_t>(level.bricks.size());
+    for (const BrickSpec& brick : level.bricks) {
+        if (brick.color < 0 || static_cast<uint32_t>(brick.color) >= paletteCount) {
+            std::cerr << "Colour index " << brick.color << " is not in the palette" << std::endl;
+            return false;
+        }
+        if (brick.hitPoints < 1 || brick.hitPoints > 255) {
+            std::cerr << "Hit points must be between 1 and 255" << std::endl;
+            return false;
+        }
+    }
+
+    // Prebuild the grid with the same counting sort the game uses
+    int columns = level.fieldWidth / level.cellSize + 1;
+    int rows = level.fieldHeight / level.cellSize + 1;
+    int cells = columns * rows;
+    std::vector<int32_t> cellStart(cells + 1, 0), fill(cells, 0);
+    int minX, minY, maxX, maxY;
+    for (const BrickSpec& brick : level.bricks) {
+        levelCellRange(brick.x, brick.y, brick.w, brick.h, level.cellSize, columns, rows, minX, minY, maxX, maxY);
+        for (int cy = minY; cy <= maxY; ++cy)
+            for (int cx = minX; cx <= maxX; ++cx)
+                cellStart[cy * columns + cx + 1]++;
+    }
+    for (int c = 0; c < cells; ++c) cellStart[c + 1] += cellStart[c];
+    std::vector<int32_t> cellBricks(cellStart[cells]);
+    for (uint32_t i = 0; i < count; ++i) {
+        const BrickSpec& brick = level.bricks[i];
+        levelCellRange(brick.x, brick.y, brick.w, brick.h, level.cellSize, columns, rows, minX, minY, maxX, maxY);
+        for (int cy = minY; cy <= maxY; ++cy) {
+            for (int cx = minX; cx <= maxX; ++cx) {
+                int cell = cy * columns + cx;
+                cellBricks[cellStart[cell] + fill[cell]++] = static_cast<int32_t>(i);
+            }
+        }
+    }
+
+    LevelHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LEVEL_MAGIC, 4);
+    header.version = LEVEL_FORMAT_VERSION;
+    header.brickCount = count;
+    header.paletteCount = paletteCount;
+    header.fieldWidth = level.fieldWidth;
+    header.fieldHeight = level.fieldHeight;
+    header.cellSize = level.cellSize;
+    header.gridColumns = columns;
+    header.gridRows = rows;
+    header.gridEntryCount = static_cast<uint32_t>(cellBricks.size());
+
+    uint32_t offset = levelAlign(sizeof(LevelHeader));
+    header.paletteOffset = offset;   offset = levelAlign(offset + paletteCount * 4);
+    header.xOffset = offset;         offset = levelAlign(offset + count * 4);
+    header.yOffset = offset;         offset = levelAlign(offset + count * 4);
+    header.widthOffset = offset;     offset = levelAlign(offset + count * 4);
+    header.heightOffset = offset;    offset = levelAlign(offset + count * 4);
+    header.colorOffset = offset;     offset = levelAlign(offset + count);
+    header.hitPointsOffset = offset; offset = levelAlign(offset + count);
+    header.flagsOffset = offset;     offset = levelAlign(offset + count);
+    header.cellStartOffset = offset; offset = levelAlign(offset + (cells + 1) * 4);
+    header.cellBricksOffset = offset; offset = levelAlign(offset + header.gridEntryCount * 4);
+    header.fileSize = offset;
+
+    std::vector<unsigned char> file(offset, 0);
+    put(file, 0, header);
+    if (paletteCount) memcpy(&file[header.paletteOffset], level.palette.data(), paletteCount * 4);
+    for (uint32_t i = 0; i < count; ++i) {
+        const BrickSpec& brick = level.bricks[i];
+        put(file, header.xOffset + i * 4, static_cast<int32_t>(brick.x));
+        put(file, header.yOffset + i * 4, static_cast<int32_t>(brick.y));
+        put(file, header.widthOffset + i * 4, static_cast<int32_t>(brick.w));
+        put(file, header.heightOffset + i * 4, static_cast<int32_t>(brick.h));
+        file[header.colorOffset + i] = static_cast<uint8_t>(brick.color);
+        file[header.hitPointsOffset + i] = static_cast<uint8_t>(brick.hitPoints);
+        file[header.flagsOffset + i] = brick.multiball ? LEVEL_BRICK_MULTIBALL : 0;
+    }
+    memcpy(&file[header.cellStartOffset], cellStart.data(), cellStart.size() * 4);
+    if (!cellBricks.empty()) memcpy(&file[header.cellBricksOffset], cellBricks.data(), cellBricks.size() * 4);
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.write(reinterpret_cast<const char*>(file.data()), file.size())) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return false;
+    }
+    std::cout << path << ": " << count << " bricks, " << cells << " grid cells, " << file.size() << " bytes" << std::endl;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    LevelSpec level;
+    if (argc == 5 && std::string(argv[1]) == "--dense") {
+        if (!makeDense(atoi(argv[2]), atoi(argv[3]), level)) {
+            std::cerr << "Usage: level_converter --dense <columns> <rows> <output.bbl>" << std::endl;
+            return 1;
+        }
+        return writeLevel(level, argv[4]) ? 0 : 1;
+    }
+    if (argc != 3) {
+        std::cerr << "Usage: level_converter <input.txt> <output.bbl>" << std::endl;
+        std::cerr << "       level_converter --dense <columns> <rows> <output.bbl>" << std::endl;
+        return 1;
+    }
+    if (!parseText(argv[1], level)) return 1;
+    return writeLevel(level, argv[2]) ? 0 : 1;
+}
+
+//g++ -std=c++11 -o level_converter level_converter.cpp
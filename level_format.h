@@ -0,0 +1,91 @@
+#ifndef LEVEL_FORMAT_H
+#define LEVEL_FORMAT_H
+
+#include <cstdint>
+#include <cstring>
+
+// Brick breaker level file (.bbl), written by level_converter and mapped by
+// the game. The bricks are stored as parallel arrays, followed by the spatial
+// grid prebuilt as per-cell offsets into a list of brick indices, so the game
+// can use the file in place. Everything is little-endian and each section
+// starts on an 8 byte boundary.
+const char LEVEL_MAGIC[4] = {'B', 'B', 'L', 'V'};
+const uint32_t LEVEL_FORMAT_VERSION = 1;
+const uint8_t LEVEL_BRICK_MULTIBALL = 1; // flags bit: breaking it splits the ball
+
+struct LevelHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t fileSize;
+    uint32_t brickCount;
+    uint32_t paletteCount;   // RGBA entries
+    int32_t fieldWidth, fieldHeight;
+    int32_t cellSize;
+    int32_t gridColumns, gridRows;
+    uint32_t gridEntryCount;
+    // Byte offsets of each section from the start of the file
+    uint32_t paletteOffset;
+    uint32_t xOffset, yOffset, widthOffset, heightOffset; // int32 per brick
+    uint32_t colorOffset, hitPointsOffset, flagsOffset;   // uint8 per brick
+    uint32_t cellStartOffset;  // int32 per cell, plus one
+    uint32_t cellBricksOffset; // int32 per grid entry
+};
+
+inline uint32_t levelAlign(uint32_t offset) {
+    return (offset + 7u) & ~7u;
+}
+
+// Cells covered by a rect, edges included. The game and the converter must
+// agree on this or the prebuilt grid would miss bricks.
+inline void levelCellRange(int x, int y, int w, int h, int cellSize, int columns, int rows,
+                           int& minX, int& minY, int& maxX, int& maxY) {
+    minX = x / cellSize;
+    minY = y / cellSize;
+    maxX = (x + w) / cellSize;
+    maxY = (y + h) / cellSize;
+    if (minX < 0) minX = 0;
+    if (minY < 0) minY = 0;
+    if (maxX > columns - 1) maxX = columns - 1;
+    if (maxY > rows - 1) maxY = rows - 1;
+}
+
+// Checks that every section lies inside the file before anything is read
+inline bool levelValidate(const unsigned char* data, size_t size) {
+    if (size < sizeof(LevelHeader)) return false;
+    LevelHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, LEVEL_MAGIC, 4) != 0 || header.version != LEVEL_FORMAT_VERSION) return false;
+    if (header.fileSize != size || header.cellSize <= 0 || header.gridColumns <= 0 || header.gridRows <= 0) return false;
+
+    uint64_t bricks = header.brickCount;
+    uint64_t cells = static_cast<uint64_t>(header.gridColumns) * header.gridRows;
+    struct Section { uint32_t offset; uint64_t bytes; } sections[] = {
+        {header.paletteOffset, header.paletteCount * 4ull},
+        {header.xOffset, bricks * 4}, {header.yOffset, bricks * 4},
+        {header.widthOffset, bricks * 4}, {header.heightOffset, bricks * 4},
+        {header.colorOffset, bricks}, {header.hitPointsOffset, bricks}, {header.flagsOffset, bricks},
+        {header.cellStartOffset, (cells + 1) * 4}, {header.cellBricksOffset, header.gridEntryCount * 4ull},
+    };
+    for (const Section& section : sections) {
+        if (section.offset % 4 != 0 || section.offset + section.bytes > size) return false;
+    }
+
+    const int32_t* cellStart = reinterpret_cast<const int32_t*>(data + header.cellStartOffset);
+    if (cellStart[0] != 0 || static_cast<uint32_t>(cellStart[cells]) != header.gridEntryCount) return false;
+    for (uint64_t c = 0; c < cells; ++c) {
+        if (cellStart[c] > cellStart[c + 1]) return false;
+    }
+    const int32_t* cellBricks = reinterpret_cast<const int32_t*>(data + header.cellBricksOffset);
+    for (uint32_t e = 0; e < header.gridEntryCount; ++e) {
+        if (cellBricks[e] < 0 || static_cast<uint32_t>(cellBricks[e]) >= header.brickCount) return false;
+    }
+    // A brick with no hit points could never be broken
+    const uint8_t* colors = data + header.colorOffset;
+    const uint8_t* hitPoints = data + header.hitPointsOffset;
+    for (uint32_t b = 0; b < header.brickCount; ++b) {
+        if (colors[b] >= header.paletteCount || hitPoints[b] == 0) return false;
+    }
+    return true;
+}
+
+#endif
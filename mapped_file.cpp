@@ -0,0 +1,190 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <string>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : bytes(nullptr), length(0), fileHandle(nullptr), mappingHandle(nullptr) {}
+
+bool MappedFile::open(const char* path) {
+    close();
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    bytes = static_cast<unsigned char*>(view);
+    length = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+bool MappedFile::openShared(const char* path, size_t minimumSize) {
+    close();
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+    size_t mappedSize = static_cast<size_t>(fileSize.QuadPart);
+    if (mappedSize < minimumSize) mappedSize = minimumSize;
+    // Mapping past the end of the file extends it with zeros
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, static_cast<DWORD>(static_cast<unsigned long long>(mappedSize) >> 32),
+                                        static_cast<DWORD>(mappedSize), NULL);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, mappedSize);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    bytes = static_cast<unsigned char*>(view);
+    length = mappedSize;
+    return true;
+}
+
+bool MappedFile::openSharedMemory(const char* name, size_t size) {
+    close();
+    // Windows mapping names have no leading slash
+    std::string mappingName = std::string("Local\\") + (name[0] == '/' ? name + 1 : name);
+    HANDLE mapping;
+    if (size) {
+        mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                     static_cast<DWORD>(static_cast<unsigned long long>(size) >> 32),
+                                     static_cast<DWORD>(size), mappingName.c_str());
+    } else {
+        mapping = OpenFileMappingA(FILE_MAP_WRITE, FALSE, mappingName.c_str());
+    }
+    if (!mapping) return false;
+    void* view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+    if (!view) {
+        CloseHandle(mapping);
+        return false;
+    }
+    MEMORY_BASIC_INFORMATION info;
+    if (!size && VirtualQuery(view, &info, sizeof(info))) size = info.RegionSize;
+    mappingHandle = mapping;
+    bytes = static_cast<unsigned char*>(view);
+    length = size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes) UnmapViewOfFile(bytes);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    bytes = nullptr;
+    length = 0;
+    fileHandle = mappingHandle = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile() : bytes(nullptr), length(0) {}
+
+bool MappedFile::open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps its own reference to the file
+    if (view == MAP_FAILED) return false;
+    bytes = static_cast<unsigned char*>(view);
+    length = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+bool MappedFile::openShared(const char* path, size_t minimumSize) {
+    close();
+    int fd = ::open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        ::close(fd);
+        return false;
+    }
+    size_t mappedSize = static_cast<size_t>(info.st_size);
+    if (mappedSize < minimumSize) {
+        // New pages read as zeros
+        if (ftruncate(fd, minimumSize) < 0) {
+            ::close(fd);
+            return false;
+        }
+        mappedSize = minimumSize;
+    }
+    void* view = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+    bytes = static_cast<unsigned char*>(view);
+    length = mappedSize;
+    return true;
+}
+
+bool MappedFile::openSharedMemory(const char* name, size_t size) {
+    close();
+    int fd = shm_open(name, O_RDWR | (size ? O_CREAT : 0), 0600);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        ::close(fd);
+        return false;
+    }
+    size_t mappedSize = size ? size : static_cast<size_t>(info.st_size);
+    if (mappedSize == 0 || (static_cast<size_t>(info.st_size) < mappedSize && ftruncate(fd, mappedSize) < 0)) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+    bytes = static_cast<unsigned char*>(view);
+    length = mappedSize;
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes) munmap(bytes, length);
+    bytes = nullptr;
+    length = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
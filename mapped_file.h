@@ -0,0 +1,39 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+
+// A whole file mapped into memory. open() gives a private copy-on-write
+// mapping, so callers may patch the data in place and the file on disk never
+// changes. openShared() creates the file if needed, grows it to at least
+// minimumSize and maps it shared: writes reach the file and every other
+// process mapping it. openSharedMemory() does the same with a named
+// shared memory object ("/name") instead of a file; a size of 0 opens an
+// existing one at whatever size its creator gave it.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const char* path);
+    bool openShared(const char* path, size_t minimumSize);
+    bool openSharedMemory(const char* name, size_t size);
+    void close();
+
+    unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool isOpen() const { return bytes != nullptr; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    unsigned char* bytes;
+    size_t length;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+};
+
+#endif
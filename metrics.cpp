@@ -0,0 +1,261 @@
+#include "metrics.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Plain sockets rather than SDL_net, which can only listen on every
+// interface; the listener is bound to 127.0.0.1 so nothing off this
+// machine can even connect
+#ifdef _WIN32
+#include <winsock2.h>
+#include <windows.h>
+#include <psapi.h>
+typedef SOCKET NativeSocket;
+const NativeSocket NO_SOCKET = INVALID_SOCKET;
+#define closeSocket closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int NativeSocket;
+const NativeSocket NO_SOCKET = -1;
+#define closeSocket close
+#endif
+
+namespace {
+
+const Uint64 FRAME_BOUNDS[] = {2000, 4000, 8000, 12000, 16667, 20000, 25000, 33333, 50000, 100000, 250000, 1000000};
+const Uint64 TICK_BOUNDS[] = {50, 100, 250, 500, 1000, 2000, 4000, 8000, 16000};
+const int PAGE_BYTES = 8192;
+const Uint32 POLL_MS = 200;       // How soon the server notices it should stop
+const Uint32 REQUEST_WAIT_MS = 1000;
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL; // A scraper that hangs up early must not raise SIGPIPE
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+void appendf(char* out, size_t size, size_t& used, const char* format, ...) {
+    if (used >= size) return;
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(out + used, size - used, format, args);
+    va_end(args);
+    if (n > 0) used = used + n < size ? used + n : size;
+}
+
+// 0 where the platform gives no cheap answer
+Uint64 residentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.WorkingSetSize;
+    return 0;
+#else
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (!statm) return 0;
+    unsigned long long pages = 0, resident = 0;
+    int fields = fscanf(statm, "%llu %llu", &pages, &resident);
+    fclose(statm);
+    return fields == 2 ? resident * static_cast<Uint64>(sysconf(_SC_PAGESIZE)) : 0;
+#endif
+}
+
+void writeCounter(char* out, size_t size, size_t& used, const char* name, const char* help,
+                  const std::atomic<Uint64>& value) {
+    appendf(out, size, used, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", name, help, name, name,
+            static_cast<unsigned long long>(value.load(std::memory_order_relaxed)));
+}
+
+// One page per scrape, built from atomic reads only
+size_t writePage(char* out, size_t size) {
+    ArcadeMetrics& m = metrics();
+    size_t used = 0;
+    m.frameTime.write(out, size, used, "arcade_frame_seconds", "Time from one presented frame to the next");
+    m.tickTime.write(out, size, used, "arcade_tick_seconds", "Time spent on one simulation tick");
+    writeCounter(out, size, used, "arcade_ticks_total", "Simulation ticks played", m.ticks);
+    writeCounter(out, size, used, "arcade_skipped_ticks_total", "Ticks given up to catch up with real time",
+                 m.skippedTicks);
+    writeCounter(out, size, used, "arcade_dropped_frames_total", "Ticks replaced before they were shown",
+                 m.droppedFrames);
+    writeCounter(out, size, used, "arcade_audio_underruns_total", "Audio buffers mixed more than half a buffer late",
+                 m.audioUnderruns);
+    const char* game = m.activeGame.load(std::memory_order_relaxed);
+    appendf(out, size, used, "# HELP arcade_active_game The game being played, menu when none\n"
+                             "# TYPE arcade_active_game gauge\narcade_active_game{game=\"%s\"} 1\n",
+            game ? game : "menu");
+    Uint64 resident = residentBytes();
+    if (resident) {
+        appendf(out, size, used, "# HELP process_resident_memory_bytes Resident memory size in bytes\n"
+                                 "# TYPE process_resident_memory_bytes gauge\nprocess_resident_memory_bytes %llu\n",
+                static_cast<unsigned long long>(resident));
+    }
+    return used;
+}
+
+struct MetricsServer {
+    NativeSocket listener;
+    bool socketsStarted;
+    SDL_Thread* thread;
+    std::atomic<bool> stopRequested;
+    char page[PAGE_BYTES];
+    char response[PAGE_BYTES + 256];
+
+    MetricsServer() : listener(NO_SOCKET), socketsStarted(false), thread(nullptr), stopRequested(false) {}
+};
+
+MetricsServer server;
+
+// True when socket has something to read within ms
+bool readable(NativeSocket socket, Uint32 ms) {
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(socket, &set);
+    timeval wait;
+    wait.tv_sec = ms / 1000;
+    wait.tv_usec = (ms % 1000) * 1000;
+    return select(static_cast<int>(socket) + 1, &set, nullptr, nullptr, &wait) > 0;
+}
+
+// Answers any GET with the page. A client that sends nothing within a
+// second is dropped so it cannot hold up the next scrape.
+void serve(NativeSocket client) {
+    char request[1024];
+    int received = 0;
+    if (readable(client, REQUEST_WAIT_MS)) received = recv(client, request, sizeof(request) - 1, 0);
+    if (received <= 0) return;
+    request[received] = '\0';
+
+    int length;
+    if (strncmp(request, "GET ", 4) == 0) {
+        size_t body = writePage(server.page, sizeof(server.page));
+        length = snprintf(server.response, sizeof(server.response),
+                          "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                          "Content-Length: %u\r\nConnection: close\r\n\r\n%.*s",
+                          static_cast<unsigned>(body), static_cast<int>(body), server.page);
+    } else {
+        length = snprintf(server.response, sizeof(server.response),
+                          "HTTP/1.0 405 Method Not Allowed\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    }
+    if (length > static_cast<int>(sizeof(server.response)) - 1) length = sizeof(server.response) - 1;
+    for (int sent = 0; sent < length;) {
+        int n = send(client, server.response + sent, length - sent, SEND_FLAGS);
+        if (n <= 0) break;
+        sent += n;
+    }
+}
+
+int serverMain(void*) {
+    while (!server.stopRequested.load(std::memory_order_acquire)) {
+        if (!readable(server.listener, POLL_MS)) continue;
+        NativeSocket client = accept(server.listener, nullptr, nullptr);
+        if (client == NO_SOCKET) continue;
+        serve(client);
+        closeSocket(client);
+    }
+    return 0;
+}
+
+void closeListener() {
+    if (server.listener != NO_SOCKET) closeSocket(server.listener);
+    server.listener = NO_SOCKET;
+#ifdef _WIN32
+    if (server.socketsStarted) WSACleanup();
+#endif
+    server.socketsStarted = false;
+}
+
+} // namespace
+
+MetricHistogram::MetricHistogram(const Uint64* newBounds, int count) : boundCount(0), sumMicros(0) {
+    for (int i = 0; i < count && i < MAX_BOUNDS; ++i) bounds[boundCount++] = newBounds[i];
+    for (int i = 0; i <= MAX_BOUNDS; ++i) buckets[i].store(0, std::memory_order_relaxed);
+}
+
+void MetricHistogram::observe(Uint64 micros) {
+    int bucket = 0;
+    while (bucket < boundCount && micros > bounds[bucket]) bucket++;
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    sumMicros.fetch_add(micros, std::memory_order_relaxed);
+}
+
+void MetricHistogram::write(char* out, size_t size, size_t& used, const char* name, const char* help) const {
+    appendf(out, size, used, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    unsigned long long total = 0;
+    for (int i = 0; i < boundCount; ++i) {
+        total += buckets[i].load(std::memory_order_relaxed);
+        appendf(out, size, used, "%s_bucket{le=\"%g\"} %llu\n", name, bounds[i] / 1e6, total);
+    }
+    total += buckets[boundCount].load(std::memory_order_relaxed);
+    appendf(out, size, used, "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %.6f\n%s_count %llu\n", name, total, name,
+            sumMicros.load(std::memory_order_relaxed) / 1e6, name, total);
+}
+
+ArcadeMetrics::ArcadeMetrics()
+    : frameTime(FRAME_BOUNDS, sizeof(FRAME_BOUNDS) / sizeof(FRAME_BOUNDS[0])),
+      tickTime(TICK_BOUNDS, sizeof(TICK_BOUNDS) / sizeof(TICK_BOUNDS[0])), ticks(0), skippedTicks(0),
+      droppedFrames(0), audioUnderruns(0), activeGame(nullptr) {}
+
+ArcadeMetrics& metrics() {
+    static ArcadeMetrics instance;
+    return instance;
+}
+
+bool startMetricsServer(int port) {
+    if (server.thread) return true;
+    metrics(); // Constructed here rather than by the first writer
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        std::cerr << "Winsock could not initialize" << std::endl;
+        return false;
+    }
+#endif
+    server.socketsStarted = true;
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<Uint16>(port));
+    server.listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (server.listener != NO_SOCKET) {
+        // A restart may bind again while the last run's connections linger
+        int reuse = 1;
+        setsockopt(server.listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    }
+    if (server.listener == NO_SOCKET ||
+        bind(server.listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(server.listener, 4) != 0) {
+        std::cerr << "Cannot serve metrics on 127.0.0.1:" << port << std::endl;
+        closeListener();
+        return false;
+    }
+    server.stopRequested = false;
+    server.thread = SDL_CreateThread(serverMain, "Metrics", nullptr);
+    if (!server.thread) {
+        std::cerr << "Cannot start metrics thread: " << SDL_GetError() << std::endl;
+        stopMetricsServer();
+        return false;
+    }
+    static bool registered = false;
+    if (!registered) {
+        atexit(stopMetricsServer);
+        registered = true;
+    }
+    std::cout << "Serving metrics on http://127.0.0.1:" << port << "/metrics" << std::endl;
+    return true;
+}
+
+void stopMetricsServer() {
+    if (server.listener == NO_SOCKET) return;
+    if (server.thread) {
+        server.stopRequested.store(true, std::memory_order_release);
+        SDL_WaitThread(server.thread, nullptr);
+        server.thread = nullptr;
+    }
+    closeListener();
+}
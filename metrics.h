@@ -0,0 +1,52 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <SDL.h>
+#include <atomic>
+
+const int METRICS_PORT = 9400;
+
+// Observations sorted into fixed buckets of microseconds. observe() is a
+// couple of relaxed atomic adds, so any thread may call it; a scrape reads
+// the buckets while they change and may see a sample in the count but not
+// yet in the sum, which monitoring tolerates.
+class MetricHistogram {
+public:
+    // bounds: ascending upper bounds in microseconds, at most MAX_BOUNDS
+    MetricHistogram(const Uint64* bounds, int boundCount);
+
+    void observe(Uint64 micros);
+
+    // Prometheus text exposition in seconds, buckets cumulative
+    void write(char* out, size_t size, size_t& used, const char* name, const char* help) const;
+
+private:
+    static const int MAX_BOUNDS = 16;
+    Uint64 bounds[MAX_BOUNDS];
+    int boundCount;
+    std::atomic<Uint64> buckets[MAX_BOUNDS + 1];   // The last one is +Inf
+    std::atomic<Uint64> sumMicros;
+};
+
+// What fleet monitoring scrapes from a cabinet. Writers only touch atomics,
+// so neither the game nor the render thread ever waits for a scrape.
+struct ArcadeMetrics {
+    MetricHistogram frameTime;            // From one present to the next
+    MetricHistogram tickTime;             // Cost of one simulation tick
+    std::atomic<Uint64> ticks;
+    std::atomic<Uint64> skippedTicks;     // Given up to catch up with real time
+    std::atomic<Uint64> droppedFrames;    // Ticks replaced before they were shown
+    std::atomic<Uint64> audioUnderruns;   // Audio buffers mixed late
+    std::atomic<const char*> activeGame;  // Score name of the running game, null in the menu
+
+    ArcadeMetrics();
+};
+
+ArcadeMetrics& metrics();
+
+// Serves the metrics in the Prometheus text format over HTTP on a thread
+// of its own, to scrapers on this machine only. Stopped at exit.
+bool startMetricsServer(int port = METRICS_PORT);
+void stopMetricsServer();
+
+#endif
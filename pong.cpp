@@ -6,6 +6,30 @@
 #include <cstdlib> // for srand(), rand()
 #include <string>
 #include <SDL_ttf.h>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "udp_channel.h"
+#include "event_log.h"
+#include "leaderboard.h"
+#include "save_state.h"
+#include "rewind_buffer.h"
+#include "game_module.h"
+#include "video_capture.h"
+#include "frame_pipeline.h"
+#include "metrics.h"
+#include "flight_recorder.h"
+#include "simulation.h"
+
+enum PongInput { INPUT_UP = 1, INPUT_DOWN = 2 };
+
+// FNV-1a, used for the per-frame desync checksums
+inline void hashValue(Uint32& hash, Sint32 value) {
+    for (int i = 0; i < 4; ++i) {
+        hash ^= static_cast<Uint8>(value >> (i * 8));
+        hash *= 16777619u;
+    }
+}
 
 class Pong_Paddle {
 public:
@@ -13,9 +37,21 @@ public:
         : x(x), y(y), width(w), height(h), velocity(0), upKey(upKey), downKey(downKey) {}
 
     void handleInput(const Uint8* keystate) {
-        if (keystate[upKey]) {
+        applyInput(readInput(keystate));
+    }
+
+    // Buttons are a PongInput bit mask so that remote players can drive a paddle too
+    Uint8 readInput(const Uint8* keystate) const {
+        Uint8 buttons = 0;
+        if (keystate[upKey]) buttons |= INPUT_UP;
+        if (keystate[downKey]) buttons |= INPUT_DOWN;
+        return buttons;
+    }
+
+    void applyInput(Uint8 buttons) {
+        if (buttons & INPUT_UP) {
             velocity = -5;
-        } else if (keystate[downKey]) {
+        } else if (buttons & INPUT_DOWN) {
             velocity = 5;
         } else {
             velocity = 0;
@@ -28,10 +64,10 @@ public:
         if (y + height > 800) y = 800 - height; // Assuming screen height is 800
     }
 
-    void render(SDL_Renderer* renderer) {
+    void snapshot(RenderSnapshot& out) const {
+        const SDL_Color white = {255, 255, 255, 255}; // White color
         SDL_Rect rect = {x, y, width, height};
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255); // White color
-        SDL_RenderFillRect(renderer, &rect);
+        out.shapes.add(rect, white);
     }
 
     // Getter methods for the paddle's properties
@@ -39,6 +75,12 @@ public:
     int getY() const { return y; }
     int getWidth() const { return width; }
     int getHeight() const { return height; }
+    int getVelocity() const { return velocity; }
+
+    void setMotion(int newY, int newVelocity) {
+        y = newY;
+        velocity = newVelocity;
+    }
 
 private:
     int x, y;
@@ -51,6 +93,7 @@ private:
 class Score {
 public:
     Score() : scoreA(0), scoreB(0) {}
+    Score(int a, int b) : scoreA(a), scoreB(b) {}
 
     // Increment functions (existing)
     void incrementScoreA() {
@@ -81,164 +124,506 @@ private:
 };
 
 
-class Pong_Ball {
-public:
-    Pong_Ball(int x, int y, int size, int velocityX, int velocityY)
-        : x(x), y(y), size(size), velocityX(velocityX), velocityY(velocityY) {}
+// Ball physics runs in fixed point so that every platform produces the same
+// trajectory. Positions and velocities are in 1/256ths of a pixel and the time
+// of impact inside a tick is in 1/65536ths of that tick.
+typedef int32_t Fixed;
+const int FIXED_SHIFT = 8;
+const Fixed FIXED_ONE = 1 << FIXED_SHIFT;
+const int64_t TICK_ONE = 1 << 16;
 
-    void update() {
-        x += velocityX;
-        y += velocityY;
+inline Fixed toFixed(int pixels) { return pixels * FIXED_ONE; }
+inline int toPixels(Fixed value) {
+    // Floor instead of relying on the implementation-defined shift of negatives
+    return value >= 0 ? value / FIXED_ONE : -((-value + FIXED_ONE - 1) / FIXED_ONE);
+}
 
-        // Bounce off the top and bottom edges
-        if (y < 0 || y + size > 800) {
-            velocityY = -velocityY;
+const int PONG_WIDTH = 1000;
+const int PONG_HEIGHT = 800;
+const Fixed SERVE_SPEED = FIXED_ONE;           // per axis, the old setVelocity(1, 1)
+const Fixed SPEED_UP_PER_HIT = FIXED_ONE / 8;  // rallies get faster with each return
+const Fixed MAX_SPEED = toFixed(40);           // twice the paddle width per tick
+const int MAX_BOUNCES_PER_TICK = 4;
+
+inline int64_t isqrt64(int64_t n) {
+    int64_t r = 0;
+    int64_t bit = int64_t(1) << 62;
+    while (bit > n) bit >>= 2;
+    while (bit != 0) {
+        if (n >= r + bit) {
+            n -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
         }
+        bit >>= 2;
     }
+    return r;
+}
+
+// Axis-aligned box in fixed point, used for the swept tests
+struct FixedBox {
+    Fixed x, y, w, h;
+};
+
+class Pong_Ball {
+public:
+    Pong_Ball(int x, int y, int size, int velocityX, int velocityY)
+        : x(toFixed(x)), y(toFixed(y)), size(toFixed(size)),
+          velocityX(toFixed(velocityX)), velocityY(toFixed(velocityY)) {}
+
+    // Advances the ball by one tick. Instead of moving and then testing for
+    // overlap, the ball is swept against the walls and both paddles, moved to
+    // the earliest time of impact, reflected, and the rest of the tick is
+    // simulated from there. A fast ball therefore can never skip a paddle.
+    void update(const Pong_Paddle& paddleA, const Pong_Paddle& paddleB) {
+        int64_t remaining = TICK_ONE;
+        for (int bounce = 0; bounce < MAX_BOUNCES_PER_TICK && remaining > 0; ++bounce) {
+            int64_t hitTime = remaining + 1;
+            int hit = HIT_NONE;
+
+            int64_t t;
+            if (velocityY < 0 && sweepWall(y, t) && t < hitTime) { hitTime = t; hit = HIT_TOP; }
+            if (velocityY > 0 && sweepWall(toFixed(PONG_HEIGHT) - (y + size), t) && t < hitTime) { hitTime = t; hit = HIT_BOTTOM; }
+
+            bool paddleFace = false;
+            bool faceA = false, faceB = false;
+            if (sweepBox(boxOf(paddleA), t, faceA) && t < hitTime) { hitTime = t; hit = HIT_PADDLE_A; paddleFace = faceA; }
+            if (sweepBox(boxOf(paddleB), t, faceB) && t < hitTime) { hitTime = t; hit = HIT_PADDLE_B; paddleFace = faceB; }
+
+            if (hit == HIT_NONE) {
+                advance(remaining);
+                return;
+            }
 
-    void render(SDL_Renderer* renderer) {
-        SDL_Rect rect = {x, y, size, size};
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255); // White color for the ball
-        SDL_RenderFillRect(renderer, &rect);
+            advance(hitTime);
+            remaining -= hitTime;
+
+            switch (hit) {
+                case HIT_TOP:
+                    y = 0;
+                    velocityY = -velocityY;
+                    break;
+                case HIT_BOTTOM:
+                    y = toFixed(PONG_HEIGHT) - size;
+                    velocityY = -velocityY;
+                    break;
+                case HIT_PADDLE_A:
+                case HIT_PADDLE_B: {
+                    const Pong_Paddle& paddle = (hit == HIT_PADDLE_A) ? paddleA : paddleB;
+                    if (paddleFace) {
+                        bounceOffPaddle(paddle);
+                    } else {
+                        // Clipped the top or bottom edge of the paddle
+                        velocityY = -velocityY;
+                    }
+                    break;
+                }
+            }
+        }
     }
 
-    bool collidesWith(const Pong_Paddle& paddle) {
-        // Simple AABB collision detection
-        return x < paddle.getX() + paddle.getWidth() &&
-               x + size > paddle.getX() &&
-               y < paddle.getY() + paddle.getHeight() &&
-               y + size > paddle.getY();
+    void snapshot(RenderSnapshot& out) const {
+        const SDL_Color white = {255, 255, 255, 255}; // White color for the ball
+        SDL_Rect rect = {getX(), getY(), getSize(), getSize()};
+        out.shapes.add(rect, white);
     }
 
     void reverseX() { velocityX = -velocityX; }
     void reverseY() { velocityY = -velocityY; }
 
     void setPosition(int newX, int newY) {
-        x = newX;
-        y = newY;
+        x = toFixed(newX);
+        y = toFixed(newY);
     }
 
     void setVelocity(int newVelocityX, int newVelocityY) {
+        velocityX = toFixed(newVelocityX);
+        velocityY = toFixed(newVelocityY);
+    }
+
+    void setVelocityFixed(Fixed newVelocityX, Fixed newVelocityY) {
         velocityX = newVelocityX;
         velocityY = newVelocityY;
     }
 
-    int getX() const { return x; }
-    int getY() const { return y; }
-    int getSize() const { return size; }
+    int getX() const { return toPixels(x); }
+    int getY() const { return toPixels(y); }
+    int getSize() const { return toPixels(size); }
+    Fixed getVelocityX() const { return velocityX; }
+    Fixed getVelocityY() const { return velocityY; }
+
+    void hash(Uint32& value) const {
+        hashValue(value, x);
+        hashValue(value, y);
+        hashValue(value, velocityX);
+        hashValue(value, velocityY);
+    }
+
+    void saveState(StateWriter& writer) const {
+        writer.put(x);
+        writer.put(y);
+        writer.put(velocityX);
+        writer.put(velocityY);
+    }
+
+    bool loadState(StateReader& reader) {
+        Fixed values[4];
+        if (!reader.getBytes(values, sizeof(values))) return false;
+        x = values[0];
+        y = values[1];
+        velocityX = values[2];
+        velocityY = values[3];
+        return true;
+    }
 
 private:
-    int x, y;
-    int size;
-    int velocityX, velocityY;
+    enum Hit { HIT_NONE, HIT_TOP, HIT_BOTTOM, HIT_PADDLE_A, HIT_PADDLE_B };
+
+    static FixedBox boxOf(const Pong_Paddle& paddle) {
+        FixedBox box = {toFixed(paddle.getX()), toFixed(paddle.getY()),
+                        toFixed(paddle.getWidth()), toFixed(paddle.getHeight())};
+        return box;
+    }
+
+    // Moves the ball by the given fraction of its per-tick velocity
+    void advance(int64_t time) {
+        x += static_cast<Fixed>(velocityX * time / TICK_ONE);
+        y += static_cast<Fixed>(velocityY * time / TICK_ONE);
+    }
+
+    // Time at which the ball covers `distance` along y, in tick units
+    bool sweepWall(Fixed distance, int64_t& time) const {
+        if (distance <= 0) {
+            time = 0; // already touching or past the wall
+            return true;
+        }
+        int64_t speed = velocityY < 0 ? -int64_t(velocityY) : velocityY;
+        time = int64_t(distance) * TICK_ONE / speed;
+        return true;
+    }
+
+    // Swept AABB against a static box. Reports the entry time and whether the
+    // contact is on one of the box's vertical faces.
+    bool sweepBox(const FixedBox& box, int64_t& time, bool& verticalFace) const {
+        int64_t entryX, exitX, entryY, exitY;
+        if (!axisInterval(x, size, velocityX, box.x, box.w, entryX, exitX)) return false;
+        if (!axisInterval(y, size, velocityY, box.y, box.h, entryY, exitY)) return false;
+
+        int64_t entry = entryX > entryY ? entryX : entryY;
+        int64_t exit = exitX < exitY ? exitX : exitY;
+        if (entry > exit || exit < 0 || entry > TICK_ONE) return false;
+
+        verticalFace = entryX >= entryY;
+        if (entry < 0) {
+            // Already overlapping, e.g. a paddle moved into the ball. Only
+            // count it when the ball is still heading into the paddle.
+            Fixed centre = x + size / 2;
+            Fixed boxCentre = box.x + box.w / 2;
+            if ((velocityX > 0) != (centre < boxCentre)) return false;
+            verticalFace = true;
+            entry = 0;
+        }
+        time = entry;
+        return true;
+    }
+
+    // Entry and exit times of a moving interval [pos, pos + len) against
+    // [boxPos, boxPos + boxLen), in tick units. Unbounded ends use a sentinel.
+    static bool axisInterval(Fixed pos, Fixed len, Fixed velocity, Fixed boxPos, Fixed boxLen,
+                             int64_t& entry, int64_t& exit) {
+        const int64_t FAR = int64_t(1) << 40;
+        if (velocity == 0) {
+            if (pos + len <= boxPos || pos >= boxPos + boxLen) return false;
+            entry = -FAR;
+            exit = FAR;
+            return true;
+        }
+        int64_t entryDistance, exitDistance;
+        if (velocity > 0) {
+            entryDistance = int64_t(boxPos) - (pos + len);
+            exitDistance = int64_t(boxPos + boxLen) - pos;
+        } else {
+            entryDistance = int64_t(pos) - (boxPos + boxLen);
+            exitDistance = int64_t(pos + len) - boxPos;
+        }
+        int64_t speed = velocity < 0 ? -int64_t(velocity) : velocity;
+        entry = entryDistance * TICK_ONE / speed;
+        exit = exitDistance * TICK_ONE / speed;
+        return true;
+    }
+
+    // Reflects off a paddle face. The outgoing angle depends on where the ball
+    // struck the paddle: the centre returns it flat, the ends at up to ~60
+    // degrees. Each return also speeds the ball up a little.
+    void bounceOffPaddle(const Pong_Paddle& paddle) {
+        Fixed paddleCentre = toFixed(paddle.getY()) + toFixed(paddle.getHeight()) / 2;
+        Fixed ballCentre = y + size / 2;
+        Fixed reach = toFixed(paddle.getHeight()) / 2 + size / 2;
+        Fixed offset = ballCentre - paddleCentre;
+        if (offset > reach) offset = reach;
+        if (offset < -reach) offset = -reach;
+
+        int64_t speed = isqrt64(int64_t(velocityX) * velocityX + int64_t(velocityY) * velocityY);
+        speed += SPEED_UP_PER_HIT;
+        if (speed > MAX_SPEED) speed = MAX_SPEED;
+
+        // sin(60 degrees) ~= 222/256
+        int64_t newVelocityY = speed * offset / reach * 222 / 256;
+        int64_t newVelocityX = isqrt64(speed * speed - newVelocityY * newVelocityY);
+
+        bool movingRight = velocityX > 0;
+        Fixed paddleCentreX = toFixed(paddle.getX()) + toFixed(paddle.getWidth()) / 2;
+        if (x + size / 2 < paddleCentreX) {
+            x = toFixed(paddle.getX()) - size;
+            movingRight = false;
+        } else {
+            x = toFixed(paddle.getX() + paddle.getWidth());
+            movingRight = true;
+        }
+        velocityX = static_cast<Fixed>(movingRight ? newVelocityX : -newVelocityX);
+        velocityY = static_cast<Fixed>(newVelocityY);
+    }
+
+    Fixed x, y;
+    Fixed size;
+    Fixed velocityX, velocityY;
+};
+
+// Rollback netcode settings. Packets repeat the last few local inputs so that
+// a lost packet is covered by the next one.
+const int ROLLBACK_WINDOW = 30;   // max frames we run ahead of the remote player
+const int INPUT_HISTORY = 64;     // ring size, must exceed ROLLBACK_WINDOW
+const int INPUT_REDUNDANCY = 8;
+const Uint32 NET_TICK_MS = 16;
+const Uint32 NET_TIMEOUT_MS = 5000;
+const Uint16 NET_MAGIC = 0x5047; // "PG"
+const int NET_PACKET_SIZE = 2 + 4 + 1 + INPUT_REDUNDANCY + 4 + 4;
+
+// Everything the simulation depends on, saved before each frame so a late
+// remote input can be corrected by restoring and re-simulating.
+struct PongSnapshot {
+    Pong_Ball ball;
+    Pong_Paddle paddleA;
+    Pong_Paddle paddleB;
+    Score score;
+    bool isStarted;
 };
 
-class PongGame {
+class PongGame : public Snapshotable, public Simulation, public GameEnv {
 public:
-    PongGame()
+    static const Uint8 STATE_VERSION = 1;
+    static const int ENV_ACTIONS = 3;
+    static const int ENV_STATE_SIZE = 7;
+    static const int ENV_POINTS = 11;     // A training episode is played to this many points
+
+    PongGame(const PongNetConfig* netConfig = nullptr, bool headless = false)
         : isRunning(true),
           isStarted(false),
           window(nullptr),
           renderer(nullptr),
-          score() {
-        SDL_Init(SDL_INIT_VIDEO);
-        window = SDL_CreateWindow("Pong Game", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1000, 800, 0);
-        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-
+          score(),
+          quickSaves("pong", GAME_PONG, *this),
+          rewind("pong", *this),
+          netConfig(netConfig) {
         paddleA = new Pong_Paddle(30, 350, 20, 150, SDL_SCANCODE_W, SDL_SCANCODE_S);
         paddleB = new Pong_Paddle(940, 350, 20, 150, SDL_SCANCODE_I, SDL_SCANCODE_K);
         ball = new Pong_Ball(495, 395, 20, 0, 0); // Positioned in center with no initial movement
+        if (headless) return;
+
+        SDL_Init(SDL_INIT_VIDEO);
+        window = SDL_CreateWindow("Pong Game", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1000, 800, 0);
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
     }
 
     ~PongGame() {
+        videoCapture().stop();
         delete paddleA;
         delete paddleB;
         delete ball;
+        if (!window) return; // Headless
         SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
-        SDL_Quit();
+        SDL_QuitSubSystem(SDL_INIT_VIDEO);
     }
 
     void run() {
-        while (isRunning) {
-            handleEvents();
-            if (!isRunning) break;
-            update();
-            render();
+        logEvent(GAME_PONG, EVENT_GAME_START);
+        if (netConfig) {
+            runNetworked();
+            return;
+        }
+        if (!runSimulation("pong", *this, renderer)) logEvent(GAME_PONG, EVENT_QUIT);
+        rewind.printStats();
+        // The better of the two paddles, as printed by printScores()
+        recordScore("pong", std::max(score.getScoreA(), score.getScoreB()-200));
+    }
+
+    // The same fields as a rollback PongSnapshot: ball, paddles, scores
+    void saveState(std::vector<unsigned char>& out) const {
+        StateWriter writer(out, GAME_PONG, STATE_VERSION);
+        ball->saveState(writer);
+        writer.put<Sint32>(paddleA->getY());
+        writer.put<Sint32>(paddleA->getVelocity());
+        writer.put<Sint32>(paddleB->getY());
+        writer.put<Sint32>(paddleB->getVelocity());
+        writer.put<Sint32>(score.getScoreA());
+        writer.put<Sint32>(score.getScoreB());
+        writer.put<Uint8>(isStarted ? 1 : 0);
+        writer.finish();
+    }
+
+    bool loadState(const unsigned char* data, size_t size) {
+        StateReader reader(data, size, GAME_PONG, STATE_VERSION);
+        PongSnapshot snapshot = saveSnapshot();
+        Sint32 values[6];
+        Uint8 started = 0;
+        snapshot.ball.loadState(reader);
+        reader.getBytes(values, sizeof(values));
+        reader.get(started);
+        if (!reader.done()) return false;
+        snapshot.paddleA.setMotion(values[0], values[1]);
+        snapshot.paddleB.setMotion(values[2], values[3]);
+        snapshot.score = Score(values[4], values[5]);
+        snapshot.isStarted = started != 0;
+        loadSnapshot(snapshot);
+        return true;
+    }
+
+    // Plays a rally without a window, then times saving and loading
+    void benchSaveState(int iterations) {
+        simulate(INPUT_UP, 0, true); // Serve
+        for (int i = 0; i < 600; ++i) simulate((i / 50) % 2 ? INPUT_UP : INPUT_DOWN, (i / 70) % 2 ? INPUT_DOWN : INPUT_UP, true);
+        benchmarkSaveState("pong", *this, iterations);
+
+        int tick = 0;
+        benchmarkRewind("pong", *this, [this, &tick]() -> Uint32 {
+            ++tick;
+            simulate((tick / 50) % 2 ? INPUT_UP : INPUT_DOWN, (tick / 70) % 2 ? INPUT_DOWN : INPUT_UP, true);
+            return tickMicros();
+        }, 60 * RewindControl::SAMPLES_PER_SECOND);
+    }
+
+    // Local play runs on the simulation thread, see runSimulation(), at
+    // the same tick rate as netplay
+    Uint32 tickMicros() const { return NET_TICK_MS * 1000; }
+
+    void keyPressed(const SDL_KeyboardEvent& key) {
+        if (key.repeat == 0) quickSaves.handleKey(key.keysym.sym);
+    }
+
+    void recordRewind(bool on) { rewind.setEnabled(on); }
+
+    void tick(const Uint8* keystate) {
+        if (!rewind.rewinding(keystate)) {
+            simulate(paddleA->readInput(keystate), paddleB->readInput(keystate), false);
+            rewind.recordTick(tickMicros());
         }
     }
 
+    void snapshot(RenderSnapshot& out) {
+        const SDL_Color black = {0, 0, 0, 255};
+        const SDL_Color white = {255, 255, 255, 255};
+        out.clear(black);
+
+        SDL_Rect centreLine = {500, 0, 1, 801};
+        out.shapes.add(centreLine, white);
+
+        paddleA->snapshot(out);
+        paddleB->snapshot(out);
+        ball->snapshot(out);
+    }
+
+    bool finished() const { return !isRunning; }
+
+    // Training side, see game_env.h. The agent is the left paddle against
+    // one that follows the ball. Actions: 0 stay, 1 up, 2 down; a step is
+    // one tick, and the reward is the agent's points minus the other's.
+    void reset(Uint32 seed) {
+        (void)seed; // Pong has nothing random
+        paddleA->setMotion(350, 0);
+        paddleB->setMotion(350, 0);
+        score = Score();
+        resetBall();
+    }
+
+    float step(int action) {
+        Uint8 input = action == 1 ? INPUT_UP : action == 2 ? INPUT_DOWN : 0;
+        int before = score.getScoreA() - score.getScoreB();
+        simulate(input, followBall(*paddleB), true); // As a replay, so nothing is logged
+        return static_cast<float>(score.getScoreA() - score.getScoreB() - before);
+    }
+
+    bool done() const { return std::max(score.getScoreA(), score.getScoreB()) >= ENV_POINTS * 10; }
+
+    // Ball position and velocity, both paddles, and whether the ball is in play
+    void observe(float* state) const {
+        state[0] = static_cast<float>(ball->getX()) / PONG_WIDTH;
+        state[1] = static_cast<float>(ball->getY()) / PONG_HEIGHT;
+        state[2] = static_cast<float>(ball->getVelocityX()) / MAX_SPEED;
+        state[3] = static_cast<float>(ball->getVelocityY()) / MAX_SPEED;
+        state[4] = static_cast<float>(paddleA->getY()) / PONG_HEIGHT;
+        state[5] = static_cast<float>(paddleB->getY()) / PONG_HEIGHT;
+        state[6] = isStarted ? 1.0f : 0.0f;
+    }
+
 private:
+    // The training opponent: serves at once, then keeps level with the ball
+    Uint8 followBall(const Pong_Paddle& paddle) const {
+        if (!isStarted) return INPUT_UP;
+        int gap = ball->getY() + ball->getSize() / 2 - (paddle.getY() + paddle.getHeight() / 2);
+        if (gap < -10) return INPUT_UP;
+        if (gap > 10) return INPUT_DOWN;
+        return 0;
+    }
+
+    // Netplay stays on the main thread: quit and video capture only, as
+    // restoring a quick save would desync a networked game
     void handleEvents() {
         SDL_Event e;
         while (SDL_PollEvent(&e)) {
+            recordInput(e);
             if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_CLOSE) {
-                std::cout << "SDL_QUIT event captured. Exiting game loop." << std::endl;
+                logEvent(GAME_PONG, EVENT_QUIT);
                 isRunning = false;
-            }
-
-            if (!isStarted) {
-                const Uint8* keystate = SDL_GetKeyboardState(NULL);
-                if (keystate[SDL_SCANCODE_W] || keystate[SDL_SCANCODE_S] ||
-                    keystate[SDL_SCANCODE_I] || keystate[SDL_SCANCODE_K]) {
-                    isStarted = true;
-                    ball->setVelocity(1, 1); // Set initial velocity when the game starts
-                }
+            } else if (e.type == SDL_KEYDOWN && e.key.repeat == 0) {
+                handleCaptureKey(e.key.keysym.sym, "pong", renderer);
             }
         }
     }
 
-    void update() {
+    // One deterministic step of the game driven only by the two players'
+    // buttons, so the same inputs always produce the same state.
+    void simulate(Uint8 inputA, Uint8 inputB, bool replaying) {
         if (!isStarted) {
-            const Uint8* keystate = SDL_GetKeyboardState(NULL);
-            if (keystate[SDL_SCANCODE_W] || keystate[SDL_SCANCODE_S] ||
-                keystate[SDL_SCANCODE_I] || keystate[SDL_SCANCODE_K]) {
+            if (inputA || inputB) {
                 isStarted = true;
-                ball->setVelocity(1, 1); // Set initial velocity when the game restarts
+                ball->setVelocityFixed(SERVE_SPEED, SERVE_SPEED); // Set initial velocity when the game (re)starts
             }
             return; // Don't update the game until it has started or restarted
         }
 
-        const Uint8* keystate = SDL_GetKeyboardState(NULL);
-        paddleA->handleInput(keystate);
-        paddleB->handleInput(keystate);
+        paddleA->applyInput(inputA);
+        paddleB->applyInput(inputB);
         paddleA->update();
         paddleB->update();
-        ball->update();
-
-        if (ball->collidesWith(*paddleA) || ball->collidesWith(*paddleB)) {
-            ball->reverseX();
-        }
+        ball->update(*paddleA, *paddleB);
 
         if (ball->getX() < 0) {
             Score point; // Temporary score object
             point.incrementScoreB(); // Increment paddle B's score
             score += point; // Add to the main score using overloaded operator
             resetBall();
-            printScores();
+            if (!replaying) printScores();
         } else if (ball->getX() > 1000 - ball->getSize()) {
             Score point;
             point.incrementScoreA(); // Increment paddle A's score
             score += point;
             resetBall();
-            printScores();
+            if (!replaying) printScores();
         }
     }
 
-    void render() {
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
-
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-        SDL_RenderDrawLine(renderer, 500, 0, 500, 800);
-
-        paddleA->render(renderer);
-        paddleB->render(renderer);
-        ball->render(renderer);
-
-        SDL_RenderPresent(renderer);
-    }
-
     void resetBall() {
         ball->setPosition(495, 395); // Reset to center
         ball->setVelocity(0, 0); // Set velocity to zero
@@ -246,8 +631,238 @@ private:
     }
 
     void printScores() {
-        std::cout << "Paddle A Score: " << score.getScoreA() << std::endl;
-        std::cout << "Paddle B Score: " << score.getScoreB()-200 << std::endl;
+        logEvent(GAME_PONG, EVENT_PONG_SCORES, score.getScoreA(), score.getScoreB()-200);
+    }
+
+    // --- Networked play ---------------------------------------------------
+
+    PongSnapshot saveSnapshot() const {
+        PongSnapshot snapshot = {*ball, *paddleA, *paddleB, score, isStarted};
+        return snapshot;
+    }
+
+    void loadSnapshot(const PongSnapshot& snapshot) {
+        *ball = snapshot.ball;
+        *paddleA = snapshot.paddleA;
+        *paddleB = snapshot.paddleB;
+        score = snapshot.score;
+        isStarted = snapshot.isStarted;
+    }
+
+    Uint32 stateChecksum() const {
+        Uint32 hash = 2166136261u;
+        ball->hash(hash);
+        hashValue(hash, paddleA->getY());
+        hashValue(hash, paddleB->getY());
+        hashValue(hash, score.getScoreA());
+        hashValue(hash, score.getScoreB());
+        hashValue(hash, isStarted);
+        return hash;
+    }
+
+    // Remote input for a frame: the real one if it arrived, otherwise a
+    // prediction that the remote player is still holding the last known input.
+    Uint8 remoteInputFor(int frame) const {
+        for (int f = frame; f >= 0 && f > frame - INPUT_HISTORY; --f) {
+            int slot = f % INPUT_HISTORY;
+            if (remoteFrame[slot] == f) return remoteInput[slot];
+        }
+        return 0;
+    }
+
+    void simulateFrame(int frame, bool replaying) {
+        int slot = frame % INPUT_HISTORY;
+        snapshots[slot] = saveSnapshot();
+        Uint8 remote = remoteInputFor(frame);
+        usedRemoteInput[slot] = remote;
+        if (netConfig->localSide == 0) {
+            simulate(localInput[slot], remote, replaying);
+        } else {
+            simulate(remote, localInput[slot], replaying);
+        }
+        checksums[slot] = stateChecksum();
+    }
+
+    void sendInputs(UdpChannel& channel) {
+        Uint8 data[NET_PACKET_SIZE];
+        int count = currentFrame < INPUT_REDUNDANCY ? currentFrame : INPUT_REDUNDANCY;
+        int newest = currentFrame - 1;
+
+        // Checksum of the newest frame both sides have simulated with real inputs
+        int checkedFrame = confirmedRemote < newest ? confirmedRemote : newest;
+        Uint32 checksum = checkedFrame >= 0 ? checksums[checkedFrame % INPUT_HISTORY] : 0;
+
+        int offset = 0;
+        writeValue(data, offset, NET_MAGIC, 2);
+        writeValue(data, offset, static_cast<Uint32>(newest), 4);
+        data[offset++] = static_cast<Uint8>(count);
+        for (int i = 0; i < INPUT_REDUNDANCY; ++i) {
+            int frame = newest - count + 1 + i;
+            data[offset++] = i < count ? localInput[frame % INPUT_HISTORY] : 0;
+        }
+        writeValue(data, offset, static_cast<Uint32>(checkedFrame), 4);
+        writeValue(data, offset, checksum, 4);
+        channel.send(data, offset);
+    }
+
+    // Applies a packet from the peer. rollbackFrom is lowered to the earliest
+    // frame whose predicted remote input turned out to be wrong.
+    void receiveInputs(const Uint8* data, int length) {
+        if (length != NET_PACKET_SIZE) return;
+        int offset = 0;
+        if (readValue(data, offset, 2) != NET_MAGIC) return;
+        int newest = static_cast<Sint32>(readValue(data, offset, 4));
+        int count = data[offset++];
+        if (count > INPUT_REDUNDANCY) return;
+        const Uint8* inputs = data + offset;
+        offset += INPUT_REDUNDANCY;
+        int checkedFrame = static_cast<Sint32>(readValue(data, offset, 4));
+        Uint32 checksum = readValue(data, offset, 4);
+
+        lastPacketTime = SDL_GetTicks();
+        connected = true;
+
+        for (int i = 0; i < count; ++i) {
+            int frame = newest - count + 1 + i;
+            // Frames already confirmed, or too old to roll back to, may share
+            // a slot with a newer frame by now; a late packet must not touch it
+            if (frame < 0 || frame <= confirmedRemote || frame < currentFrame - ROLLBACK_WINDOW) continue;
+            if (frame >= currentFrame + INPUT_HISTORY - ROLLBACK_WINDOW) continue;
+            int slot = frame % INPUT_HISTORY;
+            if (remoteFrame[slot] == frame) continue;
+            remoteFrame[slot] = frame;
+            remoteInput[slot] = inputs[i];
+            if (frame < currentFrame && usedRemoteInput[slot] != inputs[i] && frame < rollbackFrom) {
+                rollbackFrom = frame;
+            }
+        }
+        while (remoteFrame[(confirmedRemote + 1) % INPUT_HISTORY] == confirmedRemote + 1) {
+            confirmedRemote++;
+        }
+
+        // Both sides must agree on any frame they have each simulated with real inputs
+        if (checkedFrame >= 0 && checkedFrame <= confirmedRemote && checkedFrame < currentFrame &&
+            checkedFrame > currentFrame - INPUT_HISTORY && checkedFrame > lastCheckedFrame && rollbackFrom > checkedFrame) {
+            lastCheckedFrame = checkedFrame;
+            if (checksums[checkedFrame % INPUT_HISTORY] != checksum) {
+                desyncCount++;
+                std::cerr << "Desync detected at frame " << checkedFrame << std::endl;
+            }
+        }
+    }
+
+    void rollback(int fromFrame) {
+        int depth = currentFrame - fromFrame;
+        rollbackCount++;
+        rollbackFrames += depth;
+        if (depth > maxRollbackDepth) maxRollbackDepth = depth;
+
+        loadSnapshot(snapshots[fromFrame % INPUT_HISTORY]);
+        for (int frame = fromFrame; frame < currentFrame; ++frame) {
+            simulateFrame(frame, true);
+        }
+    }
+
+    void runNetworked() {
+        UdpChannel channel(netConfig->localPort, netConfig->peerHost, netConfig->peerPort,
+                           netConfig->latencyMs, netConfig->lossPercent);
+        if (!channel.open()) return;
+
+        memset(localInput, 0, sizeof(localInput));
+        memset(remoteInput, 0, sizeof(remoteInput));
+        memset(usedRemoteInput, 0, sizeof(usedRemoteInput));
+        memset(checksums, 0, sizeof(checksums));
+        for (int i = 0; i < INPUT_HISTORY; ++i) remoteFrame[i] = -1;
+        snapshots.assign(INPUT_HISTORY, saveSnapshot());
+        currentFrame = 0;
+        confirmedRemote = -1;
+        lastCheckedFrame = -1;
+        connected = false;
+        lastPacketTime = SDL_GetTicks();
+        rollbackCount = rollbackFrames = maxRollbackDepth = stallCount = desyncCount = 0;
+
+        Pong_Paddle* localPaddle = netConfig->localSide == 0 ? paddleA : paddleB;
+        SnapshotPainter painter(renderer);
+        RenderSnapshot frame;
+        Uint32 nextTick = SDL_GetTicks();
+        std::cout << "Waiting for peer " << netConfig->peerHost << ":" << netConfig->peerPort << std::endl;
+
+        while (isRunning) {
+            heartbeat(LOOP_MAIN);
+            Uint64 tickStart = SDL_GetPerformanceCounter();
+            handleEvents();
+            if (!isRunning) break;
+
+            Uint8 packet[NET_PACKET_SIZE + 1];
+            int length;
+            rollbackFrom = currentFrame;
+            while ((length = channel.receive(packet, sizeof(packet))) > 0) {
+                receiveInputs(packet, length);
+            }
+            if (rollbackFrom < currentFrame) rollback(rollbackFrom);
+
+            if (connected && SDL_GetTicks() - lastPacketTime > NET_TIMEOUT_MS) {
+                std::cout << "Peer timed out." << std::endl;
+                break;
+            }
+
+            if (!connected) {
+                // Keep announcing ourselves until the peer answers
+            } else if (currentFrame - confirmedRemote > ROLLBACK_WINDOW) {
+                stallCount++; // Too far ahead of the peer, wait for its inputs
+            } else {
+                // Both paddles are steered with W/S on their own machine
+                const Uint8* keystate = SDL_GetKeyboardState(NULL);
+                Uint8 buttons = 0;
+                if (keystate[SDL_SCANCODE_W]) buttons |= INPUT_UP;
+                if (keystate[SDL_SCANCODE_S]) buttons |= INPUT_DOWN;
+                buttons |= localPaddle->readInput(keystate);
+                localInput[currentFrame % INPUT_HISTORY] = buttons;
+                simulateFrame(currentFrame, false);
+                currentFrame++;
+                metrics().ticks.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            sendInputs(channel);
+            channel.pump();
+            snapshot(frame);
+            recordPhase(PHASE_TICK, tickStart);
+            Uint64 start = SDL_GetPerformanceCounter();
+            painter.draw(frame);
+            recordPhase(PHASE_DRAW, start);
+            start = SDL_GetPerformanceCounter();
+            presentFrame(renderer);
+            recordPhase(PHASE_PRESENT, start);
+
+            nextTick += NET_TICK_MS;
+            Uint32 now = SDL_GetTicks();
+            if (static_cast<Sint32>(nextTick - now) > 0) {
+                SDL_Delay(nextTick - now);
+            } else {
+                nextTick = now;
+            }
+        }
+
+        heartbeatIdle(LOOP_MAIN);
+        std::cout << "Netplay stats: frames " << currentFrame
+                  << ", rollbacks " << rollbackCount
+                  << ", re-simulated frames " << rollbackFrames
+                  << ", max rollback depth " << maxRollbackDepth
+                  << ", average depth " << (rollbackCount ? static_cast<double>(rollbackFrames) / rollbackCount : 0.0)
+                  << ", stalls " << stallCount
+                  << ", desyncs " << desyncCount
+                  << ", packets sent " << channel.getSentCount()
+                  << ", packets dropped " << channel.getDroppedCount() << std::endl;
+    }
+
+    static void writeValue(Uint8* data, int& offset, Uint32 value, int bytes) {
+        for (int i = 0; i < bytes; ++i) data[offset++] = static_cast<Uint8>(value >> (i * 8));
+    }
+
+    static Uint32 readValue(const Uint8* data, int& offset, int bytes) {
+        Uint32 value = 0;
+        for (int i = 0; i < bytes; ++i) value |= static_cast<Uint32>(data[offset++]) << (i * 8);
+        return value;
     }
 
 private:
@@ -259,6 +874,24 @@ private:
     Pong_Paddle* paddleB;
     Pong_Ball* ball;
     Score score;
+    QuickSaveSlots quickSaves;
+    RewindControl rewind; // Local play only; a networked game cannot go back
+
+    // Netplay state, only used when netConfig is set
+    const PongNetConfig* netConfig;
+    int currentFrame;
+    int confirmedRemote; // every remote input up to this frame has arrived
+    int lastCheckedFrame;
+    int rollbackFrom;
+    bool connected;
+    Uint32 lastPacketTime;
+    Uint8 localInput[INPUT_HISTORY];
+    Uint8 remoteInput[INPUT_HISTORY];
+    int remoteFrame[INPUT_HISTORY];
+    Uint8 usedRemoteInput[INPUT_HISTORY];
+    Uint32 checksums[INPUT_HISTORY];
+    std::vector<PongSnapshot> snapshots;
+    int rollbackCount, rollbackFrames, maxRollbackDepth, stallCount, desyncCount;
 };
 
 void runPongGame() {
@@ -266,4 +899,62 @@ void runPongGame() {
     game.run();
 }
 
+void runPongNetGame(const PongNetConfig& config) {
+    PongGame game(&config);
+    game.run();
+}
+
+void benchPongSaveState(int iterations) {
+    PongGame game(nullptr, true);
+    game.benchSaveState(iterations);
+}
+
+static GameEnv* createPongEnv() {
+    return new PongGame(nullptr, true);
+}
+
+static Simulation* createPongSimulation(bool rewind) {
+    PongGame* game = new PongGame(nullptr, true);
+    game->recordRewind(rewind);
+    return game;
+}
+
+// Attract mode: serves, then meets the ball while it comes towards the
+// left paddle and drifts back to the middle while it goes away
+static int autoplayPong(const float* state) {
+    if (state[6] == 0.0f) return 1;
+    float target = state[2] < 0.0f ? state[1] * PONG_HEIGHT + 10 : PONG_HEIGHT / 2;
+    float gap = target - (state[4] * PONG_HEIGHT + 75); // Ball and paddle centres
+    return gap < -12 ? 1 : gap > 12 ? 2 : 0;
+}
+
+// Emulator --net-pong <A|B> <localPort> <peerHost> <peerPort> [latencyMs] [lossPercent]
+// Emulator --bench-savestate [iterations]
+static bool runPongCommand(int argc, char* argv[]) {
+    if (argc >= 6 && strcmp(argv[1], "--net-pong") == 0) {
+        PongNetConfig config;
+        config.localSide = (argv[2][0] == 'B' || argv[2][0] == 'b') ? 1 : 0;
+        config.localPort = atoi(argv[3]);
+        config.peerHost = argv[4];
+        config.peerPort = atoi(argv[5]);
+        config.latencyMs = argc > 6 ? atoi(argv[6]) : 0;
+        config.lossPercent = argc > 7 ? atoi(argv[7]) : 0;
+        runPongNetGame(config);
+        return true;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-savestate") == 0) {
+        benchPongSaveState(argc > 2 ? atoi(argv[2]) : 10000);
+        return true;
+    }
+    return false;
+}
+
+GAME_MODULE_EXPORT const GameModule* arcadeGameModule() {
+    static const GameEnvSpec env = {PongGame::ENV_ACTIONS, PongGame::ENV_STATE_SIZE, PONG_WIDTH, PONG_HEIGHT, createPongEnv,
+                                     autoplayPong};
+    static const GameModule module = {GAME_MODULE_API_VERSION, "Pong", "pong", false, runPongGame, runPongCommand, &env,
+                                      createPongSimulation};
+    return &module;
+}
+
 
@@ -1,6 +1,21 @@
 #ifndef PONG_H
 #define PONG_H
 
+// Two-player pong over UDP with rollback. Side 0 plays the left paddle and
+// side 1 the right. Latency and loss are simulated on our outgoing packets.
+struct PongNetConfig {
+    int localSide;
+    int localPort;
+    const char* peerHost;
+    int peerPort;
+    int latencyMs;
+    int lossPercent;
+};
+
 void runPongGame();
+void runPongNetGame(const PongNetConfig& config);
+
+// Headless timing of save state and load state
+void benchPongSaveState(int iterations);
 
 #endif // TETRIS_H
@@ -0,0 +1,152 @@
+#include "render_snapshot.h"
+#include "soft_raster.h"
+#include <iostream>
+
+void RectList::clear() {
+    rects.clear();
+    batches.clear();
+}
+
+void RectList::reserve(size_t count) {
+    rects.reserve(count);
+    batches.reserve(count);
+}
+
+void RectList::add(const SDL_Rect& rect, SDL_Color color, bool filled) {
+    if (batches.empty() || batches.back().filled != filled ||
+        batches.back().color.r != color.r || batches.back().color.g != color.g ||
+        batches.back().color.b != color.b || batches.back().color.a != color.a) {
+        RectBatch batch = {color, filled, static_cast<int>(rects.size()), 0};
+        batches.push_back(batch);
+    }
+    rects.push_back(rect);
+    batches.back().count++;
+}
+
+void RectList::draw(SDL_Renderer* renderer) const {
+    for (const RectBatch& batch : batches) {
+        SDL_SetRenderDrawColor(renderer, batch.color.r, batch.color.g, batch.color.b, batch.color.a);
+        if (batch.filled) {
+            SDL_RenderFillRects(renderer, &rects[batch.first], batch.count);
+        } else {
+            SDL_RenderDrawRects(renderer, &rects[batch.first], batch.count);
+        }
+    }
+}
+
+RenderSnapshot::RenderSnapshot()
+    : layerVersion(0), layerBase(0), layerErasedCount(0), indices(nullptr), indexCount(0), tick(0) {
+    background.r = background.g = background.b = 0;
+    background.a = 255;
+    allocations.count = allocations.bytes = 0;
+}
+
+void RenderSnapshot::clear(SDL_Color newBackground) {
+    background = newBackground;
+    shapes.clear();
+    vertices.clear();
+    indices = nullptr;
+    indexCount = 0;
+}
+
+SnapshotPainter::SnapshotPainter(SDL_Renderer* renderer)
+    : renderer(renderer), layerTexture(nullptr), texturesValid(false), layerVersion(0), layerBase(0), layerErased(0),
+      raster(nullptr), frameTexture(nullptr) {
+    setSoftware(softRasterEnabled());
+}
+
+SnapshotPainter::~SnapshotPainter() {
+    if (layerTexture) SDL_DestroyTexture(layerTexture);
+    if (frameTexture) SDL_DestroyTexture(frameTexture);
+    delete raster;
+}
+
+void SnapshotPainter::setSoftware(bool software) {
+    if (software && !raster) {
+        raster = new SoftRaster();
+    } else if (!software && raster) {
+        delete raster;
+        raster = nullptr;
+    }
+}
+
+void SnapshotPainter::draw(const RenderSnapshot& snapshot) {
+    if (raster) {
+        drawSoftware(snapshot);
+        return;
+    }
+    const SDL_Color& bg = snapshot.background;
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+    if (!snapshot.layer.empty() && !layerTexture && SDL_RenderTargetSupported(renderer)) {
+        int width = 0, height = 0;
+        SDL_GetRendererOutputSize(renderer, &width, &height);
+        layerTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+        if (layerTexture) SDL_SetTextureBlendMode(layerTexture, SDL_BLENDMODE_BLEND);
+        texturesValid = false;
+    }
+    if (layerTexture && (!texturesValid || layerVersion != snapshot.layerVersion)) {
+        SDL_SetRenderTarget(renderer, layerTexture);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+        if (texturesValid && layerBase == snapshot.layerBase && layerErased < snapshot.layerErasedCount) {
+            // Only rects taken away: back to transparent, which blending
+            // being off writes as is
+            SDL_RenderFillRects(renderer, &snapshot.layerErased[layerErased], snapshot.layerErasedCount - layerErased);
+        } else {
+            // The layer already leaves out the rects erased so far
+            SDL_RenderClear(renderer);
+            snapshot.layer.draw(renderer);
+        }
+        SDL_SetRenderTarget(renderer, nullptr);
+        texturesValid = true;
+        layerVersion = snapshot.layerVersion;
+        layerBase = snapshot.layerBase;
+        layerErased = snapshot.layerErasedCount;
+    }
+
+    SDL_SetRenderDrawColor(renderer, bg.r, bg.g, bg.b, bg.a);
+    SDL_RenderClear(renderer);
+    if (layerTexture) {
+        if (!snapshot.layer.empty()) SDL_RenderCopy(renderer, layerTexture, nullptr, nullptr);
+    } else {
+        snapshot.layer.draw(renderer);
+    }
+    snapshot.shapes.draw(renderer);
+    drawGeometry(snapshot);
+}
+
+void SnapshotPainter::drawSoftware(const RenderSnapshot& snapshot) {
+    int width = 0, height = 0;
+    SDL_GetRendererOutputSize(renderer, &width, &height);
+    raster->rasterise(snapshot, width, height, softRasterPool());
+
+    int textureWidth = 0, textureHeight = 0;
+    if (frameTexture) SDL_QueryTexture(frameTexture, nullptr, nullptr, &textureWidth, &textureHeight);
+    // A device reset loses every texture, so it is made again
+    if (frameTexture && (!texturesValid || textureWidth != width || textureHeight != height)) {
+        SDL_DestroyTexture(frameTexture);
+        frameTexture = nullptr;
+    }
+    if (!frameTexture) {
+        frameTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+        if (!frameTexture) {
+            std::cerr << "Cannot create the software raster texture: " << SDL_GetError() << std::endl;
+            setSoftware(false);
+            draw(snapshot);
+            return;
+        }
+        SDL_SetTextureBlendMode(frameTexture, SDL_BLENDMODE_NONE);
+        texturesValid = true;
+    }
+    SDL_UpdateTexture(frameTexture, nullptr, raster->pixels(), width * 4);
+    SDL_RenderCopy(renderer, frameTexture, nullptr, nullptr);
+    drawGeometry(snapshot);
+}
+
+void SnapshotPainter::drawGeometry(const RenderSnapshot& snapshot) {
+    if (snapshot.indexCount > 0) {
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+        SDL_RenderGeometry(renderer, nullptr, snapshot.vertices.data(), static_cast<int>(snapshot.vertices.size()),
+                           snapshot.indices, snapshot.indexCount);
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef RENDER_SNAPSHOT_H
+#define RENDER_SNAPSHOT_H
+
+#include <SDL.h>
+#include <vector>
+#include "alloc_tracker.h"
+
+class SoftRaster;
+
+// Rects in draw order, with each run of one colour and style kept together
+// so it is drawn with a single SDL_RenderFillRects or SDL_RenderDrawRects
+struct RectBatch {
+    SDL_Color color;
+    bool filled;
+    int first;
+    int count;
+};
+
+class RectList {
+public:
+    // Keeps the capacity, so a list refilled every tick stops allocating
+    void clear();
+    // Room for this many rects, for lists whose size jumps around
+    void reserve(size_t count);
+    void add(const SDL_Rect& rect, SDL_Color color, bool filled = true);
+    void draw(SDL_Renderer* renderer) const;
+    bool empty() const { return rects.empty(); }
+
+    const std::vector<SDL_Rect>& getRects() const { return rects; }
+    const std::vector<RectBatch>& getBatches() const { return batches; }
+
+private:
+    std::vector<SDL_Rect> rects;
+    std::vector<RectBatch> batches;
+};
+
+// Everything a game draws for one tick, written by the simulation and
+// drawn later by whichever thread owns the renderer. It holds copies only,
+// never pointers into the game, apart from index buffers that do not change
+// while the game runs.
+//
+// The layer is kept from one tick to the next, so a game only refills it
+// when its version changes. When the only change since layerBase is rects
+// taken away, the game lists them in layerErased and the painter clears
+// just those from its texture instead of drawing the whole layer again.
+struct RenderSnapshot {
+    static const int MAX_LAYER_ERASED = 64;
+
+    SDL_Color background;
+    RectList layer;          // Rarely changes: drawn once into a texture
+    Uint32 layerVersion;     // Bump whenever layer holds something new
+    Uint32 layerBase;        // Version the erased rects are counted from
+    SDL_Rect layerErased[MAX_LAYER_ERASED]; // Gone from the layer since layerBase, oldest first
+    int layerErasedCount;
+    RectList shapes;         // Drawn over the layer every frame
+    std::vector<SDL_Vertex> vertices; // Blended triangles drawn last
+    const int* indices;
+    int indexCount;
+    Uint64 tick;             // Filled in by the simulation thread
+    AllocationCount allocations; // Made by that tick and this snapshot
+
+    RenderSnapshot();
+
+    // Empties every list but the layer for the next tick
+    void clear(SDL_Color newBackground);
+};
+
+// Draws snapshots to one renderer. The layer is kept in a target texture;
+// erased rects are cleared out of it and it is only drawn again in full
+// when its base changes or the texture is lost. With the software rasteriser
+// on (soft_raster.h) the rects are drawn on the CPU instead and uploaded
+// as one texture.
+class SnapshotPainter {
+public:
+    explicit SnapshotPainter(SDL_Renderer* renderer);
+    ~SnapshotPainter();
+
+    void draw(const RenderSnapshot& snapshot);
+
+    // Call on SDL_RENDER_TARGETS_RESET or SDL_RENDER_DEVICE_RESET
+    void invalidate() { texturesValid = false; }
+
+    // Starts as softRasterEnabled() says
+    void setSoftware(bool software);
+
+private:
+    void drawSoftware(const RenderSnapshot& snapshot);
+    void drawGeometry(const RenderSnapshot& snapshot);
+
+    SDL_Renderer* renderer;
+    SDL_Texture* layerTexture;
+    bool texturesValid;
+    Uint32 layerVersion;     // What layerTexture holds
+    Uint32 layerBase;
+    int layerErased;
+    SoftRaster* raster;
+    SDL_Texture* frameTexture;   // Streaming upload of the raster
+};
+
+#endif
@@ -0,0 +1,276 @@
+#include "rewind_buffer.h"
+#include <cstring>
+#include <iostream>
+
+static double microsSince(Uint64 start) {
+    return static_cast<double>(SDL_GetPerformanceCounter() - start) * 1e6 / SDL_GetPerformanceFrequency();
+}
+
+RewindBuffer::RewindBuffer(size_t budgetBytes, int maxTicks, int keyframeInterval, uint64_t maxMicros)
+    : budget(budgetBytes), maxEntries(maxTicks > 2 ? maxTicks : 2), first(0), count(0), writePos(0),
+      keyframeInterval(keyframeInterval > 0 ? keyframeInterval : 1), maxSpan(maxMicros), span(0) {}
+
+void RewindBuffer::clear() {
+    first = count = 0;
+    writePos = 0;
+    span = 0;
+    current.clear();
+}
+
+size_t RewindBuffer::bytesUsed() const {
+    size_t used = 0;
+    for (int i = 0; i < count; ++i) used += entryAt(i).keySize + entryAt(i).backSize;
+    return used;
+}
+
+int RewindBuffer::keyframes() const {
+    int keys = 0;
+    for (int i = 0; i < count; ++i) keys += entryAt(i).keySize > 0;
+    return keys;
+}
+
+void RewindBuffer::dropOldest() {
+    span -= entryAt(0).micros;
+    first = (first + 1) % entries.size();
+    count--;
+}
+
+// Finds room for size bytes at writePos, dropping the oldest ticks as
+// needed. Entries are laid out in tick order around the storage ring.
+bool RewindBuffer::reserve(uint32_t size) {
+    if (size > storage.size()) return false;
+    if (count == static_cast<int>(entries.size())) dropOldest();
+    for (;;) {
+        if (count == 0) {
+            if (writePos + size > storage.size()) writePos = 0;
+            return true;
+        }
+        uint32_t oldest = entryAt(0).offset;
+        if (oldest >= writePos) {
+            if (writePos + size <= oldest) return true;
+        } else {
+            if (writePos + size <= storage.size()) return true;
+            writePos = 0; // Leave the tail unused and carry on from the start
+            continue;
+        }
+        dropOldest();
+    }
+}
+
+// Runs of unchanged bytes become a count; changed bytes are stored as
+// their XOR. Each run is <zero count><literal count><literals>, counts as
+// 7-bit varints.
+void RewindBuffer::encodeXor(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b,
+                             std::vector<unsigned char>& out) {
+    out.clear();
+    size_t size = a.size();
+    size_t i = 0;
+    while (i < size) {
+        size_t zeros = 0;
+        while (i + zeros < size && a[i + zeros] == b[i + zeros]) zeros++;
+        size_t literals = 0;
+        // A short unchanged gap is cheaper to store as literals than as a new run
+        while (i + zeros + literals < size) {
+            size_t at = i + zeros + literals;
+            if (a[at] != b[at]) {
+                literals++;
+            } else if (at + 2 < size && (a[at + 1] != b[at + 1] || a[at + 2] != b[at + 2])) {
+                literals++;
+            } else {
+                break;
+            }
+        }
+        for (size_t value = zeros; ; value >>= 7) {
+            out.push_back(static_cast<unsigned char>((value & 0x7f) | (value >= 0x80 ? 0x80 : 0)));
+            if (value < 0x80) break;
+        }
+        for (size_t value = literals; ; value >>= 7) {
+            out.push_back(static_cast<unsigned char>((value & 0x7f) | (value >= 0x80 ? 0x80 : 0)));
+            if (value < 0x80) break;
+        }
+        for (size_t k = 0; k < literals; ++k) {
+            size_t at = i + zeros + k;
+            out.push_back(a[at] ^ b[at]);
+        }
+        i += zeros + literals;
+    }
+}
+
+void RewindBuffer::applyXor(const unsigned char* delta, size_t deltaSize, std::vector<unsigned char>& state) {
+    size_t in = 0, at = 0;
+    while (in < deltaSize) {
+        size_t counts[2] = {0, 0};
+        for (int c = 0; c < 2; ++c) {
+            int shift = 0;
+            unsigned char byte;
+            do {
+                byte = delta[in++];
+                counts[c] |= static_cast<size_t>(byte & 0x7f) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+        }
+        at += counts[0];
+        for (size_t k = 0; k < counts[1]; ++k) state[at++] ^= delta[in++];
+    }
+}
+
+// Turns the state of entry's tick into the state of the tick before it
+void RewindBuffer::stepFrom(const Entry& entry, const unsigned char* storage, std::vector<unsigned char>& state) {
+    const unsigned char* back = storage + entry.offset + entry.keySize;
+    if (entry.backKind == BACK_XOR) {
+        applyXor(back, entry.backSize, state);
+    } else {
+        state.assign(back, back + entry.backSize);
+    }
+}
+
+void RewindBuffer::record(const std::vector<unsigned char>& state, uint32_t tickMicros) {
+    if (storage.empty()) {
+        storage.resize(budget);
+        entries.resize(maxEntries);
+    }
+    // Sized by the caller's capacity, which a game whose state grows can
+    // reserve up front. An XOR delta is never much over twice the state,
+    // since runs are at least three unchanged bytes apart.
+    if (current.capacity() < state.capacity()) current.reserve(state.capacity());
+    if (scratch.capacity() < 2 * state.capacity() + 16) scratch.reserve(2 * state.capacity() + 16);
+    Entry entry;
+    entry.tick = count > 0 ? entryAt(count - 1).tick + 1 : 0;
+    entry.micros = tickMicros;
+    bool key = count == 0 || entry.tick % keyframeInterval == 0;
+    entry.keySize = key ? static_cast<uint32_t>(state.size()) : 0;
+
+    const std::vector<unsigned char>* back = &scratch;
+    if (count == 0) {
+        entry.backKind = BACK_NONE;
+        scratch.clear();
+    } else if (state.size() == current.size()) {
+        entry.backKind = BACK_XOR;
+        encodeXor(state, current, scratch);
+    } else {
+        entry.backKind = BACK_RAW; // The layout changed size, e.g. the snake grew
+        back = &current;
+    }
+    entry.backSize = static_cast<uint32_t>(back->size());
+
+    if (!reserve(entry.keySize + entry.backSize)) {
+        clear(); // A single tick does not fit in the budget
+        return;
+    }
+    entry.offset = writePos;
+    if (entry.keySize) memcpy(&storage[writePos], state.data(), entry.keySize);
+    if (entry.backSize) memcpy(&storage[writePos + entry.keySize], back->data(), entry.backSize);
+    writePos += entry.keySize + entry.backSize;
+    entries[(first + count) % entries.size()] = entry;
+    count++;
+    span += entry.micros;
+    current = state;
+    while (maxSpan && span > maxSpan && count > 1) dropOldest();
+}
+
+bool RewindBuffer::stepBack(std::vector<unsigned char>& state) {
+    if (count < 2) return false;
+    const Entry& newest = entryAt(count - 1);
+    stepFrom(newest, storage.data(), current);
+    writePos = newest.offset;
+    span -= newest.micros;
+    count--;
+    state = current;
+    return true;
+}
+
+bool RewindBuffer::peek(int ticksBack, std::vector<unsigned char>& state) const {
+    if (ticksBack < 0 || ticksBack >= count) return false;
+    int target = count - 1 - ticksBack;
+    int from = count - 1;
+    for (int i = target; i < count - 1; ++i) {
+        if (entryAt(i).keySize) {
+            from = i;
+            break;
+        }
+    }
+    if (from == count - 1) {
+        state = current;
+    } else {
+        const Entry& key = entryAt(from);
+        const unsigned char* bytes = storage.data() + key.offset;
+        state.assign(bytes, bytes + key.keySize);
+    }
+    for (int i = from; i > target; --i) stepFrom(entryAt(i), storage.data(), state);
+    return true;
+}
+
+RewindControl::RewindControl(const char* gameName, Snapshotable& game, int seconds, size_t budgetBytes, SDL_Scancode key)
+    : gameName(gameName), game(game),
+      buffer(budgetBytes, seconds * SAMPLES_PER_SECOND, 2 * SAMPLES_PER_SECOND, static_cast<uint64_t>(seconds) * 1000000),
+      key(key), enabled(true), lastStep(0), steps(0), stepMicros(0) {}
+
+bool RewindControl::rewinding(const Uint8* keystate) {
+    if (!enabled || !keystate || !keystate[key]) return false;
+
+    // Step back at the rate history was recorded: each tick is undone
+    // after as long as it took to play
+    Uint64 start = SDL_GetPerformanceCounter();
+    if (microsSince(lastStep) < buffer.newestMicros()) return true;
+    lastStep = start;
+    if (buffer.stepBack(state)) {
+        game.loadState(state.data(), state.size());
+        stepMicros += microsSince(start);
+        steps++;
+    }
+    return true;
+}
+
+void RewindControl::recordTick(Uint32 tickMicros) {
+    if (!enabled) return;
+    game.saveState(state);
+    buffer.record(state, tickMicros);
+}
+
+void RewindControl::printStats() {
+    int ticks = buffer.ticks();
+    if (ticks < 2) return;
+    double seconds = buffer.micros() / 1e6;
+    if (seconds <= 0) return;
+    Uint64 start = SDL_GetPerformanceCounter();
+    buffer.peek(ticks - 1, state);
+    double oldestMicros = microsSince(start);
+    std::cout << gameName << " rewind: " << seconds << " s of history in " << buffer.bytesUsed() << " bytes ("
+              << static_cast<long long>(buffer.bytesUsed() / seconds) << " bytes/s, " << buffer.keyframes()
+              << " keyframes), restoring the oldest tick " << oldestMicros << " us";
+    if (steps) std::cout << ", " << stepMicros / steps << " us per step back over " << steps << " steps";
+    std::cout << std::endl;
+}
+
+void benchmarkRewind(const char* gameName, Snapshotable& game, const std::function<Uint32()>& tick, int ticks) {
+    RewindBuffer buffer(16 * 1024 * 1024, ticks + 1, 2 * RewindControl::SAMPLES_PER_SECOND);
+    std::vector<unsigned char> state, expected;
+    double saveMicros = 0;
+    for (int t = 0; t < ticks; ++t) {
+        Uint32 tickMicros = tick();
+        Uint64 start = SDL_GetPerformanceCounter();
+        game.saveState(state);
+        buffer.record(state, tickMicros);
+        saveMicros += microsSince(start);
+    }
+    double seconds = buffer.micros() / 1e6;
+    if (ticks <= 0 || seconds <= 0) return;
+    size_t used = buffer.bytesUsed();
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    buffer.peek(buffer.ticks() - 1, expected);
+    double oldestMicros = microsSince(start);
+
+    // Walk all the way back; the last step must land on the oldest tick
+    int steps = 0;
+    start = SDL_GetPerformanceCounter();
+    while (buffer.stepBack(state)) steps++;
+    double stepMicros = steps ? microsSince(start) / steps : 0;
+    bool matches = state == expected && game.loadState(state.data(), state.size());
+
+    std::cout << gameName << " rewind: " << seconds << " s at " << ticks / seconds << " Hz in "
+              << used << " bytes (" << static_cast<long long>(used / seconds) << " bytes/s, full copies would be "
+              << static_cast<long long>(state.size() * ticks / seconds) << " bytes/s), record "
+              << saveMicros / ticks << " us/tick, step back " << stepMicros << " us, restore oldest "
+              << oldestMicros << " us" << (matches ? "" : "  MISMATCH") << std::endl;
+}
@@ -0,0 +1,120 @@
+#ifndef REWIND_BUFFER_H
+#define REWIND_BUFFER_H
+
+#include <SDL.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "save_state.h"
+
+// History of a game's save states within a fixed memory budget. Each tick
+// is stored as the XOR of its state with the tick before, run-length
+// encoded, so only the bytes that changed take space. Since XOR undoes
+// itself, the same delta steps from a tick back to the one before it.
+// Every keyframeInterval ticks the full state is kept as well, which bounds
+// the cost of jumping straight to an older tick. When the budget or the
+// tick or time limit is reached the oldest ticks are dropped. Each tick
+// also keeps how long it lasted, since a game's tick rate can change.
+class RewindBuffer {
+public:
+    // A maxMicros of 0 limits the history by ticks and bytes only
+    RewindBuffer(size_t budgetBytes, int maxTicks, int keyframeInterval, uint64_t maxMicros = 0);
+
+    // Appends the state of the tick just played, which lasted tickMicros
+    void record(const std::vector<unsigned char>& state, uint32_t tickMicros);
+
+    // Drops the newest tick and puts the one before it in state. False when
+    // there is no older tick left.
+    bool stepBack(std::vector<unsigned char>& state);
+
+    // The state from ticksBack ticks ago without changing the history.
+    // Starts from the nearest keyframe at or after that tick.
+    bool peek(int ticksBack, std::vector<unsigned char>& state) const;
+
+    void clear();
+
+    int ticks() const { return count; }
+    uint64_t micros() const { return span; } // Play time the history covers
+    uint32_t newestMicros() const { return count ? entryAt(count - 1).micros : 0; }
+    size_t bytesUsed() const;
+    int keyframes() const;
+
+private:
+    enum BackKind : uint8_t { BACK_NONE, BACK_XOR, BACK_RAW };
+
+    struct Entry {
+        uint32_t offset;    // Key state then back data, contiguous in storage
+        uint32_t keySize;   // Full state of this tick; 0 when not a keyframe
+        uint32_t backSize;  // Encoded way back to the previous tick
+        uint32_t tick;
+        uint32_t micros;    // How long the tick lasted
+        BackKind backKind;
+    };
+
+    const Entry& entryAt(int index) const { return entries[(first + index) % entries.size()]; }
+    bool reserve(uint32_t size);
+    void dropOldest();
+    static void encodeXor(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b,
+                          std::vector<unsigned char>& out);
+    static void applyXor(const unsigned char* delta, size_t deltaSize, std::vector<unsigned char>& state);
+    static void stepFrom(const Entry& entry, const unsigned char* storage, std::vector<unsigned char>& state);
+
+    size_t budget;
+    int maxEntries;
+    std::vector<unsigned char> storage;   // Both allocated by the first record()
+    std::vector<Entry> entries;   // Ring of tick records, oldest at first
+    int first;
+    int count;
+    uint32_t writePos;
+    int keyframeInterval;
+    uint64_t maxSpan;
+    uint64_t span;   // Sum of the entries' micros
+    std::vector<unsigned char> current;   // State of the newest tick
+    std::vector<unsigned char> scratch;
+};
+
+// Hold-to-rewind for one game. Samples the game's state after every tick
+// on the simulation thread, and while the rewind key is held plays the
+// history backwards at the pace it was recorded.
+class RewindControl {
+public:
+    // Fastest tick rate the history is sized for
+    static const int SAMPLES_PER_SECOND = 60;
+
+    RewindControl(const char* gameName, Snapshotable& game, int seconds = 60,
+                  size_t budgetBytes = 2 * 1024 * 1024, SDL_Scancode key = SDL_SCANCODE_BACKSPACE);
+
+    // Call once per frame before updating the game with the keyboard state
+    // the update would use. While the key is held this restores an older
+    // state and returns true: skip the update.
+    bool rewinding(const Uint8* keystate);
+
+    // Call after each update with the game's current tickMicros()
+    void recordTick(Uint32 tickMicros);
+
+    // While off nothing is recorded and the key does nothing, for copies of
+    // a game that nobody will rewind
+    void setEnabled(bool on) { enabled = on; }
+
+    // History length and size, bytes per second, and restore costs
+    void printStats();
+
+private:
+    std::string gameName;
+    Snapshotable& game;
+    RewindBuffer buffer;
+    SDL_Scancode key;
+    bool enabled;
+    std::vector<unsigned char> state;
+    Uint64 lastStep;
+    long long steps;
+    double stepMicros;
+};
+
+// Plays the game for a number of ticks into a rewind buffer, then prints
+// bytes per second of history and the cost of stepping back and of
+// restoring the oldest tick. tick plays one and returns how long it lasts.
+void benchmarkRewind(const char* gameName, Snapshotable& game, const std::function<Uint32()>& tick, int ticks);
+
+#endif
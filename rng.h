@@ -0,0 +1,32 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+// Small xorshift generator. Its whole state is one word, so a game can save
+// and restore it with the rest of its state and replay the same pieces,
+// apples and colours afterwards, which rand() cannot do.
+class Rng {
+public:
+    explicit Rng(uint32_t seedValue = 2463534242u) { seed(seedValue); }
+
+    void seed(uint32_t seedValue) { state = seedValue ? seedValue : 2463534242u; }
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Uniform enough for game use in [0, n)
+    int below(int n) { return static_cast<int>(next() % static_cast<uint32_t>(n)); }
+
+    uint32_t getState() const { return state; }
+    void setState(uint32_t value) { seed(value); }
+
+private:
+    uint32_t state;
+};
+
+#endif
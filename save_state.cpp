@@ -0,0 +1,160 @@
+#include "save_state.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+uint32_t saveStateChecksum(const unsigned char* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static double microsSince(Uint64 start) {
+    return static_cast<double>(SDL_GetPerformanceCounter() - start) * 1e6 / SDL_GetPerformanceFrequency();
+}
+
+QuickSaveSlots::QuickSaveSlots(const char* gameName, EventGame game, Snapshotable& target)
+    : gameName(gameName), game(game), target(target), current(0), fileLock(nullptr), fileQueued(nullptr),
+      writer(nullptr), stopRequested(false) {
+    for (int i = 0; i < SLOT_COUNT; ++i) pending[i] = false;
+}
+
+QuickSaveSlots::~QuickSaveSlots() {
+    if (writer) {
+        SDL_LockMutex(fileLock);
+        stopRequested = true;
+        SDL_CondSignal(fileQueued);
+        SDL_UnlockMutex(fileLock);
+        SDL_WaitThread(writer, nullptr);
+    }
+    if (fileQueued) SDL_DestroyCond(fileQueued);
+    if (fileLock) SDL_DestroyMutex(fileLock);
+}
+
+bool QuickSaveSlots::handleKey(SDL_Keycode key) {
+    switch (key) {
+        case SDLK_F1: current = 0; break;
+        case SDLK_F2: current = 1; break;
+        case SDLK_F3: current = 2; break;
+        case SDLK_F4: current = 3; break;
+        case SDLK_F5: save(); break;
+        case SDLK_F9: load(); break;
+        default: return false;
+    }
+    return true;
+}
+
+std::string QuickSaveSlots::slotPath(int slot) const {
+    return "saves/" + gameName + "-" + std::to_string(slot + 1) + ".sav";
+}
+
+void QuickSaveSlots::save() {
+    std::vector<unsigned char>& slot = slots[current];
+    Uint64 start = SDL_GetPerformanceCounter();
+    target.saveState(slot);
+    double micros = microsSince(start);
+    logEvent(game, EVENT_STATE_SAVED, current + 1, static_cast<int32_t>(slot.size()));
+    std::cout << gameName << ": saved slot " << current + 1 << " in " << micros << " us" << std::endl;
+
+    if (!writer) {
+        if (!fileLock) fileLock = SDL_CreateMutex();
+        if (!fileQueued) fileQueued = SDL_CreateCond();
+        if (fileLock && fileQueued) writer = SDL_CreateThread(writerMain, "QuickSave", this);
+        if (!writer) {
+            std::cerr << "Cannot start quick save writer, slot " << current + 1 << " is kept in memory only: "
+                      << SDL_GetError() << std::endl;
+            return;
+        }
+    }
+    // Replaces a save of this slot the writer has not got to yet
+    SDL_LockMutex(fileLock);
+    pendingBytes[current] = slot;
+    pending[current] = true;
+    SDL_CondSignal(fileQueued);
+    SDL_UnlockMutex(fileLock);
+}
+
+// Writes queued slots until asked to stop, then writes what is left
+int QuickSaveSlots::writerMain(void* data) {
+    QuickSaveSlots& self = *static_cast<QuickSaveSlots*>(data);
+    std::vector<unsigned char> bytes;
+#ifdef _WIN32
+    _mkdir("saves");
+#else
+    mkdir("saves", 0755);
+#endif
+    SDL_LockMutex(self.fileLock);
+    for (;;) {
+        int slot = 0;
+        while (slot < SLOT_COUNT && !self.pending[slot]) slot++;
+        if (slot == SLOT_COUNT) {
+            if (self.stopRequested) break;
+            SDL_CondWait(self.fileQueued, self.fileLock);
+            continue;
+        }
+        bytes.swap(self.pendingBytes[slot]);
+        self.pending[slot] = false;
+        SDL_UnlockMutex(self.fileLock);
+
+        std::string path = self.slotPath(slot);
+        std::ofstream file(path.c_str(), std::ios::binary);
+        if (!file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size())) {
+            std::cerr << "Cannot write " << path << std::endl;
+        }
+        SDL_LockMutex(self.fileLock);
+    }
+    SDL_UnlockMutex(self.fileLock);
+    return 0;
+}
+
+void QuickSaveSlots::load() {
+    std::vector<unsigned char>& slot = slots[current];
+    if (slot.empty()) {
+        std::ifstream file(slotPath(current).c_str(), std::ios::binary);
+        if (!file) {
+            std::cout << gameName << ": slot " << current + 1 << " is empty" << std::endl;
+            return;
+        }
+        slot.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    Uint64 start = SDL_GetPerformanceCounter();
+    bool loaded = target.loadState(slot.data(), slot.size());
+    double micros = microsSince(start);
+    if (!loaded) {
+        std::cerr << gameName << ": slot " << current + 1 << " is not a save state for this version" << std::endl;
+        return;
+    }
+    logEvent(game, EVENT_STATE_LOADED, current + 1, static_cast<int32_t>(slot.size()));
+    std::cout << gameName << ": loaded slot " << current + 1 << " in " << micros << " us" << std::endl;
+}
+
+void benchmarkSaveState(const char* gameName, Snapshotable& game, int iterations) {
+    if (iterations < 1) iterations = 1;
+    std::vector<unsigned char> blob;
+    game.saveState(blob); // Sizes the buffer so the timed saves do not allocate
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < iterations; ++i) game.saveState(blob);
+    double saveMicros = microsSince(start) / iterations;
+
+    bool ok = true;
+    start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < iterations; ++i) ok &= game.loadState(blob.data(), blob.size());
+    double loadMicros = microsSince(start) / iterations;
+
+    std::vector<unsigned char> again;
+    game.saveState(again);
+    bool roundTrip = ok && again == blob;
+
+    std::cout << gameName << ": " << blob.size() << " bytes, save " << saveMicros << " us, load "
+              << loadMicros << " us" << (roundTrip ? "" : "  ROUND TRIP FAILED") << std::endl;
+}
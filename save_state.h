@@ -0,0 +1,160 @@
+#ifndef SAVE_STATE_H
+#define SAVE_STATE_H
+
+#include <SDL.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "event_log.h"
+
+// Save states are compact binary blobs: a small header naming the game and
+// the layout version, followed by the game's fields in a fixed order.
+// Values are stored in host byte order.
+
+struct SaveStateHeader {
+    char magic[4];        // "ARSV"
+    uint8_t game;         // EventGame
+    uint8_t version;      // Bumped by a game whenever its layout changes
+    uint16_t reserved;
+    uint32_t payloadSize;
+    uint32_t checksum;    // FNV-1a of the payload
+};
+
+#define SAVE_STATE_MAGIC "ARSV"
+
+uint32_t saveStateChecksum(const unsigned char* data, size_t size);
+
+// Appends a game's fields to a blob. The vector is reused, so saving into
+// the same one again does not allocate.
+class StateWriter {
+public:
+    StateWriter(std::vector<unsigned char>& out, EventGame game, uint8_t version) : out(out) {
+        out.resize(sizeof(SaveStateHeader));
+        SaveStateHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SAVE_STATE_MAGIC, 4);
+        header.game = game;
+        header.version = version;
+        memcpy(out.data(), &header, sizeof(header));
+    }
+
+    template <typename T>
+    void put(const T& value) { putBytes(&value, sizeof(T)); }
+
+    void putBytes(const void* data, size_t size) {
+        size_t at = out.size();
+        out.resize(at + size);
+        if (size) memcpy(&out[at], data, size);
+    }
+
+    // Fills in the payload size and checksum
+    void finish() {
+        SaveStateHeader header;
+        memcpy(&header, out.data(), sizeof(header));
+        header.payloadSize = static_cast<uint32_t>(out.size() - sizeof(header));
+        header.checksum = saveStateChecksum(out.data() + sizeof(header), header.payloadSize);
+        memcpy(out.data(), &header, sizeof(header));
+    }
+
+private:
+    std::vector<unsigned char>& out;
+};
+
+// Reads the fields back. Every read is bounds checked; after the first
+// failure ok() is false and all further reads fail, so a loader can read
+// everything and check once before applying any of it.
+class StateReader {
+public:
+    StateReader(const unsigned char* data, size_t size, EventGame game, uint8_t version)
+        : data(data), size(size), position(sizeof(SaveStateHeader)), valid(false) {
+        if (size < sizeof(SaveStateHeader)) return;
+        SaveStateHeader header;
+        memcpy(&header, data, sizeof(header));
+        valid = memcmp(header.magic, SAVE_STATE_MAGIC, 4) == 0 && header.game == game &&
+                header.version == version && header.payloadSize == size - sizeof(header) &&
+                header.checksum == saveStateChecksum(data + sizeof(header), header.payloadSize);
+    }
+
+    template <typename T>
+    bool get(T& value) { return getBytes(&value, sizeof(T)); }
+
+    bool getBytes(void* out, size_t count) {
+        const unsigned char* bytes = take(count);
+        if (bytes && count) memcpy(out, bytes, count);
+        return bytes != nullptr;
+    }
+
+    // Points at the next count bytes without copying them
+    const unsigned char* take(size_t count) {
+        if (!valid || count > size - position) {
+            valid = false;
+            return nullptr;
+        }
+        const unsigned char* bytes = data + position;
+        position += count;
+        return bytes;
+    }
+
+    bool ok() const { return valid; }
+    // True when everything was read and nothing is left over
+    bool done() const { return valid && position == size; }
+
+private:
+    const unsigned char* data;
+    size_t size;
+    size_t position;
+    bool valid;
+};
+
+// Implemented by every game that can be snapshotted
+class Snapshotable {
+public:
+    virtual ~Snapshotable() {}
+    virtual void saveState(std::vector<unsigned char>& out) const = 0;
+    // Either restores the whole state or leaves the game untouched
+    virtual bool loadState(const unsigned char* data, size_t size) = 0;
+};
+
+// Quick save slots for a game: F1-F4 pick a slot, F5 saves into it and F9
+// restores it. Slots are kept in memory and also written to
+// saves/<game>-<slot>.sav so they survive a restart. The files are written
+// by a thread of their own, started by the first save, so saving never
+// waits for the disk.
+class QuickSaveSlots {
+public:
+    static const int SLOT_COUNT = 4;
+
+    QuickSaveSlots(const char* gameName, EventGame game, Snapshotable& target);
+    ~QuickSaveSlots(); // Writes any saves still waiting
+
+    // Returns true if the key was one of the save state keys
+    bool handleKey(SDL_Keycode key);
+
+private:
+    void save();
+    void load();
+    std::string slotPath(int slot) const;
+    static int writerMain(void* data);
+
+    std::string gameName;
+    EventGame game;
+    Snapshotable& target;
+    int current;
+    std::vector<unsigned char> slots[SLOT_COUNT];
+
+    // Saves waiting for the writer, newest only, all guarded by fileLock.
+    // The lock is only held to copy a slot in or swap it out.
+    SDL_mutex* fileLock;
+    SDL_cond* fileQueued;
+    SDL_Thread* writer;
+    bool stopRequested;
+    bool pending[SLOT_COUNT];
+    std::vector<unsigned char> pendingBytes[SLOT_COUNT];
+};
+
+// Times repeated saves and loads of the game's current state and prints
+// the blob size and the average cost of each
+void benchmarkSaveState(const char* gameName, Snapshotable& game, int iterations);
+
+#endif
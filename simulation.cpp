@@ -0,0 +1,250 @@
+#include "simulation.h"
+#include "flight_recorder.h"
+#include "frame_pipeline.h"
+#include "metrics.h"
+#include "spsc_ring.h"
+#include "triple_buffer.h"
+#include "video_capture.h"
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const Uint64 SPIN_MICROS = 2000;     // Sleep until this close to a tick, then yield
+
+struct KeyboardState {
+    Uint8 keys[SDL_NUM_SCANCODES];
+};
+
+// Shared by the two threads for one run
+struct SimulationRun {
+    Simulation& game;
+    TripleBuffer<RenderSnapshot> frames;      // Simulation -> main
+    TripleBuffer<KeyboardState> keyboard;     // Main -> simulation
+    SpscRing<SDL_KeyboardEvent, 64> keyPresses;
+    std::atomic<bool> stopRequested;
+    std::atomic<bool> finished;
+
+    // Simulation thread only; read after it has been joined
+    Uint64 ticks;
+    Uint64 slippedTicks;
+    double tickMicros, peakTickMicros;
+    double lateMicros, peakLateMicros;
+    double seconds;
+    AllocationCount allocations;
+    Uint64 allocatingTicks;
+
+    explicit SimulationRun(Simulation& game)
+        : game(game), stopRequested(false), finished(false), ticks(0), slippedTicks(0),
+          tickMicros(0), peakTickMicros(0), lateMicros(0), peakLateMicros(0), seconds(0), allocatingTicks(0) {
+        allocations.count = allocations.bytes = 0;
+    }
+};
+
+double toMicros(Uint64 counts) {
+    return static_cast<double>(counts) * 1e6 / SDL_GetPerformanceFrequency();
+}
+
+Uint64 fromMicros(Uint64 micros) {
+    return micros * SDL_GetPerformanceFrequency() / 1000000;
+}
+
+AllocationCount allocationsSince(const AllocationCount& before) {
+    AllocationCount now = allocationsSoFar();
+    now.count -= before.count;
+    now.bytes -= before.bytes;
+    return now;
+}
+
+// Seven-segment digits, so the overlay needs neither a font nor memory
+void addNumber(RectList& out, int x, int y, Uint64 value, SDL_Color color) {
+    static const Uint8 SEGMENTS[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+    const int W = 8, H = 14, T = 2, ADVANCE = 12;
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = static_cast<char>(value % 10);
+        value /= 10;
+    } while (value);
+    for (int i = n - 1; i >= 0; --i, x += ADVANCE) {
+        // Top, upper right, lower right, bottom, lower left, upper left, middle
+        const SDL_Rect parts[7] = {{x, y, W, T}, {x + W - T, y, T, H / 2}, {x + W - T, y + H / 2, T, H / 2},
+                                   {x, y + H - T, W, T}, {x, y + H / 2, T, H / 2}, {x, y, T, H / 2},
+                                   {x, y + (H - T) / 2, W, T}};
+        for (int k = 0; k < 7; ++k) {
+            if (SEGMENTS[static_cast<int>(digits[i])] & (1 << k)) out.add(parts[k], color);
+        }
+    }
+}
+
+// F11: allocations and bytes of the last tick in green and of this
+// thread's last frame in yellow, top left
+void drawAllocationOverlay(SDL_Renderer* renderer, RectList& overlay, const AllocationCount& tick,
+                           const AllocationCount& frame) {
+    const SDL_Color black = {0, 0, 0, 255}, green = {0, 255, 0, 255}, yellow = {255, 255, 0, 255};
+    const SDL_Rect backing = {4, 4, 300, 46};
+    overlay.clear();
+    overlay.add(backing, black);
+    addNumber(overlay, 10, 10, tick.count, green);
+    addNumber(overlay, 110, 10, tick.bytes, green);
+    addNumber(overlay, 10, 30, frame.count, yellow);
+    addNumber(overlay, 110, 30, frame.bytes, yellow);
+    overlay.draw(renderer);
+}
+
+// Ticks on the game's TickSchedule
+int simulationMain(void* data) {
+    SimulationRun& run = *static_cast<SimulationRun*>(data);
+    static const KeyboardState noKeys = {};
+    const Uint8* keystate = noKeys.keys;
+    Uint64 begin = SDL_GetPerformanceCounter();
+    TickSchedule schedule;
+    schedule.start(begin);
+
+    while (!run.stopRequested.load(std::memory_order_acquire)) {
+        heartbeat(LOOP_SIMULATION);
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (!schedule.isDue(now)) {
+            waitUntil(schedule.nextDue(), now);
+            continue;
+        }
+
+        double late = toMicros(now - schedule.nextDue());
+        run.lateMicros += late;
+        if (late > run.peakLateMicros) run.peakLateMicros = late;
+        Uint64 skipped = schedule.take(now, fromMicros(run.game.tickMicros()));
+        if (skipped) {
+            run.slippedTicks += skipped;
+            metrics().skippedTicks.fetch_add(skipped, std::memory_order_relaxed);
+        }
+
+        AllocationCount before = allocationsSoFar();
+        if (run.keyboard.update()) keystate = run.keyboard.readBuffer().keys;
+        SDL_KeyboardEvent key;
+        while (run.keyPresses.pop(key)) run.game.keyPressed(key);
+        run.game.tick(keystate);
+        RenderSnapshot& frame = run.frames.writeBuffer();
+        run.game.snapshot(frame);
+        frame.tick = ++run.ticks;
+        frame.allocations = allocationsSince(before);
+        run.frames.publish();
+        run.allocations.count += frame.allocations.count;
+        run.allocations.bytes += frame.allocations.bytes;
+        if (frame.allocations.count) run.allocatingTicks++;
+
+        recordPhase(PHASE_TICK, now);
+        double micros = toMicros(SDL_GetPerformanceCounter() - now);
+        metrics().ticks.fetch_add(1, std::memory_order_relaxed);
+        metrics().tickTime.observe(static_cast<Uint64>(micros));
+        run.tickMicros += micros;
+        if (micros > run.peakTickMicros) run.peakTickMicros = micros;
+        if (run.game.finished()) break;
+    }
+    heartbeatIdle(LOOP_SIMULATION);
+    run.seconds = toMicros(SDL_GetPerformanceCounter() - begin) / 1e6;
+    run.finished.store(true, std::memory_order_release);
+    return 0;
+}
+
+} // namespace
+
+void waitUntil(Uint64 due, Uint64 now) {
+    if (now >= due) return;
+    Uint64 waitMicros = static_cast<Uint64>(toMicros(due - now));
+    if (waitMicros > SPIN_MICROS) {
+        SDL_Delay(static_cast<Uint32>((waitMicros - SPIN_MICROS) / 1000) + 1);
+    } else {
+        SDL_Delay(0);
+    }
+}
+
+bool runSimulation(const char* gameName, Simulation& game, SDL_Renderer* renderer) {
+    SimulationRun run(game);
+    SDL_Thread* thread = SDL_CreateThread(simulationMain, "Simulation", &run);
+    if (!thread) {
+        std::cerr << "Cannot start the " << gameName << " simulation thread: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    SnapshotPainter painter(renderer);
+    RectList overlay;
+    bool showAllocations = false;
+    AllocationCount frameStart = allocationsSoFar(), lastFrame = {0, 0}, presentAllocations = {0, 0};
+    bool closed = false;
+    Uint64 frames = 0, unseenTicks = 0, lastTick = 0, droppedKeys = 0;
+    double frameMicros = 0, peakFrameMicros = 0;
+    while (!closed && !run.finished.load(std::memory_order_acquire)) {
+        heartbeat(LOOP_MAIN);
+        Uint64 phaseStart = SDL_GetPerformanceCounter();
+        SDL_Event e;
+        while (SDL_PollEvent(&e)) {
+            recordInput(e);
+            if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_CLOSE) {
+                closed = true;
+            } else if (e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET) {
+                painter.invalidate();
+            } else if (e.type == SDL_KEYDOWN) {
+                if (e.key.repeat == 0 && handleCaptureKey(e.key.keysym.sym, gameName, renderer)) continue;
+                if (e.key.repeat == 0 && e.key.keysym.sym == SDLK_F11) {
+                    showAllocations = !showAllocations;
+                    continue;
+                }
+                if (!run.keyPresses.push(e.key)) droppedKeys++;
+            }
+        }
+        const Uint8* keystate = SDL_GetKeyboardState(NULL);
+        if (keystate) memcpy(run.keyboard.writeBuffer().keys, keystate, sizeof(KeyboardState));
+        run.keyboard.publish();
+
+        // Nothing new to show: wait for the next tick rather than present
+        // the same picture again
+        if (!run.frames.update()) {
+            SDL_Delay(1);
+            continue;
+        }
+        recordPhase(PHASE_EVENTS, phaseStart); // Only for frames that are drawn, to keep the ring for them
+        Uint64 start = SDL_GetPerformanceCounter();
+        const RenderSnapshot& frame = run.frames.readBuffer();
+        unseenTicks += frame.tick - lastTick - 1;
+        metrics().droppedFrames.fetch_add(frame.tick - lastTick - 1, std::memory_order_relaxed);
+        lastTick = frame.tick;
+        painter.draw(frame);
+        if (showAllocations) drawAllocationOverlay(renderer, overlay, frame.allocations, lastFrame);
+        recordPhase(PHASE_DRAW, start);
+        phaseStart = SDL_GetPerformanceCounter();
+        presentFrame(renderer);
+        recordPhase(PHASE_PRESENT, phaseStart);
+        // Everything since the last present, waits for ticks included
+        lastFrame = allocationsSince(frameStart);
+        presentAllocations.count += lastFrame.count;
+        presentAllocations.bytes += lastFrame.bytes;
+        frameStart = allocationsSoFar();
+        double micros = toMicros(SDL_GetPerformanceCounter() - start);
+        frameMicros += micros;
+        if (micros > peakFrameMicros) peakFrameMicros = micros;
+        frames++;
+    }
+    run.stopRequested.store(true, std::memory_order_release);
+    SDL_WaitThread(thread, nullptr);
+    heartbeatIdle(LOOP_MAIN); // Game over screens and the menu's wait follow
+
+    std::cout << gameName << " simulation: " << run.ticks << " ticks";
+    if (run.ticks) {
+        std::cout << " at " << run.ticks / run.seconds << " per second, "
+                  << run.tickMicros / run.ticks << " us average, " << run.peakTickMicros << " us peak, started "
+                  << run.lateMicros / run.ticks << " us late on average, " << run.peakLateMicros << " us at worst, "
+                  << run.slippedTicks << " ticks skipped, " << run.allocations.count << " allocations ("
+                  << run.allocations.bytes << " bytes) in " << run.allocatingTicks << " ticks";
+    }
+    std::cout << std::endl;
+    std::cout << gameName << " presentation: " << frames << " frames";
+    if (frames) {
+        std::cout << ", draw and present " << frameMicros / frames << " us average, " << peakFrameMicros
+                  << " us peak, " << unseenTicks << " ticks never shown, " << presentAllocations.count
+                  << " allocations (" << presentAllocations.bytes << " bytes)";
+    }
+    if (droppedKeys) std::cout << ", " << droppedKeys << " key presses dropped";
+    std::cout << std::endl;
+    return !closed;
+}
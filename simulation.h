@@ -0,0 +1,71 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <SDL.h>
+#include "render_snapshot.h"
+
+// A game whose simulation can run on a thread of its own. Everything here
+// is called on the simulation thread; the game only talks to the main
+// thread through the snapshots it fills in.
+class Simulation {
+public:
+    virtual ~Simulation() {}
+
+    // Time from one tick to the next; may change as the game goes on
+    virtual Uint32 tickMicros() const = 0;
+
+    // A key went down on the main thread, repeats included. F10 and F11
+    // never arrive here: video capture and the allocation overlay stay with
+    // the renderer.
+    virtual void keyPressed(const SDL_KeyboardEvent& key) { (void)key; }
+
+    // One step, with the keyboard as the main thread last saw it
+    virtual void tick(const Uint8* keystate) = 0;
+
+    // What to draw after the last tick
+    virtual void snapshot(RenderSnapshot& out) = 0;
+
+    virtual bool finished() const = 0;
+};
+
+// Fixed-step deadlines for one game's ticks, in performance counter units.
+// A tick that starts late is followed straight away by the next one so game
+// time keeps up with real time; only when it falls more than
+// MAX_CATCH_UP_TICKS behind does the schedule give up and restart from now.
+class TickSchedule {
+public:
+    static const int MAX_CATCH_UP_TICKS = 4;
+
+    TickSchedule() : due(0) {}
+
+    void start(Uint64 now) { due = now; }
+    Uint64 nextDue() const { return due; }
+    bool isDue(Uint64 now) const { return now >= due; }
+
+    // Takes the tick that is due at or before now and moves the deadline on
+    // by period. Returns the ticks given up on, if the schedule restarted.
+    Uint64 take(Uint64 now, Uint64 period) {
+        Uint64 skipped = 0;
+        if (now - due > period * MAX_CATCH_UP_TICKS) {
+            skipped = (now - due) / period;
+            due = now;
+        }
+        due += period;
+        return skipped;
+    }
+
+private:
+    Uint64 due;
+};
+
+// Runs the game's ticks on a new thread at its own cadence while this
+// thread handles events and draws the newest snapshot, so a slow present
+// or vsync wait never holds the simulation back. Prints the timings and
+// allocations of both threads at the end. Returns false if the window was closed.
+bool runSimulation(const char* gameName, Simulation& game, SDL_Renderer* renderer);
+
+// Sleeps most of the way to a deadline and yields for the rest, so a tick
+// loop wakes close to it without spinning. Returns early; check and call again.
+void waitUntil(Uint64 due, Uint64 now);
+
+#endif
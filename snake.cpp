@@ -1,35 +1,87 @@
 #include "snake.h"
 #include <iostream>
-#include <list>
 #include <SDL.h>
 #include <cstdlib> // For rand() and srand()
 #include <ctime>   // For time()
+#include <cstring>
 #include <SDL_ttf.h>
+#include "event_log.h"
+#include "leaderboard.h"
+#include "save_state.h"
+#include "rewind_buffer.h"
+#include "video_capture.h"
+#include "simulation.h"
+#include "rng.h"
+#include "game_module.h"
+#include <vector>
+#include <algorithm>
 
 enum class Direction { UP, DOWN, LEFT, RIGHT };
 
-class Node { //linked list implementation of snake game
+class Node { // One cell of the snake's body
 public:
     Node(int x, int y) : x(x), y(y) {}
     int x, y;
 };
 
+// The body from the head, in a ring sized for the whole field up front so
+// moving and growing never allocate. Pushing onto a full ring does nothing.
+class NodeRing {
+public:
+    explicit NodeRing(int capacity) : nodes(capacity, Node(0, 0)), first(0), count(0) {}
+
+    int size() const { return count; }
+    int capacity() const { return static_cast<int>(nodes.size()); }
+    const Node& operator[](int i) const { return nodes[(first + i) % nodes.size()]; }
+    const Node& front() const { return (*this)[0]; }
+    const Node& back() const { return (*this)[count - 1]; }
+
+    void clear() { first = count = 0; }
+
+    void push_front(const Node& node) {
+        if (count == capacity()) return;
+        first = (first + capacity() - 1) % capacity();
+        nodes[first] = node;
+        count++;
+    }
+
+    void push_back(const Node& node) {
+        if (count == capacity()) return;
+        nodes[(first + count) % nodes.size()] = node;
+        count++;
+    }
+
+    void pop_back() {
+        if (count > 0) count--;
+    }
+
+private:
+    std::vector<Node> nodes;
+    int first;
+    int count;
+};
+
 class Apple {
 public:
-    Apple(int grid_size) : grid_size(grid_size), x(0), y(0) {
+    Apple(int grid_size, Rng& rng) : grid_size(grid_size), x(0), y(0), rng(rng) {
         // Initialize apple in a random position
         randomizePosition();
     }
 
-    void render(SDL_Renderer* renderer) {
-        SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255); // Red color for the apple
+    void snapshot(RenderSnapshot& out) const {
+        const SDL_Color red = {255, 0, 0, 255}; // Red color for the apple
         SDL_Rect rect = {x * grid_size, y * grid_size, grid_size, grid_size};
-        SDL_RenderFillRect(renderer, &rect);
+        out.shapes.add(rect, red);
     }
 
     void randomizePosition() {
-        x = rand() % (1000 / grid_size); // Assuming screen width is 1000
-        y = rand() % (800 / grid_size);  // Assuming screen height is 800
+        x = rng.below(1000 / grid_size); // Assuming screen width is 1000
+        y = rng.below(800 / grid_size);  // Assuming screen height is 800
+    }
+
+    void setPosition(int newX, int newY) {
+        x = newX;
+        y = newY;
     }
 
     int getX() const { return x; }
@@ -38,6 +90,7 @@ public:
 private:
     int grid_size;
     int x, y;
+    Rng& rng;
 };
 
 class Score {
@@ -70,7 +123,15 @@ private:
 
 class Snake {
 public:
-    Snake(int grid_size) : grid_size(grid_size), dir(Direction::RIGHT) {
+    // Room for a body covering the field, and the two cells grow() adds
+    Snake(int grid_size)
+        : segments((1000 / grid_size) * (800 / grid_size) + 2), dir(Direction::RIGHT), grid_size(grid_size) {
+        reset();
+    }
+
+    void reset() {
+        dir = Direction::RIGHT;
+        segments.clear();
         // Start with three segments
         // Head segment
         segments.push_back(Node(5, 5)); // Initial head position (5, 5)
@@ -94,8 +155,8 @@ public:
 
     bool checkSelfCollision() {
         const Node& head = segments.front();
-        for (auto it = std::next(segments.begin(), 2); it != segments.end(); ++it) {
-            if (head.x == it->x && head.y == it->y) {
+        for (int i = 2; i < segments.size(); ++i) {
+            if (head.x == segments[i].x && head.y == segments[i].y) {
                 return true;
             }
         }
@@ -104,7 +165,7 @@ public:
 
     void update() {
         // Get current head position
-        Node& head = segments.front();
+        const Node& head = segments.front();
 
         // Calculate new head position based on direction
         int new_x = head.x;
@@ -116,9 +177,10 @@ public:
             case Direction::RIGHT: new_x++; break;
         }
 
-        // Move head to the front of the list
+        // Drop the last segment, then move the head to the front. Popping
+        // first leaves room in a full ring.
+        segments.pop_back();
         segments.push_front(Node(new_x, new_y));
-        segments.pop_back(); // Remove last segment to simulate movement
         int max_x = 1000 / grid_size; // Total cells horizontally
         int max_y = 800 / grid_size; // Total cells vertically
 
@@ -127,25 +189,26 @@ public:
         if (new_y < 0) new_y = max_y - 1;
         if (new_y >= max_y) new_y = 0;
 
-        // Move head to the front of the list
-        segments.push_front(Node(new_x, new_y));
         segments.pop_back();
+        segments.push_front(Node(new_x, new_y));
     }
 
-    void render(SDL_Renderer* renderer) {
-        SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255); // Green color for the snake
+    void snapshot(RenderSnapshot& out) const {
+        const SDL_Color green = {0, 255, 0, 255}; // Green color for the snake
 
-        for (const auto& segment : segments) {
+        out.shapes.reserve(segments.capacity() + 1); // Body and apple, once
+        for (int i = 0; i < segments.size(); ++i) {
+            const Node& segment = segments[i];
             SDL_Rect rect = { segment.x * grid_size, segment.y * grid_size, grid_size, grid_size };
-            SDL_RenderFillRect(renderer, &rect);
+            out.shapes.add(rect, green);
         }
     }
 
         void grow() {
         // Add two segments at the tail's position
-        const Node& tail = segments.back();
-        segments.push_back(Node(tail.x, tail.y));
-        segments.push_back(Node(tail.x, tail.y));
+        Node tail = segments.back();
+        segments.push_back(tail);
+        segments.push_back(tail);
     }
 
     // Check if the snake's head has collided with the apple
@@ -154,51 +217,212 @@ public:
         return head.x == apple.getX() && head.y == apple.getY();
     }
 
+    // Whether a body segment other than the tail, which moves on, is on the cell
+    bool bodyAt(int x, int y) const {
+        for (int i = 0; i < segments.size() - 1; ++i) {
+            if (segments[i].x == x && segments[i].y == y) return true;
+        }
+        return false;
+    }
+
+    const NodeRing& getSegments() const { return segments; }
+    Direction getDirection() const { return dir; }
+
+    void restore(const std::vector<Node>& newSegments, Direction newDir) {
+        segments.clear();
+        for (const Node& node : newSegments) segments.push_back(node);
+        dir = newDir;
+    }
+
 private:
-    std::list<Node> segments;
+    NodeRing segments;
     Direction dir;
     int grid_size; // Size of each grid cell
 };
 
-class SnakeGame {
+class SnakeGame : public Snapshotable, public Simulation, public GameEnv {
 public:
-    SnakeGame() : snake(20), apple(20), snakeSpeed(100), score(0), isRunning(true), window(nullptr), renderer(nullptr) {
+    static const Uint8 STATE_VERSION = 1;
+    static const int ENV_ACTIONS = 5;
+    static const int ENV_STATE_SIZE = 12;
+
+    // A quiet game logs nothing, for training copies
+    SnakeGame(bool headless = false, bool quiet = false)
+        : rng(static_cast<Uint32>(time(nullptr))), snake(20), apple(20, rng), snakeSpeed(100), score(0), isRunning(true),
+          quiet(quiet), window(nullptr), renderer(nullptr), quickSaves("snake", GAME_SNAKE, *this), rewind("snake", *this) {
+        if (headless) return;
         SDL_Init(SDL_INIT_VIDEO);
         window = SDL_CreateWindow("Snake Game", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1000, 800, 0);
         renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-        srand(static_cast<unsigned int>(time(nullptr))); // Seed the random number generator
     }
 
     ~SnakeGame() {
+        if (!window) return; // Headless
         SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
-        SDL_Quit();
+        SDL_QuitSubSystem(SDL_INIT_VIDEO);
     }
 
     void run() {
-        
-        while (isRunning) {
-            handleEvents();
-            if (!isRunning) break;
+        logEvent(GAME_SNAKE, EVENT_GAME_START);
+        if (!runSimulation("snake", *this, renderer)) {
+            isRunning = false;
+            logEvent(GAME_SNAKE, EVENT_QUIT);
+        }
+        rewind.printStats();
+        videoCapture().stop();
+        recordScore("snake", score.getValue());
+    }
+
+    // Score, speed, RNG, apple, direction, then the body from the head
+    void saveState(std::vector<unsigned char>& out) const {
+        StateWriter writer(out, GAME_SNAKE, STATE_VERSION);
+        writer.put<Sint32>(score.getValue());
+        writer.put<Sint32>(snakeSpeed);
+        writer.put<Uint32>(rng.getState());
+        writer.put<Sint16>(static_cast<Sint16>(apple.getX()));
+        writer.put<Sint16>(static_cast<Sint16>(apple.getY()));
+        writer.put<Uint8>(static_cast<Uint8>(snake.getDirection()));
+        const NodeRing& segments = snake.getSegments();
+        writer.put<Uint32>(static_cast<Uint32>(segments.size()));
+        for (int i = 0; i < segments.size(); ++i) {
+            const Node& node = segments[i];
+            writer.put<Sint16>(static_cast<Sint16>(node.x));
+            writer.put<Sint16>(static_cast<Sint16>(node.y));
+        }
+        writer.finish();
+    }
+
+    bool loadState(const unsigned char* data, size_t size) {
+        StateReader reader(data, size, GAME_SNAKE, STATE_VERSION);
+        Sint32 savedScore, savedSpeed;
+        Uint32 rngState, count = 0;
+        Sint16 appleX, appleY;
+        Uint8 direction;
+        reader.get(savedScore);
+        reader.get(savedSpeed);
+        reader.get(rngState);
+        reader.get(appleX);
+        reader.get(appleY);
+        reader.get(direction);
+        reader.get(count);
+        if (!reader.ok() || count == 0 || count > static_cast<Uint32>(snake.getSegments().capacity()) || direction > static_cast<Uint8>(Direction::RIGHT)) return false;
+        // The move delay only ever steps down from 100 ms to 10 ms, and every
+        // cell has to be on the 50x40 grid
+        const int columns = 1000 / 20, rows = 800 / 20;
+        if (savedSpeed < 10 || savedSpeed > 100) return false;
+        if (appleX < 0 || appleX >= columns || appleY < 0 || appleY >= rows) return false;
+        const unsigned char* body = reader.take(count * 2 * sizeof(Sint16));
+        if (!reader.done()) return false;
+
+        loadSegments.clear();
+        for (Uint32 i = 0; i < count; ++i) {
+            Sint16 xy[2];
+            memcpy(xy, body + i * sizeof(xy), sizeof(xy));
+            if (xy[0] < 0 || xy[0] >= columns || xy[1] < 0 || xy[1] >= rows) return false;
+            loadSegments.push_back(Node(xy[0], xy[1]));
+        }
+        snake.restore(loadSegments, static_cast<Direction>(direction));
+        apple.setPosition(appleX, appleY);
+        rng.setState(rngState);
+        score = Score(savedScore);
+        snakeSpeed = savedSpeed;
+        return true;
+    }
+
+    // Plays a while without a window, then times saving and loading
+    void benchSaveState(int iterations) {
+        rng.seed(1);
+        apple.randomizePosition();
+        for (int i = 0; i < 500 && isRunning; ++i) {
+            if (i % 40 == 20) snake.changeDirection(i % 80 == 20 ? Direction::DOWN : Direction::RIGHT);
+            if (i % 40 == 0) snake.grow();
             update();
-            render();
-            SDL_Delay(snakeSpeed); // Delay in milliseconds, controlling snake speed
         }
+        benchmarkSaveState("snake", *this, iterations);
+
+        // 3600 moves of laps around a square, growing now and then
+        int tick = 0;
+        benchmarkRewind("snake", *this, [this, &tick]() -> Uint32 {
+            static const Direction turns[4] = {Direction::DOWN, Direction::LEFT, Direction::UP, Direction::RIGHT};
+            if (++tick % 15 == 0) snake.changeDirection(turns[(tick / 15) % 4]);
+            if (tick % 200 == 0) snake.grow();
+            update();
+            return tickMicros();
+        }, 60 * RewindControl::SAMPLES_PER_SECOND);
     }
 
-private:
-    void handleEvents() {
-        SDL_Event e;
-        while (SDL_PollEvent(&e)) {
-            if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_CLOSE) {
-                isRunning = false;
-                std::cout << "SDL_QUIT event captured. Exiting game loop." << std::endl;
-            } else if (e.type == SDL_KEYDOWN) {
-                handleKeyPress(e.key.keysym.sym);
-            }
+    // The simulation thread's side, see runSimulation()
+    Uint32 tickMicros() const { return snakeSpeed * 1000; } // Snake speed: the delay between moves
+
+    void keyPressed(const SDL_KeyboardEvent& key) {
+        if (key.repeat == 0 && quickSaves.handleKey(key.keysym.sym)) return;
+        handleKeyPress(key.keysym.sym);
+    }
+
+    void recordRewind(bool on) { rewind.setEnabled(on); }
+
+    void tick(const Uint8* keystate) {
+        if (!rewind.rewinding(keystate)) {
+            update();
+            rewind.recordTick(tickMicros());
         }
     }
 
+    void snapshot(RenderSnapshot& out) {
+        const SDL_Color black = {0, 0, 0, 255}; // Black background
+        out.clear(black);
+        snake.snapshot(out);
+        apple.snapshot(out);
+    }
+
+    bool finished() const { return !isRunning; }
+
+    // Training side, see game_env.h. Actions: 0 carry on, 1 up, 2 down,
+    // 3 left, 4 right; a step is one move.
+    void reset(Uint32 seed) {
+        rng.seed(seed);
+        snake.reset();
+        apple.randomizePosition();
+        snakeSpeed = 100;
+        score = Score(0);
+        isRunning = true;
+    }
+
+    float step(int action) {
+        static const Direction turns[4] = {Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT};
+        if (action >= 1 && action <= 4) snake.changeDirection(turns[action - 1]);
+        int before = score.getValue();
+        update();
+        return static_cast<float>(score.getValue() - before);
+    }
+
+    bool done() const { return !isRunning; }
+
+    // Head and apple cells, the heading, whether the body is on the cell
+    // ahead, to the left and to the right, and the length
+    void observe(float* state) const {
+        const int columns = 1000 / 20, rows = 800 / 20;
+        const Node& head = snake.getSegments().front();
+        Direction dir = snake.getDirection();
+        int dx = dir == Direction::LEFT ? -1 : dir == Direction::RIGHT ? 1 : 0;
+        int dy = dir == Direction::UP ? -1 : dir == Direction::DOWN ? 1 : 0;
+        const int around[3][2] = {{dx, dy}, {dy, -dx}, {-dy, dx}};
+        state[0] = static_cast<float>(head.x) / columns;
+        state[1] = static_cast<float>(head.y) / rows;
+        state[2] = static_cast<float>(apple.getX()) / columns;
+        state[3] = static_cast<float>(apple.getY()) / rows;
+        for (int d = 0; d < 4; ++d) state[4 + d] = static_cast<int>(dir) == d ? 1.0f : 0.0f;
+        for (int k = 0; k < 3; ++k) {
+            int x = (head.x + around[k][0] + columns) % columns;
+            int y = (head.y + around[k][1] + rows) % rows;
+            state[8 + k] = snake.bodyAt(x, y) ? 1.0f : 0.0f;
+        }
+        state[11] = static_cast<float>(snake.getSegments().size()) / (columns * rows);
+    }
+
+private:
+
     void handleKeyPress(SDL_Keycode key) {
         switch (key) {
             case SDLK_w: snake.changeDirection(Direction::UP); break;
@@ -216,11 +440,12 @@ private:
             apple.randomizePosition();
             increaseSpeed();
             score = score + 10; // Use the overloaded operator to add score
-            std::cout << "Score: " << score.getValue() << std::endl;
+            if (!quiet) logEvent(GAME_SNAKE, EVENT_SCORE, score.getValue(), 10);
         }
 
         if (snake.checkSelfCollision()) {
             isRunning = false; // Game over on self-collision
+            if (!quiet) logEvent(GAME_SNAKE, EVENT_GAME_OVER, score.getValue());
         }
     }
 
@@ -233,23 +458,18 @@ private:
         }
     }
 
-    void render() {
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); // Black background
-        SDL_RenderClear(renderer);
-
-        snake.render(renderer);
-        apple.render(renderer);
-
-        SDL_RenderPresent(renderer);
-    }
-
+    Rng rng;     // Apple placement; declared first so the apple can use it
     Snake snake;
     Apple apple;
     int snakeSpeed;
     Score score; // Score attribute
     bool isRunning;
+    bool quiet;
     SDL_Window* window;
     SDL_Renderer* renderer;
+    QuickSaveSlots quickSaves;
+    RewindControl rewind;
+    std::vector<Node> loadSegments; // Reused between loads
 };
 
 void runSnakeGame(){
@@ -257,5 +477,69 @@ void runSnakeGame(){
     game.run();
 }
 
+void benchSnakeSaveState(int iterations) {
+    SnakeGame game(true);
+    game.benchSaveState(iterations);
+}
+
+static GameEnv* createSnakeEnv() {
+    return new SnakeGame(true, true);
+}
+
+static Simulation* createSnakeSimulation(bool rewind) {
+    SnakeGame* game = new SnakeGame(true, true);
+    game->recordRewind(rewind);
+    return game;
+}
+
+// Attract mode: of going on, turning left and turning right, the free move
+// that ends nearest the apple. It only looks one cell ahead, so it still
+// traps itself in the end.
+static int autoplaySnake(const float* state) {
+    const int columns = 1000 / 20, rows = 800 / 20;
+    int headX = static_cast<int>(state[0] * columns + 0.5f), headY = static_cast<int>(state[1] * rows + 0.5f);
+    int appleX = static_cast<int>(state[2] * columns + 0.5f), appleY = static_cast<int>(state[3] * rows + 0.5f);
+    int heading = 0;
+    for (int d = 0; d < 4; ++d) {
+        if (state[4 + d] > 0.5f) heading = d;
+    }
+    static const int steps[4][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}}; // As Direction
+    int dx = steps[heading][0], dy = steps[heading][1];
+    const int moves[3][2] = {{dx, dy}, {dy, -dx}, {-dy, dx}}; // As observe()'s cells
+    int best = -1, bestDistance = 0;
+    for (int k = 0; k < 3; ++k) {
+        if (state[8 + k] > 0.5f) continue;
+        int x = (headX + moves[k][0] + columns) % columns, y = (headY + moves[k][1] + rows) % rows;
+        int distX = std::abs(x - appleX), distY = std::abs(y - appleY);
+        int distance = std::min(distX, columns - distX) + std::min(distY, rows - distY); // The screen wraps
+        if (best < 0 || distance < bestDistance) {
+            best = k;
+            bestDistance = distance;
+        }
+    }
+    if (best <= 0) return 0;
+    for (int d = 0; d < 4; ++d) {
+        if (steps[d][0] == moves[best][0] && steps[d][1] == moves[best][1]) return d + 1;
+    }
+    return 0;
+}
+
+// Emulator --bench-savestate [iterations]
+static bool runSnakeCommand(int argc, char* argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "--bench-savestate") == 0) {
+        benchSnakeSaveState(argc > 2 ? atoi(argv[2]) : 10000);
+        return true;
+    }
+    return false;
+}
+
+GAME_MODULE_EXPORT const GameModule* arcadeGameModule() {
+    static const GameEnvSpec env = {SnakeGame::ENV_ACTIONS, SnakeGame::ENV_STATE_SIZE, 1000, 800, createSnakeEnv,
+                                     autoplaySnake};
+    static const GameModule module = {GAME_MODULE_API_VERSION, "Snake", "snake", true, runSnakeGame, runSnakeCommand, &env,
+                                      createSnakeSimulation};
+    return &module;
+}
+
 
 
@@ -3,4 +3,7 @@
 
 void runSnakeGame();
 
+// Headless timing of save state and load state
+void benchSnakeSaveState(int iterations);
+
 #endif // TETRIS_H
@@ -0,0 +1,177 @@
+#include "soft_raster.h"
+#include <algorithm>
+#include <iostream>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+bool enabled = false;
+int poolWorkers = 0;
+
+Uint32 packColor(const SDL_Color& c) {
+    return (static_cast<Uint32>(c.a) << 24) | (static_cast<Uint32>(c.r) << 16) |
+           (static_cast<Uint32>(c.g) << 8) | c.b;
+}
+
+void fillSpan(Uint32* pixels, int count, Uint32 color) {
+    int i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128i c = _mm_set1_epi32(static_cast<int>(color));
+    for (; i + 16 <= count; i += 16) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), c);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i + 4), c);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i + 8), c);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i + 12), c);
+    }
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), c);
+    }
+#endif
+    for (; i < count; ++i) pixels[i] = color;
+}
+
+// The layer texture blended onto what is below: src * a + dst * (1 - a)
+void blendSpan(Uint32* pixels, int count, const SDL_Color& c) {
+    Uint32 a = c.a, keep = 255 - a;
+    for (int i = 0; i < count; ++i) {
+        Uint32 dst = pixels[i];
+        Uint32 r = (c.r * a + ((dst >> 16) & 0xff) * keep + 127) / 255;
+        Uint32 g = (c.g * a + ((dst >> 8) & 0xff) * keep + 127) / 255;
+        Uint32 b = (c.b * a + (dst & 0xff) * keep + 127) / 255;
+        pixels[i] = (dst & 0xff000000u) | (r << 16) | (g << 8) | b;
+    }
+}
+
+double microsSince(Uint64 start) {
+    return static_cast<double>(SDL_GetPerformanceCounter() - start) * 1e6 / SDL_GetPerformanceFrequency();
+}
+
+} // namespace
+
+SoftRaster::SoftRaster() : width(0), height(0) {}
+
+void SoftRaster::rasterise(const RenderSnapshot& snapshot, int newWidth, int newHeight, ThreadPool& pool) {
+    if (newWidth <= 0 || newHeight <= 0) return;
+    width = newWidth;
+    height = newHeight;
+    framebuffer.resize(static_cast<size_t>(width) * height);
+    int bands = (height + BAND_ROWS - 1) / BAND_ROWS;
+    pool.run(bands, [this, &snapshot](int band) {
+        int top = band * BAND_ROWS;
+        rasteriseBand(snapshot, top, std::min(top + BAND_ROWS, height));
+    });
+}
+
+// Same order as the SDL path: clear, layer, rects. Every band walks the
+// whole rect list and keeps the rows it owns, so bands never share pixels.
+void SoftRaster::rasteriseBand(const RenderSnapshot& snapshot, int top, int bottom) {
+    Uint32 background = packColor(snapshot.background);
+    for (int y = top; y < bottom; ++y) fillSpan(&framebuffer[static_cast<size_t>(y) * width], width, background);
+    rasteriseList(snapshot.layer, true, top, bottom);
+    rasteriseList(snapshot.shapes, false, top, bottom);
+}
+
+void SoftRaster::rasteriseList(const RectList& list, bool blend, int top, int bottom) {
+    const std::vector<SDL_Rect>& rects = list.getRects();
+    for (const RectBatch& batch : list.getBatches()) {
+        Uint32 color = packColor(batch.color);
+        bool blended = blend && batch.color.a != 255;
+        for (int k = batch.first; k < batch.first + batch.count; ++k) {
+            const SDL_Rect& r = rects[k];
+            if (r.w <= 0 || r.h <= 0) continue;
+            int x0 = std::max(r.x, 0), x1 = std::min(r.x + r.w, width);
+            int y0 = std::max(r.y, top), y1 = std::min(r.y + r.h, bottom);
+            if (x0 >= x1 || y0 >= y1) continue;
+
+            for (int y = y0; y < y1; ++y) {
+                Uint32* row = &framebuffer[static_cast<size_t>(y) * width];
+                // An outline is the rect's first and last row and column
+                bool wholeRow = batch.filled || y == r.y || y == r.y + r.h - 1;
+                if (wholeRow) {
+                    if (blended) {
+                        blendSpan(row + x0, x1 - x0, batch.color);
+                    } else {
+                        fillSpan(row + x0, x1 - x0, color);
+                    }
+                    continue;
+                }
+                int left = r.x, right = r.x + r.w - 1;
+                if (left >= 0 && left < width) {
+                    if (blended) blendSpan(row + left, 1, batch.color); else row[left] = color;
+                }
+                if (right != left && right >= 0 && right < width) {
+                    if (blended) blendSpan(row + right, 1, batch.color); else row[right] = color;
+                }
+            }
+        }
+    }
+}
+
+void enableSoftRaster(int workers) {
+    enabled = true;
+    poolWorkers = workers;
+    std::cout << "Software rasteriser on " << softRasterPool().threads() << " threads" << std::endl;
+}
+
+bool softRasterEnabled() {
+    return enabled;
+}
+
+// Never destroyed: the workers stay blocked at exit rather than being
+// joined while the library unloads
+ThreadPool& softRasterPool() {
+    static ThreadPool* pool = new ThreadPool(poolWorkers);
+    return *pool;
+}
+
+void benchmarkSoftRaster(SDL_Renderer* renderer, const RenderSnapshot& snapshot, int frames) {
+    int width = 0, height = 0;
+    SDL_GetRendererOutputSize(renderer, &width, &height);
+    if (width <= 0 || height <= 0 || frames <= 0) return;
+    std::vector<Uint32> sdlPixels(static_cast<size_t>(width) * height), softPixels(sdlPixels.size());
+
+    SnapshotPainter sdlPainter(renderer);
+    SnapshotPainter softPainter(renderer);
+    sdlPainter.setSoftware(false);
+    softPainter.setSoftware(true);
+
+    // Read back before presenting: the back buffer is undefined afterwards
+    sdlPainter.draw(snapshot);
+    SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_ARGB8888, sdlPixels.data(), width * 4);
+    SDL_RenderPresent(renderer);
+    softPainter.draw(snapshot);
+    SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_ARGB8888, softPixels.data(), width * 4);
+    SDL_RenderPresent(renderer);
+    long long different = 0;
+    for (size_t i = 0; i < sdlPixels.size(); ++i) {
+        if ((sdlPixels[i] ^ softPixels[i]) & 0x00ffffffu) different++; // The window may not keep alpha
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < frames; ++i) {
+        sdlPainter.draw(snapshot);
+        SDL_RenderPresent(renderer);
+    }
+    double sdlMicros = microsSince(start) / frames;
+
+    SoftRaster raster;
+    start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < frames; ++i) raster.rasterise(snapshot, width, height, softRasterPool());
+    double rasterMicros = microsSince(start) / frames;
+
+    start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < frames; ++i) {
+        softPainter.draw(snapshot);
+        SDL_RenderPresent(renderer);
+    }
+    double softMicros = microsSince(start) / frames;
+
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) != 0) info.name = "?";
+    std::cout << "Rasteriser, " << width << "x" << height << ", " << snapshot.layer.getRects().size() + snapshot.shapes.getRects().size()
+              << " rects, " << frames << " frames on " << info.name << ": SDL " << sdlMicros << " us per frame, software "
+              << softMicros << " us (" << rasterMicros << " us rasterising on " << softRasterPool().threads()
+              << " threads), " << different << " pixels differ" << std::endl;
+}
@@ -0,0 +1,48 @@
+#ifndef SOFT_RASTER_H
+#define SOFT_RASTER_H
+
+#include <SDL.h>
+#include <vector>
+#include "render_snapshot.h"
+#include "thread_pool.h"
+
+// CPU backend for SnapshotPainter. The background, layer and rects of a
+// snapshot are rasterised into an ARGB8888 framebuffer, one band of rows
+// per task across a ThreadPool, with SIMD span fills. The painter uploads
+// the result as a single streaming texture and lets SDL draw the blended
+// geometry on top. Filled and outlined rects come out pixel for pixel as
+// SDL_RenderFillRects and SDL_RenderDrawRects draw them at a scale of one;
+// a layer colour that is not opaque is blended with integer rounding, which
+// a GPU may round differently.
+class SoftRaster {
+public:
+    static const int BAND_ROWS = 32;
+
+    SoftRaster();
+
+    void rasterise(const RenderSnapshot& snapshot, int width, int height, ThreadPool& pool);
+
+    const Uint32* pixels() const { return framebuffer.data(); }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    void rasteriseBand(const RenderSnapshot& snapshot, int top, int bottom);
+    void rasteriseList(const RectList& list, bool blend, int top, int bottom);
+
+    std::vector<Uint32> framebuffer;
+    int width, height;
+};
+
+// Painters created after this draw through SoftRaster; workers as for
+// ThreadPool. Emulator --soft-raster [threads]
+void enableSoftRaster(int workers = 0);
+bool softRasterEnabled();
+ThreadPool& softRasterPool();
+
+// Draws the snapshot the given number of times through SDL and through
+// SoftRaster, then prints the time per frame of each and how many pixels
+// differ between the two
+void benchmarkSoftRaster(SDL_Renderer* renderer, const RenderSnapshot& snapshot, int frames);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded single-producer single-consumer queue. One thread may push and
+// one other thread may pop without locks; neither ever waits. Capacity must
+// be a power of two.
+template <typename T, size_t Capacity>
+class SpscRing {
+public:
+    SpscRing() : head(0), tail(0) {
+        static_assert((Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+    }
+
+    // Producer only. Returns false when full.
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead == Capacity) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead == Capacity) return false;
+        }
+        items[t & (Capacity - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns false when empty.
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail) return false;
+        }
+        item = items[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called while the other side is active
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+private:
+    // Each side's index and its cached copy of the other side's index share
+    // a cache line, kept apart from the other side's
+    alignas(64) std::atomic<size_t> head;
+    size_t cachedTail = 0;
+    alignas(64) std::atomic<size_t> tail;
+    size_t cachedHead = 0;
+    alignas(64) T items[Capacity];
+};
+
+#endif
@@ -2,26 +2,29 @@
 #define SDL_MAIN_HANDLED
 #include <SDL.h>
 #include <vector>
+#include <algorithm>
 #include <iostream>
 #include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include "event_log.h"
+#include "leaderboard.h"
+#include "save_state.h"
+#include "rewind_buffer.h"
+#include "video_capture.h"
+#include "simulation.h"
+#include "rng.h"
+#include "game_module.h"
 #define BOARD_WIDTH (WIDTH / TILE_SIZE)
 #define BOARD_HEIGHT (HEIGHT / TILE_SIZE)
 
 #define WIDTH 500
 #define HEIGHT 800
 #define TILE_SIZE (WIDTH / 20)
-int dropDelay = 500;
-int lastDropTime = 0;
 
-
-bool running;
-int score = 0;
 SDL_Renderer* renderer;
 SDL_Window* window;
 
-int frameCount, timerFPS, lastFrame, fps;
-bool left, right, up, down;
-
 struct block {
  SDL_Color color;
  bool active;
@@ -75,9 +78,9 @@ shape blocks[7] = {{{255,165,0},
 ,{1,1,1,0}
 ,{0,0,0,0}
 ,{0,0,0,0}
-},5,4,3}}, cur;
+},5,4,3}};
 
-shape reverseCols(shape s) {
+shape reverseCols(const shape& s) {
     shape tmp = s;
     for(int i=0; i<s.size; i++) {
         for(int j=0; j<s.size/2; j++) {
@@ -88,7 +91,7 @@ shape reverseCols(shape s) {
     }
     return tmp;
 }
-shape transpose(shape s) {
+shape transpose(const shape& s) {
     shape tmp = s;
     for(int i=0; i<s.size; i++) {
         for(int j=0; j<s.size; j++) {
@@ -97,25 +100,36 @@ shape transpose(shape s) {
     }
     return tmp;
 }
-SDL_Rect rect;
-block board[BOARD_WIDTH][BOARD_HEIGHT] = {};
-void drawBoard() {
+const SDL_Color OUTLINE_COLOR = {219, 219, 219, 255};
+
+// Blocks first, then every outline, so the outlines go out in one batch;
+// blocks never overlap, so the picture is the same as block by block
+void snapshotBoard(const block board[][BOARD_HEIGHT], RenderSnapshot& out) {
+    SDL_Rect rect = {0, 0, TILE_SIZE, TILE_SIZE};
+    for (int x = 0; x < BOARD_WIDTH; ++x) {
+        for (int y = 0; y < BOARD_HEIGHT; ++y) {
+            if (board[x][y].active) {
+                rect.x = x * TILE_SIZE;
+                rect.y = y * TILE_SIZE;
+                SDL_Color color = board[x][y].color;
+                color.a = 255;
+                out.shapes.add(rect, color);
+            }
+        }
+    }
     for (int x = 0; x < BOARD_WIDTH; ++x) {
         for (int y = 0; y < BOARD_HEIGHT; ++y) {
             if (board[x][y].active) {
                 rect.x = x * TILE_SIZE;
                 rect.y = y * TILE_SIZE;
-                SDL_SetRenderDrawColor(renderer, board[x][y].color.r, board[x][y].color.g, board[x][y].color.b, 255);
-                SDL_RenderFillRect(renderer, &rect);
-                SDL_SetRenderDrawColor(renderer, 219, 219, 219, 255);
-                SDL_RenderDrawRect(renderer, &rect);
+                out.shapes.add(rect, OUTLINE_COLOR, false);
             }
         }
     }
 }
 
 
-bool checkCollision(shape& s) {
+bool checkCollision(const block board[][BOARD_HEIGHT], const shape& s) {
     for (int i = 0; i < s.size; i++) {
         for (int j = 0; j < s.size; j++) {
             if (s.matrix[i][j]) {
@@ -130,26 +144,23 @@ bool checkCollision(shape& s) {
     return false; // No collision
 }
 
-void rotate() {
-    shape tmp = cur;
-    tmp = reverseCols(transpose(tmp)); // Rotate the temporary shape
-
-    if (!checkCollision(tmp)) {
-        cur = tmp; // Only rotate if no collision
+void snapshotShape(const shape& s, RenderSnapshot& out) {
+    SDL_Rect rect = {0, 0, TILE_SIZE, TILE_SIZE};
+    SDL_Color color = s.color;
+    color.a = 255;
+    for(int i=0; i<s.size; i++) {
+        for(int j=0; j<s.size; j++) {
+            if(s.matrix[i][j]) {
+                rect.x=(s.x+i)*TILE_SIZE; rect.y=(s.y+j)*TILE_SIZE;
+                out.shapes.add(rect, color);
+            }
+        }
     }
-}
-
-
-
-void draw(shape s) {
     for(int i=0; i<s.size; i++) {
         for(int j=0; j<s.size; j++) {
             if(s.matrix[i][j]) {
                 rect.x=(s.x+i)*TILE_SIZE; rect.y=(s.y+j)*TILE_SIZE;
-                SDL_SetRenderDrawColor(renderer, s.color.r, s.color.g, s.color.b, 255);
-                SDL_RenderFillRect(renderer, &rect);
-                SDL_SetRenderDrawColor(renderer, 219, 219, 219, 255);
-                SDL_RenderDrawRect(renderer, &rect);
+                out.shapes.add(rect, OUTLINE_COLOR, false);
             }
         }
     }
@@ -219,7 +230,7 @@ public:
     LineFull(block board[][BOARD_HEIGHT]);
 
     // Public methods
-    void checkLines();
+    int checkLines(); // Returns the number of lines cleared
 
 private:
     // Private member variables
@@ -234,7 +245,8 @@ private:
 LineFull::LineFull(block board[][BOARD_HEIGHT]) : board(board) {}
 
 // Public Methods Implementation
-void LineFull::checkLines() {
+int LineFull::checkLines() {
+    int cleared = 0;
     for (int y = BOARD_HEIGHT - 1; y >= 0; y--) {
         bool lineFull = true;
         for (int x = 0; x < BOARD_WIDTH; x++) {
@@ -248,10 +260,10 @@ void LineFull::checkLines() {
             checkLines(y);
             moveLinesDown(y);
             y++; // Check this line again after moving lines down
-            score += 10;
-            std::cout<<"score : "<<score<<std::endl;
+            cleared++;
         }
     }
+    return cleared;
 }
 
 // Private Methods Implementation
@@ -273,22 +285,24 @@ void LineFull::moveLinesDown(int clearedLine) {
 
 class ShapePlacer {
 public:
-    ShapePlacer(block b[][BOARD_HEIGHT], shape* c, shape bks[]) 
-    : board(b), cur(c), blocks(bks) {}
+    ShapePlacer(block b[][BOARD_HEIGHT], shape* c, shape bks[], Rng& rng)
+    : board(b), cur(c), blocks(bks), rng(rng) {}
 
-    void placeShapeOnBoard();
+    // Returns the number of lines cleared, or -1 when the game is over
+    int placeShapeOnBoard();
 
 private:
     block (*board)[BOARD_HEIGHT];
     shape* cur;
     shape* blocks;
+    Rng& rng;     // Picks the next piece
 
-    void checkGameOver();
+    bool checkGameOver();
     void generateNewShape();
 };
 
-void ShapePlacer::placeShapeOnBoard() {
-    checkGameOver();
+int ShapePlacer::placeShapeOnBoard() {
+    if (checkGameOver()) return -1;
 
     // Set the board cells to active and update the color
     for (int i = 0; i < cur->size; ++i) {
@@ -303,47 +317,166 @@ void ShapePlacer::placeShapeOnBoard() {
     }
 
     LineFull lineFull(board);
-    lineFull.checkLines();
+    int cleared = lineFull.checkLines();
 
     generateNewShape();
+    return cleared;
 }
 
-void ShapePlacer::checkGameOver() {
+// Ends the game when the piece is stuck at the top
+bool ShapePlacer::checkGameOver() {
     for (int i = 0; i < cur->size; ++i) {
         for (int j = 0; j < cur->size; ++j) {
             if (cur->matrix[i][j] && static_cast<int>(cur->y) + j <= 0) {
                 // Game over condition
-                std::cout << "Game Over!" << std::endl;
-                exit(0); // or use a global running variable to stop the game loop
+                return true;
             }
         }
     }
+    return false;
 }
 
 void ShapePlacer::generateNewShape() {
     // Generate a new shape
-    *cur = blocks[rand() % 7];
+    *cur = blocks[rng.below(7)];
     cur->x = BOARD_WIDTH / 2 - cur->size / 2;
     cur->y = 0;
 }
 
 
-class TetrisGame{
+// Palette position of a block colour; board cells store it plus one
+static Uint8 blockColorIndex(const SDL_Color& color) {
+    for (int i = 0; i < 7; ++i) {
+        const SDL_Color& c = blocks[i].color;
+        if (c.r == color.r && c.g == color.g && c.b == color.b) return static_cast<Uint8>(i);
+    }
+    return 0;
+}
+
+// The board and the falling piece live in the game, so training copies can
+// play side by side
+class TetrisGame : public Snapshotable, public Simulation, public GameEnv {
 public:
-void update() {
-        CheckMove checkMove(board, &cur); // Create an instance of CheckMove
+    static const Uint8 STATE_VERSION = 1;
+    static const int ENV_ACTIONS = 5;
+    static const int ENV_STATE_SIZE = BOARD_WIDTH + 16 + 2;
+
+    // A quiet game logs nothing, for training copies
+    TetrisGame(bool quiet = false)
+        : board(), cur(blocks[0]), score(0), dropDelay(500), lastDropTime(0), running(true), quiet(quiet),
+          left(false), right(false), up(false), down(false), envTicks(0),
+          quickSaves("tetris", GAME_TETRIS, *this), rewind("tetris", *this) {}
+
+    // Score, drop timer, RNG, the falling piece, then the board one byte
+    // per cell: 0 for empty, otherwise the block colour index plus one
+    void saveState(std::vector<unsigned char>& out) const {
+        StateWriter writer(out, GAME_TETRIS, STATE_VERSION);
+        writer.put<Sint32>(score);
+        writer.put<Sint32>(dropDelay);
+        writer.put<Sint32>(static_cast<int>(SDL_GetTicks()) - lastDropTime);
+        writer.put<Uint32>(rng.getState());
+
+        Uint16 matrix = 0;
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                if (cur.matrix[i][j]) matrix |= 1 << (i * 4 + j);
+        writer.put<Uint8>(blockColorIndex(cur.color));
+        writer.put<Uint8>(static_cast<Uint8>(cur.size));
+        writer.put<Sint16>(static_cast<Sint16>(cur.x));
+        writer.put<Sint16>(static_cast<Sint16>(cur.y));
+        writer.put<Uint16>(matrix);
+
+        Uint8 cells[BOARD_WIDTH * BOARD_HEIGHT];
+        for (int x = 0; x < BOARD_WIDTH; ++x)
+            for (int y = 0; y < BOARD_HEIGHT; ++y)
+                cells[x * BOARD_HEIGHT + y] = board[x][y].active ? blockColorIndex(board[x][y].color) + 1 : 0;
+        writer.putBytes(cells, sizeof(cells));
+        writer.finish();
+    }
+
+    bool loadState(const unsigned char* data, size_t size) {
+        StateReader reader(data, size, GAME_TETRIS, STATE_VERSION);
+        Sint32 savedScore, savedDelay, sinceDrop;
+        Uint32 rngState;
+        Uint8 colorIndex, shapeSize;
+        Sint16 shapeX, shapeY;
+        Uint16 matrix;
+        reader.get(savedScore);
+        reader.get(savedDelay);
+        reader.get(sinceDrop);
+        reader.get(rngState);
+        reader.get(colorIndex);
+        reader.get(shapeSize);
+        reader.get(shapeX);
+        reader.get(shapeY);
+        reader.get(matrix);
+        const unsigned char* cells = reader.take(BOARD_WIDTH * BOARD_HEIGHT);
+        if (!reader.done() || colorIndex >= 7 || shapeSize < 1 || shapeSize > 4 || savedDelay <= 0) return false;
+        for (int k = 0; k < BOARD_WIDTH * BOARD_HEIGHT; ++k) {
+            if (cells[k] > 7) return false;
+        }
+        // The falling piece has to lie on the board clear of the settled
+        // blocks, as checkCollision would find it on the loaded board
+        for (int i = 0; i < 4; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                if (!((matrix >> (i * 4 + j)) & 1)) continue;
+                int boardX = shapeX + i, boardY = shapeY + j;
+                if (i >= shapeSize || j >= shapeSize || boardX < 0 || boardX >= BOARD_WIDTH || boardY < 0 || boardY >= BOARD_HEIGHT) return false;
+                if (cells[boardX * BOARD_HEIGHT + boardY]) return false;
+            }
+        }
+
+        score = savedScore;
+        dropDelay = savedDelay;
+        lastDropTime = static_cast<int>(SDL_GetTicks()) - sinceDrop;
+        rng.setState(rngState);
+        cur.color = blocks[colorIndex].color;
+        cur.size = shapeSize;
+        cur.x = shapeX;
+        cur.y = shapeY;
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                cur.matrix[i][j] = (matrix >> (i * 4 + j)) & 1;
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+            for (int y = 0; y < BOARD_HEIGHT; ++y) {
+                Uint8 cell = cells[x * BOARD_HEIGHT + y];
+                board[x][y].active = cell != 0;
+                board[x][y].color = cell ? blocks[cell - 1].color : SDL_Color{0, 0, 0, 0};
+            }
+        }
+        return true;
+    }
 
-        int currentTime = SDL_GetTicks();
+    // Drops a few pieces without a window, then times saving and loading
+    void benchSaveState(int iterations) {
+        rng.seed(1);
+        cur = blocks[rng.below(7)];
+        down = 1;
+        for (int i = 0; i < 100; ++i) update(SDL_GetTicks());
+        down = 0;
+        benchmarkSaveState("tetris", *this, iterations);
+
+        // A minute of play: a step down every few ticks, wandering sideways
+        int tick = 0;
+        benchmarkRewind("tetris", *this, [this, &tick]() -> Uint32 {
+            up = down = left = right = 0;
+            if (++tick % 8 == 0) down = 1;
+            if (tick % 20 == 0) (rng.below(2) ? left : right) = 1;
+            update(SDL_GetTicks());
+            return tickMicros();
+        }, 60 * RewindControl::SAMPLES_PER_SECOND);
+        up = down = left = right = 0;
+    }
+
+    void update(int currentTime) {
+        CheckMove checkMove(board, &cur); // Create an instance of CheckMove
 
         // Auto-move the piece down every dropDelay milliseconds
         if (currentTime - lastDropTime > dropDelay) {
             if (canMoveDown(checkMove)) {
                 cur.y++;
             } else {
-                // Example usage
-                ShapePlacer shapePlacer(board, &cur, blocks);
-                shapePlacer.placeShapeOnBoard();
-
+                placeShape();
             }
             lastDropTime = currentTime;
         }
@@ -354,10 +487,7 @@ void update() {
                 cur.y++;
                 lastDropTime = currentTime; // Reset the timer after manual move down
             } else {
-                // Example usage
-                    ShapePlacer shapePlacer(board, &cur, blocks);
-                    shapePlacer.placeShapeOnBoard();
-
+                placeShape();
             }
         }
 
@@ -369,86 +499,228 @@ void update() {
         if (up) rotate();
     }
 
-    void input() {
-        up = down = left = right = 0;
-        SDL_Event e;
-        while(SDL_PollEvent(&e)) {
-            if( e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_CLOSE) running=false;
-            switch(e.type) {
-                case SDL_KEYDOWN: // Use KEYDOWN for immediate response
-                    switch(e.key.keysym.sym) {
-                        case SDLK_LEFT:
-                            left = 1;
-                            break;
-                        case SDLK_RIGHT:
-                            right = 1;
-                            break;
-                        case SDLK_UP:
-                            up = 1;
-                            break;
-                        case SDLK_DOWN:
-                            down = 1;
-                            break;
-                        case SDLK_ESCAPE:
-                            running=false;
-                            break;
-                    }
-                    break;
-            }
+    // The simulation thread's side, see runSimulation(). The drop timer
+    // runs on SDL_GetTicks(), so the tick rate only sets how quickly keys
+    // are acted on. Training copies count their own ticks instead.
+    Uint32 tickMicros() const { return 1000000 / 60; }
+
+    void keyPressed(const SDL_KeyboardEvent& key) { // KEYDOWN for immediate response
+        switch(key.keysym.sym) {
+            case SDLK_LEFT:
+                left = 1;
+                break;
+            case SDLK_RIGHT:
+                right = 1;
+                break;
+            case SDLK_UP:
+                up = 1;
+                break;
+            case SDLK_DOWN:
+                down = 1;
+                break;
+            case SDLK_ESCAPE:
+                running=false;
+                break;
+            default:
+                if (key.repeat == 0) quickSaves.handleKey(key.keysym.sym);
+                break;
         }
     }
 
+    void recordRewind(bool on) { rewind.setEnabled(on); }
 
+    void tick(const Uint8* keystate) {
+        if (!rewind.rewinding(keystate)) {
+            update(SDL_GetTicks());
+            rewind.recordTick(tickMicros());
+        }
+        up = down = left = right = 0;
+    }
 
-    void render() {
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
+    void snapshot(RenderSnapshot& out) {
+        const SDL_Color black = {0, 0, 0, 255};
+        out.clear(black);
+        // A full board and the falling shape, block and outline each, so a
+        // filling board never grows the list mid-game
+        out.shapes.reserve(2 * (BOARD_WIDTH * BOARD_HEIGHT + 16));
 
         // Draw all the active blocks on the board first.
-        drawBoard();
+        snapshotBoard(board, out);
 
         // Draw the current moving shape.
-        draw(cur);
+        snapshotShape(cur, out);
+    }
+
+    bool finished() const { return !running; }
+
+    // Training side, see game_env.h. Actions: 0 nothing, 1 left, 2 right,
+    // 3 rotate, 4 down; a step is one tick at 60 Hz.
+    void reset(Uint32 seed) {
+        for (int x = 0; x < BOARD_WIDTH; ++x)
+            for (int y = 0; y < BOARD_HEIGHT; ++y)
+                board[x][y].active = false;
+        rng.seed(seed);
+        cur = blocks[rng.below(7)];
+        score = 0;
+        dropDelay = 500;
+        lastDropTime = 0;
+        envTicks = 0;
+        running = true;
+    }
+
+    float step(int action) {
+        int before = score;
+        left = action == 1;
+        right = action == 2;
+        up = action == 3;
+        down = action == 4;
+        envTicks++;
+        update(static_cast<int>(envTicks * 1000 / 60));
+        up = down = left = right = 0;
+        return static_cast<float>(score - before);
+    }
 
-        SDL_RenderPresent(renderer);
+    bool done() const { return !running; }
+
+    // Height of every column, the piece's 4x4 matrix and its position
+    void observe(float* state) const {
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+            int y = 0;
+            while (y < BOARD_HEIGHT && !board[x][y].active) y++;
+            state[x] = static_cast<float>(BOARD_HEIGHT - y) / BOARD_HEIGHT;
+        }
+        float* matrix = state + BOARD_WIDTH;
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                matrix[i * 4 + j] = i < cur.size && j < cur.size && cur.matrix[i][j] ? 1.0f : 0.0f;
+        state[BOARD_WIDTH + 16] = static_cast<float>(cur.x) / BOARD_WIDTH;
+        state[BOARD_WIDTH + 17] = static_cast<float>(cur.y) / BOARD_HEIGHT;
     }
 
 
 
     void run() {
-        srand(time(NULL));
-        cur=blocks[rand() % 7];
-        rect.w=rect.h=TILE_SIZE;
+        rng.seed(static_cast<Uint32>(time(NULL)));
+        cur=blocks[rng.below(7)];
         running=1;
-        static int lastTime=0;
         SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
         if(SDL_Init(SDL_INIT_EVERYTHING) < 0) std::cout << "Failed at SDL_Init()" << std::endl;
         if(SDL_CreateWindowAndRenderer(WIDTH, HEIGHT, 0, &window, &renderer) < 0) std::cout << "Failed at SDL_CreateWindowAndRenderer()" << std::endl;
         SDL_SetWindowTitle(window, "Tetris");
-        SDL_Event e;
-
-        while(running) {
-            lastFrame=SDL_GetTicks();
-            if(lastFrame>=(lastTime+1000)) {
-                lastTime=lastFrame;
-                fps=frameCount;
-                frameCount=0;
-            }
-            update();
-            input();
-            render();
-        }
+
+        runSimulation("tetris", *this, renderer);
+        rewind.printStats();
+        videoCapture().stop();
+        recordScore("tetris", score);
         SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
-        SDL_Quit();
+        SDL_QuitSubSystem(SDL_INIT_EVERYTHING);
+    }
+
+private:
+    void rotate() {
+        shape tmp = cur;
+        tmp = reverseCols(transpose(tmp)); // Rotate the temporary shape
+
+        if (!checkCollision(board, tmp)) {
+            cur = tmp; // Only rotate if no collision
+        }
     }
+
+    void placeShape() {
+        ShapePlacer shapePlacer(board, &cur, blocks, rng);
+        int cleared = shapePlacer.placeShapeOnBoard();
+        if (cleared < 0) {
+            if (!quiet) logEvent(GAME_TETRIS, EVENT_GAME_OVER, score);
+            running = false;
+            return;
+        }
+        for (int i = 0; i < cleared; ++i) {
+            score += 10;
+            if (!quiet) logEvent(GAME_TETRIS, EVENT_SCORE, score, 10);
+        }
+    }
+
+    block board[BOARD_WIDTH][BOARD_HEIGHT];
+    shape cur;
+    int score;
+    int dropDelay;
+    int lastDropTime;
+    bool running;
+    bool quiet;
+    Rng rng; // Picks the next piece; saved with the game
+    bool left, right, up, down;
+    Uint64 envTicks;
+    QuickSaveSlots quickSaves;
+    RewindControl rewind;
 };
 
 void runTetrisGame() {
     TetrisGame game;
+    logEvent(GAME_TETRIS, EVENT_GAME_START);
     game.run();
 }
-/* compilation 
-g++ -std=c++11 -IC:\mingw_dev_lib\include\SDL2 -LC:\mingw_dev_lib\lib -o Tetris tetris.cpp -lmingw32 -lSDL2main -lSDL2
-./tetris.exe
+
+void benchTetrisSaveState(int iterations) {
+    TetrisGame game;
+    game.benchSaveState(iterations);
+}
+
+static GameEnv* createTetrisEnv() {
+    return new TetrisGame(true);
+}
+
+static Simulation* createTetrisSimulation(bool rewind) {
+    TetrisGame* game = new TetrisGame(true);
+    game->recordRewind(rewind);
+    return game;
+}
+
+// Attract mode: slides the piece over the lowest stretch of the stack that
+// is as wide as it is, then drops it. It never rotates, so holes build up
+// and the game ends after a while.
+static int autoplayTetris(const float* state) {
+    const float* matrix = state + BOARD_WIDTH;
+    int first = 4, last = -1; // Columns of the piece's matrix in use
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            if (matrix[i * 4 + j] > 0.5f) {
+                first = std::min(first, i);
+                last = std::max(last, i);
+            }
+        }
+    }
+    if (last < 0) return 0;
+    int x = static_cast<int>(state[BOARD_WIDTH + 16] * BOARD_WIDTH + (state[BOARD_WIDTH + 16] < 0 ? -0.5f : 0.5f));
+    int target = x;
+    float lowest = 2.0f;
+    for (int at = -first; at + last < BOARD_WIDTH; ++at) {
+        float height = 0.0f;
+        for (int i = first; i <= last; ++i) height = std::max(height, state[at + i]);
+        if (height < lowest - 0.001f) {
+            lowest = height;
+            target = at;
+        }
+    }
+    return target < x ? 1 : target > x ? 2 : 4;
+}
+
+// Emulator --bench-savestate [iterations]
+static bool runTetrisCommand(int argc, char* argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "--bench-savestate") == 0) {
+        benchTetrisSaveState(argc > 2 ? atoi(argv[2]) : 10000);
+        return true;
+    }
+    return false;
+}
+
+GAME_MODULE_EXPORT const GameModule* arcadeGameModule() {
+    static const GameEnvSpec env = {TetrisGame::ENV_ACTIONS, TetrisGame::ENV_STATE_SIZE, WIDTH, HEIGHT, createTetrisEnv,
+                                     autoplayTetris};
+    static const GameModule module = {GAME_MODULE_API_VERSION, "Tetris", "tetris", true, runTetrisGame, runTetrisCommand, &env,
+                                      createTetrisSimulation};
+    return &module;
+}
+/* compilation, as a game module next to the emulator (see emulator.cpp)
+g++ -std=c++11 -shared -o games/tetris.dll tetris.cpp -IC:\mingw_dev_lib\include\SDL2 -LC:\mingw_dev_lib\lib -L. -larcade_core -lmingw32 -lSDL2
 */
\ No newline at end of file
@@ -3,4 +3,7 @@
 
 void runTetrisGame();
 
+// Headless timing of save state and load state
+void benchTetrisSaveState(int iterations);
+
 #endif // TETRIS_H
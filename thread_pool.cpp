@@ -0,0 +1,58 @@
+#include "thread_pool.h"
+#include <iostream>
+
+ThreadPool::ThreadPool(int workerCount)
+    : started(SDL_CreateSemaphore(0)), finished(SDL_CreateSemaphore(0)), job(nullptr), count(0), next(0),
+      stopRequested(false) {
+    if (workerCount <= 0) workerCount = SDL_GetCPUCount() - 1;
+    if (!started || !finished) workerCount = 0;
+    for (int i = 0; i < workerCount; ++i) {
+        SDL_Thread* thread = SDL_CreateThread(workerMain, "Worker", this);
+        if (!thread) {
+            std::cerr << "Cannot start worker thread: " << SDL_GetError() << std::endl;
+            break;
+        }
+        workers.push_back(thread);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    stopRequested.store(true, std::memory_order_release);
+    for (size_t i = 0; i < workers.size(); ++i) SDL_SemPost(started);
+    for (SDL_Thread* thread : workers) SDL_WaitThread(thread, nullptr);
+    if (started) SDL_DestroySemaphore(started);
+    if (finished) SDL_DestroySemaphore(finished);
+}
+
+void ThreadPool::run(int pieces, const std::function<void(int)>& newJob) {
+    if (pieces <= 0) return;
+    if (workers.empty() || pieces == 1) {
+        for (int i = 0; i < pieces; ++i) newJob(i);
+        return;
+    }
+    job = &newJob;
+    count = pieces;
+    next.store(0, std::memory_order_relaxed);
+    // Posting the semaphore publishes job and count to the workers
+    for (size_t i = 0; i < workers.size(); ++i) SDL_SemPost(started);
+    work();
+    for (size_t i = 0; i < workers.size(); ++i) SDL_SemWait(finished);
+    job = nullptr;
+}
+
+void ThreadPool::work() {
+    for (int i = next.fetch_add(1, std::memory_order_relaxed); i < count; i = next.fetch_add(1, std::memory_order_relaxed)) {
+        (*job)(i);
+    }
+}
+
+int ThreadPool::workerMain(void* data) {
+    ThreadPool* pool = static_cast<ThreadPool*>(data);
+    for (;;) {
+        SDL_SemWait(pool->started);
+        if (pool->stopRequested.load(std::memory_order_acquire)) break;
+        pool->work();
+        SDL_SemPost(pool->finished);
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <SDL.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+// A fixed set of worker threads for splitting one job into pieces, such as
+// the rows of a frame. run() hands out piece numbers until none are left
+// and returns when every piece is done; the calling thread works too.
+class ThreadPool {
+public:
+    // workers 0 means one per CPU besides the caller's
+    explicit ThreadPool(int workers = 0);
+    ~ThreadPool();
+
+    // Calls job(i) once for every i in [0, count). Only one thread may
+    // call run() at a time.
+    void run(int count, const std::function<void(int)>& job);
+
+    // Threads taking part in run(), the caller included
+    int threads() const { return static_cast<int>(workers.size()) + 1; }
+
+private:
+    static int workerMain(void* data);
+    void work();
+
+    std::vector<SDL_Thread*> workers;
+    SDL_sem* started;
+    SDL_sem* finished;
+    const std::function<void(int)>* job;
+    int count;
+    std::atomic<int> next;
+    std::atomic<bool> stopRequested;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Latest-value handoff between one writer thread and one reader thread.
+// The writer fills its own buffer and publishes it; the reader always gets
+// the newest published buffer. Neither side waits and values the reader
+// was too slow to see are simply replaced. The same swap of a middle index
+// as the shared memory frames in frame_share.h.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : middle(1), writeIndex(0), readIndex(2) {}
+
+    // Writer only. Fill this, then publish().
+    T& writeBuffer() { return buffers[writeIndex]; }
+
+    // Writer only. Hands the filled buffer over and takes back whichever
+    // one was waiting, which still holds an older value.
+    void publish() {
+        writeIndex = middle.exchange(writeIndex | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Reader only. Moves to the newest published buffer; false if nothing
+    // was published since the last call.
+    bool update() {
+        if (!(middle.load(std::memory_order_acquire) & FRESH)) return false;
+        readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    // Reader only. Stays the same until the next successful update().
+    const T& readBuffer() const { return buffers[readIndex]; }
+
+private:
+    static const uint32_t INDEX = 3;
+    static const uint32_t FRESH = 4;
+
+    T buffers[3];
+    alignas(64) std::atomic<uint32_t> middle;
+    alignas(64) uint32_t writeIndex;
+    alignas(64) uint32_t readIndex;
+};
+
+#endif
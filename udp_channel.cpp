@@ -0,0 +1,85 @@
+#include "udp_channel.h"
+#include <SDL.h>
+#include <cstring>
+#include <iostream>
+
+const int MAX_PACKET_SIZE = 512;
+
+UdpChannel::UdpChannel(int localPort, const char* peerHost, int peerPort, int latencyMs, int lossPercent)
+    : localPort(localPort), peerHost(peerHost), peerPort(peerPort), latencyMs(latencyMs), lossPercent(lossPercent),
+      lossSeed(0x9E3779B9u ^ static_cast<Uint32>(localPort)), netInitialized(false), socket(nullptr), packet(nullptr), sentCount(0), droppedCount(0) {}
+
+UdpChannel::~UdpChannel() {
+    if (packet) SDLNet_FreePacket(packet);
+    if (socket) SDLNet_UDP_Close(socket);
+    if (netInitialized) SDLNet_Quit();
+}
+
+bool UdpChannel::open() {
+    if (SDLNet_Init() < 0) {
+        std::cerr << "SDL_net could not initialize! SDLNet_Error: " << SDLNet_GetError() << std::endl;
+        return false;
+    }
+    netInitialized = true;
+    if (SDLNet_ResolveHost(&peerAddress, peerHost, static_cast<Uint16>(peerPort)) < 0) {
+        std::cerr << "Could not resolve peer " << peerHost << ": " << SDLNet_GetError() << std::endl;
+        return false;
+    }
+    socket = SDLNet_UDP_Open(static_cast<Uint16>(localPort));
+    if (!socket) {
+        std::cerr << "Could not open UDP port " << localPort << ": " << SDLNet_GetError() << std::endl;
+        return false;
+    }
+    packet = SDLNet_AllocPacket(MAX_PACKET_SIZE);
+    return packet != nullptr;
+}
+
+void UdpChannel::send(const Uint8* data, int length) {
+    if (length > MAX_PACKET_SIZE) return;
+
+    // xorshift keeps the simulated loss pattern reproducible between runs
+    lossSeed ^= lossSeed << 13;
+    lossSeed ^= lossSeed >> 17;
+    lossSeed ^= lossSeed << 5;
+    if (static_cast<int>(lossSeed % 100) < lossPercent) {
+        droppedCount++;
+        return;
+    }
+
+    if (latencyMs <= 0) {
+        sendNow(data, length);
+        return;
+    }
+    DelayedPacket delayedPacket;
+    delayedPacket.sendTime = SDL_GetTicks() + latencyMs;
+    delayedPacket.data.assign(data, data + length);
+    delayed.push_back(delayedPacket);
+}
+
+void UdpChannel::pump() {
+    Uint32 now = SDL_GetTicks();
+    while (!delayed.empty() && static_cast<Sint32>(now - delayed.front().sendTime) >= 0) {
+        sendNow(delayed.front().data.data(), static_cast<int>(delayed.front().data.size()));
+        delayed.pop_front();
+    }
+}
+
+int UdpChannel::receive(Uint8* buffer, int maxLength) {
+    while (socket && SDLNet_UDP_Recv(socket, packet) > 0) {
+        // Ignore anything that is not from our peer
+        if (packet->address.host != peerAddress.host || packet->address.port != peerAddress.port) continue;
+        if (packet->len > maxLength) continue;
+        memcpy(buffer, packet->data, packet->len);
+        return packet->len;
+    }
+    return 0;
+}
+
+void UdpChannel::sendNow(const Uint8* data, int length) {
+    if (!socket) return;
+    memcpy(packet->data, data, length);
+    packet->len = length;
+    packet->address = peerAddress;
+    SDLNet_UDP_Send(socket, -1, packet);
+    sentCount++;
+}
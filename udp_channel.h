@@ -0,0 +1,46 @@
+#ifndef UDP_CHANNEL_H
+#define UDP_CHANNEL_H
+
+#include <SDL_net.h>
+#include <deque>
+#include <vector>
+
+// Unreliable datagram link to a single peer. Latency and packet loss can be
+// simulated on the sending side so netplay can be tested over loopback.
+class UdpChannel {
+public:
+    UdpChannel(int localPort, const char* peerHost, int peerPort, int latencyMs, int lossPercent);
+    ~UdpChannel();
+
+    bool open();
+    void send(const Uint8* data, int length);
+    int receive(Uint8* buffer, int maxLength); // Returns 0 when nothing is pending
+    void pump(); // Sends delayed packets whose time has come
+
+    int getSentCount() const { return sentCount; }
+    int getDroppedCount() const { return droppedCount; }
+
+private:
+    struct DelayedPacket {
+        Uint32 sendTime;
+        std::vector<Uint8> data;
+    };
+
+    void sendNow(const Uint8* data, int length);
+
+    int localPort;
+    const char* peerHost;
+    int peerPort;
+    int latencyMs;
+    int lossPercent;
+    Uint32 lossSeed;
+    bool netInitialized;   // open() got as far as SDLNet_Init()
+    UDPsocket socket;
+    UDPpacket* packet;
+    IPaddress peerAddress;
+    std::deque<DelayedPacket> delayed;
+    int sentCount;
+    int droppedCount;
+};
+
+#endif
@@ -0,0 +1,195 @@
+#include "video_capture.h"
+#include <SDL_image.h>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+const Uint32 IDLE_WAIT_MS = 2;
+
+double microsSince(Uint64 start) {
+    return static_cast<double>(SDL_GetPerformanceCounter() - start) * 1e6 / SDL_GetPerformanceFrequency();
+}
+
+bool endsWith(const std::string& text, const char* suffix) {
+    size_t length = strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+} // namespace
+
+VideoCapture::VideoCapture()
+    : stopRequested(false), encoder(nullptr), png(false), file(nullptr), width(0), height(0), fps(60),
+      realTime(true), heldBuffer(-1), lastCapture(0), offered(0), dropped(0), written(0), pngIndex(0),
+      captureMicros(0), peakCaptureMicros(0) {}
+
+VideoCapture::~VideoCapture() {
+    stop();
+}
+
+bool VideoCapture::start(const std::string& path, int width, int height, int fps, bool realTime) {
+    if (encoder) return true;
+    if (width <= 0 || height <= 0) return false;
+    this->path = path;
+    this->width = width;
+    this->height = height;
+    this->fps = fps > 0 ? fps : 60;
+    this->realTime = realTime;
+    png = !endsWith(path, ".y4m");
+    if (!png) {
+        file = fopen(path.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Cannot open " << path << " for recording" << std::endl;
+            return false;
+        }
+        fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width, height, this->fps);
+    }
+
+    // Everything is sized here so capturing never allocates
+    size_t frameBytes = static_cast<size_t>(width) * height * 3;
+    pixels.resize(frameBytes * POOL_SIZE);
+    planes.resize(frameBytes);
+    int buffer;
+    while (filledBuffers.pop(buffer)) {}
+    while (freeBuffers.pop(buffer)) {}
+    for (int i = 0; i < POOL_SIZE; ++i) freeBuffers.push(i);
+    heldBuffer = -1;
+    lastCapture = 0;
+    offered = dropped = written = 0;
+    pngIndex = 0;
+    captureMicros = peakCaptureMicros = 0;
+
+    stopRequested = false;
+    encoder = SDL_CreateThread(encoderMain, "VideoCapture", this);
+    if (!encoder) {
+        std::cerr << "Cannot start video encoder thread: " << SDL_GetError() << std::endl;
+        if (file) fclose(file);
+        file = nullptr;
+        return false;
+    }
+    std::cout << "Recording " << width << "x" << height << " to " << path << std::endl;
+    return true;
+}
+
+void VideoCapture::stop() {
+    if (!encoder) return;
+    stopRequested.store(true, std::memory_order_release);
+    SDL_WaitThread(encoder, nullptr);
+    encoder = nullptr;
+    if (file) fclose(file);
+    file = nullptr;
+
+    std::cout << "Recorded " << written << " frames to " << path << ", dropped " << dropped << " of " << offered;
+    if (offered) {
+        std::cout << " (" << 100.0 * dropped / offered << "%), capture " << captureMicros / offered
+                  << " us per frame on the game thread, " << peakCaptureMicros << " us peak";
+    }
+    std::cout << std::endl;
+}
+
+void VideoCapture::captureFrame(SDL_Renderer* renderer) {
+    if (!encoder) return;
+    if (realTime) {
+        Uint32 now = SDL_GetTicks();
+        if (lastCapture && now - lastCapture < 1000u / fps) return;
+        lastCapture = now;
+    }
+    offered++;
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    int outputWidth = 0, outputHeight = 0;
+    SDL_GetRendererOutputSize(renderer, &outputWidth, &outputHeight);
+    if (heldBuffer < 0 && !freeBuffers.pop(heldBuffer)) heldBuffer = -1;
+    if (heldBuffer < 0 || outputWidth != width || outputHeight != height) {
+        dropped++; // The encoder is behind, or the window no longer matches the video
+    } else {
+        size_t frameBytes = static_cast<size_t>(width) * height * 3;
+        unsigned char* frame = &pixels[heldBuffer * frameBytes];
+        if (SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_RGB24, frame, width * 3) == 0) {
+            filledBuffers.push(heldBuffer);
+            heldBuffer = -1;
+        } else {
+            dropped++;
+        }
+    }
+
+    double micros = microsSince(start);
+    captureMicros += micros;
+    if (micros > peakCaptureMicros) peakCaptureMicros = micros;
+}
+
+// Writes frames as they arrive until asked to stop, then writes the rest
+int VideoCapture::encoderMain(void* data) {
+    VideoCapture* capture = static_cast<VideoCapture*>(data);
+    for (;;) {
+        bool stopping = capture->stopRequested.load(std::memory_order_acquire);
+        int buffer;
+        if (capture->filledBuffers.pop(buffer)) {
+            capture->encode(buffer);
+            capture->freeBuffers.push(buffer);
+        } else if (stopping) {
+            break;
+        } else {
+            SDL_Delay(IDLE_WAIT_MS);
+        }
+    }
+    return 0;
+}
+
+void VideoCapture::encode(int buffer) {
+    size_t pixelCount = static_cast<size_t>(width) * height;
+    unsigned char* rgb = &pixels[buffer * pixelCount * 3];
+
+    if (png) {
+        char name[32];
+        snprintf(name, sizeof(name), "-%06d.png", ++pngIndex);
+        SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(rgb, width, height, 24, width * 3, SDL_PIXELFORMAT_RGB24);
+        if (surface && IMG_SavePNG(surface, (path + name).c_str()) == 0) written++;
+        if (surface) SDL_FreeSurface(surface);
+        return;
+    }
+
+    // BT.601 studio range, full resolution chroma
+    unsigned char* y = &planes[0];
+    unsigned char* u = y + pixelCount;
+    unsigned char* v = u + pixelCount;
+    for (size_t i = 0; i < pixelCount; ++i) {
+        int r = rgb[i * 3], g = rgb[i * 3 + 1], b = rgb[i * 3 + 2];
+        y[i] = static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        u[i] = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        v[i] = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+    fputs("FRAME\n", file);
+    if (fwrite(&planes[0], 1, planes.size(), file) == planes.size()) written++;
+}
+
+VideoCapture& videoCapture() {
+    static VideoCapture capture;
+    return capture;
+}
+
+bool handleCaptureKey(SDL_Keycode key, const char* gameName, SDL_Renderer* renderer) {
+    if (key != SDLK_F10) return false;
+    VideoCapture& capture = videoCapture();
+    if (capture.isRecording()) {
+        capture.stop();
+        return true;
+    }
+#ifdef _WIN32
+    _mkdir("captures");
+#else
+    mkdir("captures", 0755);
+#endif
+    int width = 0, height = 0;
+    SDL_GetRendererOutputSize(renderer, &width, &height);
+    std::string path = std::string("captures/") + gameName + "-" + std::to_string(static_cast<long long>(time(nullptr))) + ".y4m";
+    capture.start(path, width, height);
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef VIDEO_CAPTURE_H
+#define VIDEO_CAPTURE_H
+
+#include <SDL.h>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "spsc_ring.h"
+
+// Records a renderer's output to disk. The game thread reads each frame
+// back into one of a fixed pool of pixel buffers and hands it to an
+// encoder thread, which writes it out and returns the buffer. When every
+// buffer is still waiting for the encoder the frame is dropped: the game
+// never waits on disk or encoding.
+//
+// A path ending in .y4m is written as one raw YUV 4:4:4 video; anything
+// else is used as a prefix for lossless PNG frames <prefix>-000001.png...
+class VideoCapture {
+public:
+    static const int POOL_SIZE = 8;
+
+    VideoCapture();
+    ~VideoCapture();
+
+    // Starts recording frames of width x height. With realTime set, at most
+    // fps frames a second are taken so the video plays back at game speed;
+    // otherwise every frame is offered, for headless runs.
+    bool start(const std::string& path, int width, int height, int fps = 60, bool realTime = true);
+
+    // Lets the encoder finish what is queued, then prints the totals
+    void stop();
+
+    bool isRecording() const { return encoder != nullptr; }
+
+    // Reads the frame the renderer is about to present
+    void captureFrame(SDL_Renderer* renderer);
+
+private:
+    static int encoderMain(void* data);
+    void encode(int buffer);
+
+    // Buffers travel to the encoder through filledBuffers and come back
+    // through freeBuffers, so each ring has one producer and one consumer
+    SpscRing<int, 16> filledBuffers;
+    SpscRing<int, 16> freeBuffers;
+    std::atomic<bool> stopRequested;
+    SDL_Thread* encoder;
+    std::string path;
+    bool png;
+    FILE* file;
+    int width, height, fps;
+    bool realTime;
+    std::vector<unsigned char> pixels;   // POOL_SIZE frames of RGB24
+    std::vector<unsigned char> planes;   // Y, U and V, used by the encoder
+    int heldBuffer;                      // Taken from the pool but not yet filled
+    Uint32 lastCapture;
+    long long offered, dropped, written;
+    int pngIndex;
+    double captureMicros, peakCaptureMicros;
+};
+
+// The capture shared by every game
+VideoCapture& videoCapture();
+
+// F10 starts and stops recording a game to captures/<game>-<time>.y4m.
+// Returns true if the key was the capture key.
+bool handleCaptureKey(SDL_Keycode key, const char* gameName, SDL_Renderer* renderer);
+
+#endif